@@ -0,0 +1,176 @@
+// Scaling benchmark of truncated_svd on seeded low-rank-plus-noise matrices. Runs under mpirun with
+// one driver and at least one worker, loads TestLib through its C entry points as Alchemist would,
+// and appends one CSV row per configuration to the file given with --csv.
+//
+//   mpirun -np 5 svd_bench --rows 200000 --cols 500 --ranks 10,50 --grams none,local,distributed --csv svd.csv
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <El.hpp>
+#include <omp.h>
+#include "Alchemist.hpp"
+#include "AlchemistLibrary.h"
+
+using namespace alchemist;
+
+struct BenchOptions {
+	uint64_t rows, cols;
+	std::vector<uint32_t> ranks;
+	std::vector<string> grams;
+	uint32_t true_rank;
+	double decay, noise;
+	uint64_t seed;
+	uint32_t repeat;
+	string scaling;							// Label for the CSV, "strong" or "weak"
+	string csv;
+
+	BenchOptions() : rows(100000), cols(500), ranks(1, 10), grams({"none", "local", "distributed"}), true_rank(20),
+			decay(0.9), noise(0.01), seed(1), repeat(1), scaling("strong"), csv("svd_bench.csv") { }
+};
+
+static std::vector<string> split(const string & list)
+{
+	std::vector<string> items;
+	std::stringstream ss(list);
+	string item;
+	while (std::getline(ss, item, ','))
+		if (!item.empty()) items.push_back(item);
+	return items;
+}
+
+static bool parse_options(int argc, char ** argv, BenchOptions & options)
+{
+	for (int i = 1; i + 1 < argc; i += 2) {
+		string key = argv[i], value = argv[i + 1];
+		if (key == "--rows") options.rows = std::strtoull(value.c_str(), nullptr, 10);
+		else if (key == "--cols") options.cols = std::strtoull(value.c_str(), nullptr, 10);
+		else if (key == "--ranks") {
+			options.ranks.clear();
+			for (auto & r : split(value)) options.ranks.push_back((uint32_t) std::strtoul(r.c_str(), nullptr, 10));
+		}
+		else if (key == "--grams") options.grams = split(value);
+		else if (key == "--true-rank") options.true_rank = (uint32_t) std::strtoul(value.c_str(), nullptr, 10);
+		else if (key == "--decay") options.decay = std::strtod(value.c_str(), nullptr);
+		else if (key == "--noise") options.noise = std::strtod(value.c_str(), nullptr);
+		else if (key == "--seed") options.seed = std::strtoull(value.c_str(), nullptr, 10);
+		else if (key == "--repeat") options.repeat = (uint32_t) std::strtoul(value.c_str(), nullptr, 10);
+		else if (key == "--scaling") options.scaling = value;
+		else if (key == "--csv") options.csv = value;
+		else return false;
+	}
+	return (argc % 2) == 1;
+}
+
+template <typename T>
+static T output(const std::vector<Parameter_ptr> & out, const string & name)
+{
+	for (auto it = out.begin(); it != out.end(); it++)
+		if ((*it)->name == name) return * reinterpret_cast<T * >((*it)->p);
+	return T();
+}
+
+int main(int argc, char ** argv)
+{
+	int provided;
+	MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+	El::Initialize(argc, argv);
+
+	MPI_Comm world = MPI_COMM_WORLD;
+	int world_rank, world_size;
+	MPI_Comm_rank(world, &world_rank);
+	MPI_Comm_size(world, &world_size);
+
+	BenchOptions options;
+	if (!parse_options(argc, argv, options) || world_size < 2) {
+		if (world_rank == 0)
+			std::fprintf(stderr, "Usage: mpirun -np N (N >= 2) svd_bench [--rows m] [--cols n] [--ranks k1,k2,...] "
+					"[--grams none,local,distributed] [--true-rank r] [--decay d] [--noise e] [--seed s] [--repeat t] "
+					"[--scaling strong|weak] [--csv file]\n");
+		El::Finalize();
+		MPI_Finalize();
+		return 1;
+	}
+
+	Library * lib = reinterpret_cast<Library * >(alchemist_create_library(&world, ALCHEMIST_LIBRARY_ABI_VERSION));
+	lib->load();
+
+	std::vector<Parameter_ptr> in, out;
+	string task = "generate_matrix";
+	in.push_back(std::make_shared<Parameter>("rows", UINT64, &options.rows));
+	in.push_back(std::make_shared<Parameter>("cols", UINT64, &options.cols));
+	in.push_back(std::make_shared<Parameter>("rank", UINT32, &options.true_rank));
+	in.push_back(std::make_shared<Parameter>("decay", DOUBLE, &options.decay));
+	in.push_back(std::make_shared<Parameter>("noise", DOUBLE, &options.noise));
+	in.push_back(std::make_shared<Parameter>("seed", UINT64, &options.seed));
+	if (lib->run(task, in, out) != 0) {
+		lib->unload();
+		alchemist_destroy_library(lib);
+		El::Finalize();
+		MPI_Finalize();
+		return 1;
+	}
+
+	// Workers pass their part of A, the driver a description of it
+	MatrixInfo info(0, "A", options.rows, options.cols);
+	Parameter_ptr A = (world_rank == 0) ? std::make_shared<Parameter>("A", MATRIX_INFO, &info) : out.front();
+
+	FILE * csv = nullptr;
+	if (world_rank == 0) {
+		csv = std::fopen(options.csv.c_str(), "a");
+		if (csv != nullptr && std::ftell(csv) == 0)
+			std::fprintf(csv, "scaling,processes,workers,threads,rows,cols,rank,true_rank,noise,gram,run,matvecs,"
+					"gram_ms,arnoldi_ms,broadcast_ms,u_ms,total_ms\n");
+	}
+
+	for (auto gram = options.grams.begin(); gram != options.grams.end(); gram++) {
+		for (auto rank = options.ranks.begin(); rank != options.ranks.end(); rank++) {
+			for (uint32_t run = 0; run < options.repeat; run++) {
+				in.clear();
+				out.clear();
+				task = "truncated_svd";
+				in.push_back(A);
+				in.push_back(std::make_shared<Parameter>("rank", UINT32, &*rank));
+				in.push_back(std::make_shared<Parameter>("gram", STRING, &*gram));
+
+				MPI_Barrier(world);
+				auto start = std::chrono::steady_clock::now();
+				int status = lib->run(task, in, out);
+				double total_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+				if (world_rank == 0 && csv != nullptr && status == 0) {
+					std::fprintf(csv, "%s,%d,%d,%d,%llu,%llu,%u,%u,%g,%s,%u,%u,%.3f,%.3f,%.3f,%.3f,%.3f\n", options.scaling.c_str(),
+							world_size, world_size - 1, omp_get_max_threads(), (unsigned long long) options.rows,
+							(unsigned long long) options.cols, *rank, options.true_rank, options.noise, gram->c_str(), run,
+							output<uint32_t>(out, "matvecs"), output<double>(out, "gram_ms"), output<double>(out, "arnoldi_ms"),
+							output<double>(out, "broadcast_ms"), output<double>(out, "u_ms"), total_ms);
+					std::fflush(csv);
+				}
+
+				// U, S and V of the workers
+				task = "release";
+				in.clear();
+				if (world_rank != 0) in = out;
+				out.clear();
+				lib->run(task, in, out);
+			}
+		}
+	}
+
+	if (csv != nullptr) std::fclose(csv);
+
+	task = "release";
+	in.clear();
+	out.clear();
+	if (world_rank != 0) in.push_back(A);
+	lib->run(task, in, out);
+
+	lib->unload();
+	alchemist_destroy_library(lib);
+
+	El::Finalize();
+	MPI_Finalize();
+	return 0;
+}
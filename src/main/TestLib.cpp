@@ -2,7 +2,16 @@
 
 namespace alchemist {
 
-TestLib::TestLib(MPI_Comm & _world) : Library(_world)
+static size_t pool_cache_limit()
+{
+	const char * env = std::getenv("TESTLIB_POOL_CACHE_MB");
+	if (env == nullptr) return BufferPool::default_max_cached_bytes;
+	return (size_t) std::strtoull(env, nullptr, 10) << 20;
+}
+
+TestLib::TestLib(MPI_Comm & _world) : Library(_world), thread_level(MPI_THREAD_SINGLE), workers(MPI_COMM_NULL),
+		workers_initialized(false), num_groups(0), arenas(std::make_shared<ArenaPool>()),
+		pool(std::make_shared<BufferPool>(pool_cache_limit()))
 {
 	int world_rank, world_size;
 	MPI_Comm_rank(world, &world_rank);
@@ -26,6 +35,22 @@ TestLib::TestLib(MPI_Comm & _world) : Library(_world)
 
 int TestLib::load()
 {
+	topology = discover_numa_topology();
+	share_cpus(topology, world);
+	int unpinned = pin_threads(topology, affinity_policy_from_env());
+	log->info("Worker runtime: {}", topology.to_string());
+	if (unpinned > 0) log->warn("Could not pin {} of {} OpenMP threads", unpinned, topology.num_threads);
+
+	// TESTLIB_ISA pins the local kernels to one instruction set, for comparing them on one node
+	const char * isa = std::getenv("TESTLIB_ISA");
+	if (isa != nullptr && !select_local_kernels(isa))
+		log->warn("TESTLIB_ISA={} is not available here", isa);
+	log->info("Local kernels: {} (supported: {})", local_kernels().isa, supported_isas());
+
+	MPI_Query_thread(&thread_level);
+	if (thread_level < MPI_THREAD_MULTIPLE)
+		log->info("MPI was initialized without MPI_THREAD_MULTIPLE, asynchronous tasks will run synchronously");
+
 	log->info("TestLib loaded");
 
 	return 0;
@@ -33,387 +58,2298 @@ int TestLib::load()
 
 int TestLib::unload()
 {
+	for (auto it = in_flight.begin(); it != in_flight.end(); it++) it->second->wait();
+	in_flight.clear();
+
+	resident.clear();
+	stats_cache.clear();
+	operators.clear();
+	streams.clear();
+	group.reset();
+	pool->trim();
+
 	log->info("TestLib unloaded");
 
 	return 0;
 }
 
-int TestLib::run(string & task_name, vector<Parameter_ptr> & in, vector<Parameter_ptr> & out)
+const El::Grid * TestLib::get_worker_grid()
+{
+	if (!workers_initialized) {
+		int world_rank;
+		MPI_Comm_rank(world, &world_rank);
+
+		MPI_Comm_split(world, (world_rank == 0) ? MPI_UNDEFINED : 1, world_rank, &workers);
+		if (workers != MPI_COMM_NULL) worker_grid = std::make_shared<El::Grid>(El::mpi::Comm(workers));
+		workers_initialized = true;
+	}
+
+	return worker_grid.get();
+}
+
+int TestLib::create_groups(TaskArena & out_arena, vector<Parameter_ptr> & in, vector<Parameter_ptr> & out)
 {
-	// Get the rank and size in the original communicator
 	int world_rank, world_size;
 	MPI_Comm_rank(world, &world_rank);
 	MPI_Comm_size(world, &world_size);
 
-	bool is_driver = world_rank == 0;
-
-	if (task_name.compare("greet") == 0) {
+	uint32_t requested = 1;
+	for (auto it = in.begin(); it != in.end(); it++) {
+		if ((*it)->name == "num_groups")
+			requested = * reinterpret_cast<uint32_t * >((*it)->p);
+	}
 
-		uint8_t in_byte = 0;
-		char in_char = ' ';
-		int16_t in_short = 0;
-		int32_t in_int = 0;
-		int64_t in_long = 0;
-		float in_float = 0.0;
-		double in_double = 0.0;
-		string in_string = "";
+	// Every group needs a driver and at least one worker in its grid. All processes reach the same
+	// verdict without communicating, so a bad request returns before any collective call.
+	int num_workers = world_size - 1;
+	if (requested > 0 && num_workers < 2 * (int) requested) {
+		log->error("Cannot split {} workers into {} groups of at least 2", num_workers, requested);
+		return -1;
+	}
 
-		for (auto it = in.begin(); it != in.end(); it++) {
-			if ((*it)->name == "in_byte")
-				in_byte = * reinterpret_cast<uint8_t * >((*it)->p);
-			else if ((*it)->name == "in_char")
-				in_char = * reinterpret_cast<char * >((*it)->p);
-			else if ((*it)->name == "in_short")
-				in_short = * reinterpret_cast<int16_t * >((*it)->p);
-			else if ((*it)->name == "in_int")
-				in_int = * reinterpret_cast<int32_t * >((*it)->p);
-			else if ((*it)->name == "in_long")
-				in_long = * reinterpret_cast<int64_t * >((*it)->p);
-			else if ((*it)->name == "in_float")
-				in_float = * reinterpret_cast<float * >((*it)->p);
-			else if ((*it)->name == "in_double")
-				in_double = * reinterpret_cast<double * >((*it)->p);
-			else if ((*it)->name == "in_string")
-				in_string = * reinterpret_cast<string * >((*it)->p);
-		}
-
-		if (is_driver) log->info("TestLib driver received the following input:");
-		else log->info("TestLib worker {} received the following input:", world_rank);
-		log->info("    {}", (int) in_byte);
-		log->info("    {}", in_char);
-		log->info("    {}", in_short);
-		log->info("    {}", in_int);
-		log->info("    {}", in_long);
-		log->info("    {}", in_float);
-		log->info("    {}", in_double);
-		log->info("    {}", in_string);
-
-		if (is_driver) {
-			out.push_back(std::make_shared<Parameter>("out_byte", UINT8, reinterpret_cast<void *>(new uint8_t(in_byte))));
-			out.push_back(std::make_shared<Parameter>("out_char", CHAR, reinterpret_cast<void *>(new char(in_char))));
-			out.push_back(std::make_shared<Parameter>("out_short", UINT16, reinterpret_cast<void *>(new uint16_t(in_short))));
-			out.push_back(std::make_shared<Parameter>("out_int", UINT32, reinterpret_cast<void *>(new uint32_t(in_int))));
-			out.push_back(std::make_shared<Parameter>("out_long", UINT64, reinterpret_cast<void *>(new uint64_t(in_long))));
-			out.push_back(std::make_shared<Parameter>("out_float", FLOAT, reinterpret_cast<void *>(new float(in_float))));
-			out.push_back(std::make_shared<Parameter>("out_double", DOUBLE, reinterpret_cast<void *>(new double(in_double))));
-			out.push_back(std::make_shared<Parameter>("out_string", STRING, reinterpret_cast<void *>(new string(in_string))));
+	// Tasks still running on the old groups have to finish before their communicators are freed
+	for (auto it = in_flight.begin(); it != in_flight.end(); it++) it->second->wait();
+	in_flight.clear();
+
+	// Resident matrices on the grid of the old group would outlive it
+	if (group) {
+		std::lock_guard<std::mutex> lock(resident_mutex);
+		size_t num_released = 0;
+		for (auto it = resident.begin(); it != resident.end(); ) {
+			if (&it->second->Grid() == group->grid.get()) {
+				stats_cache.erase(it->first);
+				it = resident.erase(it);
+				num_released++;
+			}
+			else it++;
 		}
+		if (num_released > 0) group->log->warn("Released {} resident matrices of group {}", num_released, group->id);
+	}
+
+	group.reset();
+	num_groups = requested;
+	if (num_groups == 0) {
+		if (world_rank == 0) log->info("Dissolved worker groups");
 		MPI_Barrier(world);
+		return 0;
 	}
-	else if (task_name.compare("kmeans") == 0) {
 
-//		uint32_t num_centers    = input.get_int("num_centers");
-//		uint32_t max_iterations = input.get_int("max_iterations");		// How many iteration of Lloyd's algorithm to use
-//		double epsilon          = input.get_double("epsilon");			// if all the centers change by Euclidean distance less
-//																		//     than epsilon, then we stop the iterations
-//		std::string init_mode   = input.get_string("init_mode");			// Number of initialization steps to use in kmeans||
-//
-//		uint32_t init_steps     = input.get_int("init_steps");			// Which initialization method to use to choose
-//																		//     initial cluster center guesses
-//		uint64_t seed           = input.get_long("seed");					// Random seed used in driver and workers
-//
-//
-//		log->info("init_mode {}:", init_mode);
-////		KMeans kmeans = new KMeans(num_centers, max_iterations, epsilon, init_mode, init_steps, seed);
-//		KMeans * kmeans = new KMeans(log, world, grid);
-////		kmeans.set_log(log);
-////		kmeans.set_world(world);
-////		kmeans.set_peers(peers);
-//		kmeans->set_parameters(num_centers, max_iterations, epsilon, init_mode, init_steps, seed);
-//		kmeans->set_data_matrix(input.get_distmatrix("data"));
-//		kmeans->run(output);
-	}
-	else if (task_name.compare("truncated_svd") == 0) {
-
-		if (is_driver) {
-
-			int rank = 0;
-			MatrixInfo * A = nullptr;
-
-			for (auto it = in.begin(); it != in.end(); it++) {
-				if ((*it)->name == "rank") {
-					rank = (int) * reinterpret_cast<uint32_t * >((*it)->p);
-				}
-				else if ((*it)->name == "A") {
-					A = reinterpret_cast<MatrixInfo * >((*it)->p);
-				}
-			}
+	// Contiguous blocks of world ranks, so that groups tend to stay within nodes
+	int color = (world_rank == 0) ? MPI_UNDEFINED : (int) (((int64_t) (world_rank - 1) * num_groups) / num_workers);
+	MPI_Comm comm;
+	MPI_Comm_split(world, color, world_rank, &comm);
+
+	if (world_rank == 0) {
+		log->info("Split {} workers into {} groups", num_workers, num_groups);
+		out.push_back(std::make_shared<Parameter>("num_groups", UINT32, reinterpret_cast<void *>(out_arena.make<uint32_t>(num_groups))));
+	}
+	else {
+		group = std::make_shared<WorkerGroup>();
+		group->id = (uint32_t) color + 1;
+		group->comm = comm;
+
+		int group_rank, group_size;
+		MPI_Comm_rank(comm, &group_rank);
+		MPI_Comm_size(comm, &group_size);
+
+		// The lowest world rank of the group drives it; the others form its process grid
+		MPI_Comm_split(comm, (group_rank == 0) ? MPI_UNDEFINED : 1, group_rank, &group->workers);
+		if (group->workers != MPI_COMM_NULL) group->grid = std::make_shared<El::Grid>(El::mpi::Comm(group->workers));
+
+		char buffer[40];
+		if (group_rank == 0) {
+			sprintf(buffer, "TestLib group-%02u driver", group->id);
+			group->log = start_log(string(buffer), "[%Y-%m-%d %H:%M:%S.%e] [%n] [%l]        %^%v%$", regular, white);
+		}
+		else {
+			sprintf(buffer, "TestLib group-%02u worker-%03d", group->id, world_rank);
+			group->log = start_log(string(buffer), "[%Y-%m-%d %H:%M:%S.%e] [%n] [%l]    %^%v%$", italic, white);
+		}
+		group->log->info("Joined group {} as rank {} of {}", group->id, group_rank, group_size);
 
+		out.push_back(std::make_shared<Parameter>("group", UINT32, reinterpret_cast<void *>(out_arena.make<uint32_t>(group->id))));
+	}
+	MPI_Barrier(world);
 
-			uint8_t method = 1;
+	return 0;
+}
 
-			uint64_t m = A->num_rows;
-			uint64_t n = A->num_cols;
+bool TestLib::make_context(uint32_t group_id, TaskContext & ctx)
+{
+	ctx.group = group_id;
+
+	if (group_id == 0) {
+		ctx.comm = world;
+		MPI_Comm_rank(world, &ctx.rank);
+		MPI_Comm_size(world, &ctx.size);
+		ctx.is_driver = ctx.rank == 0;
+		ctx.log = log;
+		ctx.grid = get_worker_grid();
+		return true;
+	}
 
-			if (rank > m) rank = m;
-			if (rank > n) rank = n;
+	if (!group || group->id != group_id) return false;
 
-			log->info("Starting truncated SVD on {}x{} matrix", m, n);
-			log->info("Settings:");
-			log->info("    rank = {}", rank);
+	ctx.comm = group->comm;
+	MPI_Comm_rank(group->comm, &ctx.rank);
+	MPI_Comm_size(group->comm, &ctx.size);
+	ctx.is_driver = ctx.rank == 0;
+	ctx.log = group->log;
+	ctx.grid = group->grid.get();
+	return true;
+}
 
-			MPI_Barrier(world);
+void TestLib::input_dims(TaskContext & ctx, vector<Parameter_ptr> & in, const string & name, uint64_t & m, uint64_t & n)
+{
+	m = n = 0;
+	for (auto it = in.begin(); it != in.end(); it++) {
+		if ((*it)->name != name) continue;
+		if (ctx.is_driver && ctx.group == 0) {
+			MatrixInfo * A = reinterpret_cast<MatrixInfo * >((*it)->p);
+			m = A->num_rows;
+			n = A->num_cols;
+		}
+		else if (!ctx.is_driver) {
+			El::AbstractDistMatrix<double> * A = reinterpret_cast<El::AbstractDistMatrix<double> * >((*it)->p);
+			m = (uint64_t) A->Height();
+			n = (uint64_t) A->Width();
+		}
+	}
 
-			//	int LOCALEIGS = 0; // TODO: make these an enumeration, and global to Alchemist
-			//	int LOCALEIGSPRECOMPUTE = 1;
-			//	int DISTEIGS = 2;
+	// The driver of a group is a worker of Alchemist and holds no view of the matrix
+	if (ctx.group != 0) {
+		uint64_t dims[2] = {m, n};
+		MPI_Bcast(dims, 2, MPI_UINT64_T, 1, ctx.comm);
+		m = dims[0];
+		n = dims[1];
+	}
+}
 
-			switch(method) {
-			case 2:
-				log->info("Using distributed matrix-vector products against A, then A tranpose");
-				break;
-			case 1:
-				log->info("Using local matrix-vector products computed on the fly against the local Gramians");
-				break;
-			case 0:
-				log->info("Using local matrix-vector products against the precomputed local Gramians");
-				break;
-			}
+void TestLib::wait_in_flight(uint32_t group_id)
+{
+	for (auto it = in_flight.begin(); it != in_flight.end(); ) {
+		if (it->first == group_id) it->second->wait();
 
-			ARrcSymStdEig<double> prob((int) n, rank, "LM");
-			uint8_t command;
-			std::vector<double> zerosVector(n);
-			for (uint32_t idx = 0; idx < n; idx++)
-				zerosVector[idx] = 0.0;
-
-			uint32_t iterNum = 0;
-
-			while (!prob.ArnoldiBasisFound()) {
-				prob.TakeStep();
-				++iterNum;
-				if (iterNum % 20 == 0) log->info("Computed {} matrix-vector products", iterNum);
-				if (prob.GetIdo() == 1 || prob.GetIdo() == -1) {
-					command = 1;
-
-					MPI_Bcast(&command, 1, MPI_UNSIGNED_CHAR, 0, world);
-					if (method == 0 || method == 1) {
-						auto temp = prob.GetVector();
-						MPI_Bcast(prob.GetVector(), n, MPI_DOUBLE, 0, world);
-						MPI_Reduce(zerosVector.data(), prob.PutVector(), n, MPI_DOUBLE, MPI_SUM, 0, world);
-						auto temp1 = prob.GetVector();
-					}
-					if (method == 2) {
-		//				MPI_Status status;
-		//				MPI_Send(prob.GetVector(), n, MPI_DOUBLE, 1, 0, group);
-		//				MPI_Recv(prob.PutVector(), n, MPI_DOUBLE, 1, 0, group, status);
-		////				world.send(1, 0, prob.GetVector(), n);
-		////				world.recv(1, 0, prob.PutVector(), n);
-					}
-				}
-			}
+		if (it->second->poll()) it = in_flight.erase(it);
+		else it++;
+	}
+}
 
-			prob.FindEigenvectors();
-			uint32_t nconv = prob.ConvergedEigenvalues();
-			uint32_t niters = prob.GetIter();
-			log->info("Done after {} Arnoldi iterations, converged to {} eigenvectors of size {}", niters, nconv, n);
-
-			// NB: it may be the case that n*nconv > 4 GB, then have to be careful!
-			// assuming tall and skinny A for now
-			Eigen::MatrixXd rightVecs(n, nconv);
-			log->info("Allocated matrix for right eigenvectors of A'*A");
-			// Eigen uses column-major layout by default!
-			for(uint32_t idx = 0; idx < nconv; idx++)
-				std::memcpy(rightVecs.col(idx).data(), prob.RawEigenvector(idx), n*sizeof(double));
-			log->info("Copied right eigenvectors into allocated storage");
-
-			// Populate U, V, S
-			command = 2;
-			MPI_Bcast(&command, 1, MPI_UNSIGNED_CHAR, 0, world);
-			MPI_Bcast(&nconv, 1, MPI_UNSIGNED, 0, world);
-		//	mpi::broadcast(world, nconv, 0);
-			log->info("Broadcasted command and number of converged eigenvectors");
-			MPI_Bcast(rightVecs.data(), n*nconv, MPI_DOUBLE, 0, world);
-		//	mpi::broadcast(world, rightVecs.data(), n*nconv, 0);
-			log->info("Broadcasted right eigenvectors");
-			auto ng = prob.RawEigenvalues();
-			MPI_Bcast(prob.RawEigenvalues(), nconv, MPI_DOUBLE, 0, world);
-			log->info("Broadcasted eigenvalues");
+std::shared_ptr<ColumnStats> TestLib::get_column_stats(const El::AbstractDistMatrix<double> & A, uint8_t sketch,
+		El::Int sketch_rows, uint64_t seed, bool cache)
+{
+	const void * key = reinterpret_cast<const void *>(&A);
+	bool cacheable = false;
+
+	// Every process of the grid holds the same resident set and cache, so they all agree here
+	if (cache) {
+		std::lock_guard<std::mutex> lock(resident_mutex);
+		cacheable = resident.count(const_cast<void *>(key)) > 0;
+		auto it = stats_cache.find(key);
+		if (it != stats_cache.end()) {
+			const ColumnStats & cached = *it->second;
+			if (sketch == SKETCH_NONE || (cached.sketch == sketch && cached.sketch_rows == sketch_rows && cached.seed == seed))
+				return it->second;
+		}
+	}
+
+	auto stats = std::make_shared<ColumnStats>();
+	column_stats(A, *stats, sketch, sketch_rows, seed);
+
+	if (cacheable) {
+		std::lock_guard<std::mutex> lock(resident_mutex);
+		stats_cache[key] = stats;
+	}
+
+	return stats;
+}
+
+DistMatrixConst_ptr TestLib::share_input(const El::AbstractDistMatrix<double> * A)
+{
+	std::lock_guard<std::mutex> lock(resident_mutex);
+	auto it = resident.find(const_cast<El::AbstractDistMatrix<double> *>(A));
+	if (it != resident.end()) return it->second;
+	return DistMatrixConst_ptr(A, [](const El::AbstractDistMatrix<double> *) { });
+}
+
+// The output parameters added by a task share ownership of the arena their values live in
+static void hold_arena(vector<Parameter_ptr> & out, size_t first, const std::shared_ptr<TaskArena> & arena)
+{
+	typedef std::pair<Parameter_ptr, std::shared_ptr<TaskArena> > Owner;
+	for (size_t i = first; i < out.size(); i++) {
+		auto owner = std::make_shared<Owner>(out[i], arena);
+		out[i] = Parameter_ptr(owner, out[i].get());
+	}
+}
+
+int TestLib::run(string & task_name, vector<Parameter_ptr> & in, vector<Parameter_ptr> & out)
+{
+	std::shared_ptr<TaskArena> arena = arenas->acquire();
+	size_t first_output = out.size();
+	int result = run_in_arena(task_name, *arena, in, out);
+	hold_arena(out, first_output, arena);
+	return result;
+}
+
+int TestLib::run_in_arena(string & task_name, TaskArena & arena, vector<Parameter_ptr> & in, vector<Parameter_ptr> & out)
+{
+	if (task_name.compare("create_groups") == 0) return create_groups(arena, in, out);
+
+	uint32_t group_id = 0;
+	for (auto it = in.begin(); it != in.end(); it++) {
+		if ((*it)->name == "group")
+			group_id = * reinterpret_cast<uint32_t * >((*it)->p);
+	}
+
+	if (group_id > num_groups) {
+		log->error("Task {} asked for group {}, but there are only {} groups", task_name, group_id, num_groups);
+		return -1;
+	}
+
+	wait_in_flight(group_id);
+
+	// Processes outside the group, including the Alchemist driver, take no part in the task
+	TaskContext ctx;
+	if (!make_context(group_id, ctx)) {
+		int world_rank;
+		MPI_Comm_rank(world, &world_rank);
+		if (world_rank == 0) log->info("Running task {} on worker group {}", task_name, group_id);
+		return 0;
+	}
+	ctx.arena = &arena;
+	ctx.handle = nullptr;
+
+	return dispatch(task_name, ctx, in, out);
+}
+
+TaskHandle_ptr TestLib::run_async(string & task_name, vector<Parameter_ptr> & in)
+{
+	auto handle = std::make_shared<TaskHandle>(task_name);
+
+	if (task_name.compare("create_groups") == 0) {
+		handle->finish(create_groups(handle->arena, in, handle->outputs));
+		return handle;
+	}
+
+	uint32_t group_id = 0;
+	for (auto it = in.begin(); it != in.end(); it++) {
+		if ((*it)->name == "group")
+			group_id = * reinterpret_cast<uint32_t * >((*it)->p);
+	}
+
+	if (group_id > num_groups) {
+		log->error("Task {} asked for group {}, but there are only {} groups", task_name, group_id, num_groups);
+		handle->finish(-1);
+		return handle;
+	}
+
+	// Collectives on one communicator have to be issued in the same order everywhere, so tasks on
+	// the same group run one after the other
+	wait_in_flight(group_id);
+
+	TaskContext ctx;
+	if (!make_context(group_id, ctx)) {
+		handle->finish(0);
+		return handle;
+	}
+	ctx.arena = &handle->arena;
+	ctx.handle = handle.get();
+
+	// The calling thread goes on making MPI calls of its own while the task runs, which only
+	// MPI_THREAD_MULTIPLE allows; with less thread support the task runs here, to completion
+	if (thread_level < MPI_THREAD_MULTIPLE) {
+		handle->finish(dispatch(task_name, ctx, in, handle->outputs));
+		return handle;
+	}
+
+	string name = task_name;
+	vector<Parameter_ptr> inputs = in;
+	handle->start([this, name, ctx, inputs](TaskHandle & h) mutable {
+		return dispatch(name, ctx, inputs, h.outputs);
+	});
+	in_flight[group_id] = handle;
+
+	return handle;
+}
+
+#define DISPATCH_TASK(name, ...) {#name, &TestLib::run_##name},
+
+// Every task of TestLibTasks.hpp, and so of alchemist_describe_library
+const std::map<string, TestLib::TaskMethod> TestLib::task_methods = {
+	TESTLIB_TASKS(DISPATCH_TASK)
+};
+
+bool TestLib::has_task(const string & task_name)
+{
+	return task_name.compare("create_groups") == 0 || task_methods.count(task_name) > 0;
+}
+
+int TestLib::dispatch(const string & task_name, TaskContext & ctx, vector<Parameter_ptr> & in, vector<Parameter_ptr> & out)
+{
+	auto method = task_methods.find(task_name);
+	if (method == task_methods.end()) {
+		log->error("Unknown task {}, see alchemist_describe_library for the supported tasks", task_name);
+		return -1;
+	}
+
+	return (this->*(method->second))(ctx, in, out);
+}
+
+int TestLib::run_greet(TaskContext & ctx, vector<Parameter_ptr> & in, vector<Parameter_ptr> & out)
+{
+	uint8_t in_byte = 0;
+	char in_char = ' ';
+	int16_t in_short = 0;
+	int32_t in_int = 0;
+	int64_t in_long = 0;
+	float in_float = 0.0;
+	double in_double = 0.0;
+	string in_string = "";
+
+	for (auto it = in.begin(); it != in.end(); it++) {
+		if ((*it)->name == "in_byte")
+			in_byte = * reinterpret_cast<uint8_t * >((*it)->p);
+		else if ((*it)->name == "in_char")
+			in_char = * reinterpret_cast<char * >((*it)->p);
+		else if ((*it)->name == "in_short")
+			in_short = * reinterpret_cast<int16_t * >((*it)->p);
+		else if ((*it)->name == "in_int")
+			in_int = * reinterpret_cast<int32_t * >((*it)->p);
+		else if ((*it)->name == "in_long")
+			in_long = * reinterpret_cast<int64_t * >((*it)->p);
+		else if ((*it)->name == "in_float")
+			in_float = * reinterpret_cast<float * >((*it)->p);
+		else if ((*it)->name == "in_double")
+			in_double = * reinterpret_cast<double * >((*it)->p);
+		else if ((*it)->name == "in_string")
+			in_string = * reinterpret_cast<string * >((*it)->p);
+	}
+
+	if (ctx.is_driver) ctx.log->info("TestLib driver received the following input:");
+	else ctx.log->info("TestLib worker {} received the following input:", ctx.rank);
+	ctx.log->info("    {}", (int) in_byte);
+	ctx.log->info("    {}", in_char);
+	ctx.log->info("    {}", in_short);
+	ctx.log->info("    {}", in_int);
+	ctx.log->info("    {}", in_long);
+	ctx.log->info("    {}", in_float);
+	ctx.log->info("    {}", in_double);
+	ctx.log->info("    {}", in_string);
+
+	if (ctx.is_driver) {
+		out.push_back(std::make_shared<Parameter>("out_byte", UINT8, reinterpret_cast<void *>(ctx.arena->make<uint8_t>(in_byte))));
+		out.push_back(std::make_shared<Parameter>("out_char", CHAR, reinterpret_cast<void *>(ctx.arena->make<char>(in_char))));
+		out.push_back(std::make_shared<Parameter>("out_short", UINT16, reinterpret_cast<void *>(ctx.arena->make<uint16_t>(in_short))));
+		out.push_back(std::make_shared<Parameter>("out_int", UINT32, reinterpret_cast<void *>(ctx.arena->make<uint32_t>(in_int))));
+		out.push_back(std::make_shared<Parameter>("out_long", UINT64, reinterpret_cast<void *>(ctx.arena->make<uint64_t>(in_long))));
+		out.push_back(std::make_shared<Parameter>("out_float", FLOAT, reinterpret_cast<void *>(ctx.arena->make<float>(in_float))));
+		out.push_back(std::make_shared<Parameter>("out_double", DOUBLE, reinterpret_cast<void *>(ctx.arena->make<double>(in_double))));
+		out.push_back(std::make_shared<Parameter>("out_string", STRING, reinterpret_cast<void *>(ctx.arena->make<string>(in_string))));
+	}
+	MPI_Barrier(ctx.comm);
+
+	return 0;
+}
+
+int TestLib::run_release(TaskContext & ctx, vector<Parameter_ptr> & in, vector<Parameter_ptr> & out)
+{
+	// Every matrix passed in that was produced by an earlier task is dropped from the resident set
+	uint32_t num_released = 0;
+	if (!ctx.is_driver) {
+		std::lock_guard<std::mutex> lock(resident_mutex);
+		for (auto it = in.begin(); it != in.end(); it++) {
+			stats_cache.erase((*it)->p);
+			if (resident.erase((*it)->p) > 0 || operators.erase((*it)->p) > 0 || streams.erase((*it)->p) > 0) num_released++;
+		}
+		ctx.log->info("Released {} resident matrices, {} remain", num_released, resident.size());
+	}
+	MPI_Barrier(ctx.comm);
+
+	return 0;
+}
 
-			log->info("Waiting on workers to store U, S, and V");
+int TestLib::run_load_matrix(TaskContext & ctx, vector<Parameter_ptr> & in, vector<Parameter_ptr> & out)
+{
+	string path = "";
+	string mode = "mpiio";				// "mpiio": read own rows collectively, "mmap": map a cyclic file on one node
+	for (auto it = in.begin(); it != in.end(); it++) {
+		if ((*it)->name == "path")
+			path = * reinterpret_cast<string * >((*it)->p);
+		else if ((*it)->name == "mode")
+			mode = * reinterpret_cast<string * >((*it)->p);
+	}
+
+	const El::Grid * grid = ctx.grid;
+
+	int error = MPI_SUCCESS;
+	if (ctx.is_driver) {
+		MatrixFileHeader header;
+		if (read_matrix_header(path, header))
+			ctx.log->info("Loading {}x{} matrix {} from {} in {} panels ({})", header.num_rows, header.num_cols, header.name, path, header.num_panels(), mode);
+		else
+			ctx.log->warn("Could not read a matrix header from {}", path);
+	}
+	else {
+		std::shared_ptr<El::DistMatrix<double, El::VR, El::STAR> > A;
+		MatrixFileHeader header;
+
+		auto startLoad = std::chrono::system_clock::now();
+		error = (mode == "mmap") ? map_matrix(path, *grid, A, header) : load_matrix(path, *grid, pool, A, header);
+		std::chrono::duration<double, std::milli> load_duration(std::chrono::system_clock::now() - startLoad);
+
+		// Mapping is not collective, so a worker can fail alone
+		MPI_Allreduce(MPI_IN_PLACE, &error, 1, MPI_INT, MPI_MAX, grid->Comm().comm);
+		if (error == MPI_SUCCESS) {
+			ctx.log->info("{} {} local rows of {}x{} matrix in {} ms", (mode == "mmap") ? "Mapped" : "Read", A->LocalHeight(), A->Height(), A->Width(), load_duration.count());
+			out.push_back(std::make_shared<Parameter>("A", DISTMATRIX_VR_STAR, keep_resident(A)));
+		}
+	}
+	MPI_Bcast(&error, 1, MPI_INT, 1, ctx.comm);
 
-			MPI_Barrier(world);
+	if (error == MPI_ERR_ARG)
+		ctx.log->error("Matrix in {} is not laid out for {} workers, save it again with layout \"cyclic\"", path, ctx.size - 1);
+	else if (error == MPI_ERR_CONVERSION)
+		ctx.log->error("Matrix in {} was written on a machine of the other byte order", path);
+	else if (error != MPI_SUCCESS)
+		ctx.log->error("Failed to load matrix from {} (MPI error {})", path, error);
+	MPI_Barrier(ctx.comm);
+
+	return (error == MPI_SUCCESS) ? 0 : -1;
+}
+
+int TestLib::run_save_matrix(TaskContext & ctx, vector<Parameter_ptr> & in, vector<Parameter_ptr> & out)
+{
+	string path = "";
+	uint64_t panel_rows = 0;
+	string layout = "rows";				// "rows": row panels, "cyclic": one panel per worker, for mmap
+
+	uint64_t m, n;
+	input_dims(ctx, in, "A", m, n);
+
+	int error = MPI_SUCCESS;
+	if (ctx.is_driver) {
+		for (auto it = in.begin(); it != in.end(); it++) {
+			if ((*it)->name == "path")
+				path = * reinterpret_cast<string * >((*it)->p);
+		}
+		ctx.log->info("Saving {}x{} matrix to {}", m, n, path);
+	}
+	else {
+		El::AbstractDistMatrix<double> * A = nullptr;
+		for (auto it = in.begin(); it != in.end(); it++) {
+			if ((*it)->name == "A")
+				A = reinterpret_cast<El::AbstractDistMatrix<double> * >((*it)->p);
+			else if ((*it)->name == "path")
+				path = * reinterpret_cast<string * >((*it)->p);
+			else if ((*it)->name == "panel_rows")
+				panel_rows = * reinterpret_cast<uint64_t * >((*it)->p);
+			else if ((*it)->name == "layout")
+				layout = * reinterpret_cast<string * >((*it)->p);
 		}
+
+		// Rows have to be local to be written as panels; row-partitioned inputs are written in place
+		std::unique_ptr<El::DistMatrix<double, El::VR, El::STAR> > Arows;
+		const El::DistMatrix<double, El::VR, El::STAR> * rows;
+		if (A->ColDist() == El::VR && A->RowDist() == El::STAR)
+			rows = static_cast<const El::DistMatrix<double, El::VR, El::STAR> * >(A);
 		else {
-			int rank = 0;
-			DistMatrix * A = nullptr;
+			Arows.reset(new El::DistMatrix<double, El::VR, El::STAR>(*A));
+			rows = Arows.get();
+		}
 
-			for (auto it = in.begin(); it != in.end(); it++) {
-				if ((*it)->name == "rank") {
-					rank = (int) * reinterpret_cast<uint32_t * >((*it)->p);
-				}
-				else if ((*it)->name == "A") {
-					A = reinterpret_cast<DistMatrix * >((*it)->p);
-				}
-			}
+		auto startSave = std::chrono::system_clock::now();
+		error = save_matrix(path, *rows, "", panel_rows, (layout == "cyclic") ? MATRIX_FILE_CYCLIC : MATRIX_FILE_ROW_PANELS);
+		std::chrono::duration<double, std::milli> save_duration(std::chrono::system_clock::now() - startSave);
 
-//			for (auto it = in.begin(); it != in.end(); it++) {
-//				if ((*it)->name == "rank") {
-//					rank = (int) * (* reinterpret_cast<std::shared_ptr<uint32_t> * >((*it)->p));
-//				}
-//				else if ((*it)->name == "A") {
-//					A = * (* reinterpret_cast<std::shared_ptr<DistMatrix_ptr> * >((*it)->p));
-//				}
-//			}
+		if (error == MPI_SUCCESS)
+			ctx.log->info("Wrote {} local rows to {} in {} ms", rows->LocalHeight(), path, save_duration.count());
+	}
+	MPI_Bcast(&error, 1, MPI_INT, 1, ctx.comm);
+
+	if (error != MPI_SUCCESS)
+		ctx.log->error("Failed to save matrix to {} (MPI error {})", path, error);
+	MPI_Barrier(ctx.comm);
+
+	return (error == MPI_SUCCESS) ? 0 : -1;
+}
+
+int TestLib::run_generate_matrix(TaskContext & ctx, vector<Parameter_ptr> & in, vector<Parameter_ptr> & out)
+{
+	uint64_t m = 0, n = 0;
+	uint32_t rank = 10;
+	double decay = 0.9;						// Of the singular values of the low-rank part
+	double noise = 0.01;
+	uint64_t seed = 0;
+	for (auto it = in.begin(); it != in.end(); it++) {
+		if ((*it)->name == "rows")
+			m = * reinterpret_cast<uint64_t * >((*it)->p);
+		else if ((*it)->name == "cols")
+			n = * reinterpret_cast<uint64_t * >((*it)->p);
+		else if ((*it)->name == "rank")
+			rank = * reinterpret_cast<uint32_t * >((*it)->p);
+		else if ((*it)->name == "decay")
+			decay = * reinterpret_cast<double * >((*it)->p);
+		else if ((*it)->name == "noise")
+			noise = * reinterpret_cast<double * >((*it)->p);
+		else if ((*it)->name == "seed")
+			seed = * reinterpret_cast<uint64_t * >((*it)->p);
+	}
 
-			uint8_t method = 1;
+	if (m == 0 || n == 0) {
+		ctx.log->error("generate_matrix needs rows and cols");
+		return -1;
+	}
 
-			const El::Grid & grid = A->Grid();
+	if (ctx.is_driver) {
+		ctx.log->info("Generating {}x{} matrix of rank {} plus noise {}, seed {}", m, n, rank, noise, seed);
+	}
+	else {
+		auto startGenerate = std::chrono::system_clock::now();
+		auto A = low_rank_plus_noise(pool, (El::Int) m, (El::Int) n, (El::Int) rank, decay, noise, seed, *ctx.grid);
+		std::chrono::duration<double, std::milli> generate_duration(std::chrono::system_clock::now() - startGenerate);
+		ctx.log->info("Generated {} local rows in {} ms", A->LocalHeight(), generate_duration.count());
 
-			int m = A->Height();
-			int n = A->Width();
+		out.push_back(std::make_shared<Parameter>("A", DISTMATRIX_VR_STAR, keep_resident(A)));
+	}
+	MPI_Barrier(ctx.comm);
 
-			if (rank > m) rank = m;
-			if (rank > n) rank = n;
+	return 0;
+}
 
-			MPI_Barrier(world);
+int TestLib::run_matmul(TaskContext & ctx, vector<Parameter_ptr> & in, vector<Parameter_ptr> & out)
+{
+	bool transpose_a = false, transpose_b = false;
+	string algorithm = "auto";
+	for (auto it = in.begin(); it != in.end(); it++) {
+		if ((*it)->name == "transpose_a")
+			transpose_a = * reinterpret_cast<bool * >((*it)->p);
+		else if ((*it)->name == "transpose_b")
+			transpose_b = * reinterpret_cast<bool * >((*it)->p);
+		else if ((*it)->name == "algorithm")
+			algorithm = * reinterpret_cast<string * >((*it)->p);
+	}
 
-			log->info("Starting truncated SVD");
+	uint64_t a_rows, a_cols, b_rows, b_cols;
+	input_dims(ctx, in, "A", a_rows, a_cols);
+	input_dims(ctx, in, "B", b_rows, b_cols);
 
-			//	  int LOCALEIGS = 0; // TODO: make these an enumeration, and global to Alchemist
-			//	  int LOCALEIGSPRECOMPUTE = 1;
-			//	  int DISTEIGS = 2;
+	El::Int m = (El::Int) (transpose_a ? a_cols : a_rows);
+	El::Int k = (El::Int) (transpose_a ? a_rows : a_cols);
+	El::Int n = (El::Int) (transpose_b ? b_rows : b_cols);
 
-			// Assume matrix is row-partitioned b/c relaying it out doubles memory requirements
+	// Every process sees the same dimensions, so they all agree on whether to go ahead
+	El::GemmAlgorithm alg;
+	if (k != (El::Int) (transpose_b ? b_cols : b_rows)) {
+		ctx.log->error("Cannot multiply {}x{} by {}x{} matrix", m, k, (transpose_b ? b_cols : b_rows), n);
+		return -1;
+	}
+	if (!parse_gemm_algorithm(algorithm, m, n, k, alg)) {
+		ctx.log->error("Unknown matmul algorithm {}", algorithm);
+		return -1;
+	}
 
-			//NB: sometimes it makes sense to precompute the gramMat (when it's cheap (we have a lot of cores and enough memory), sometimes
-			// it makes more sense to compute A'*(A*x) separately each time (when we don't have enough memory for gramMat, or its too expensive
-			// time-wise to precompute GramMat). trade-off depends on k (through the number of Arnoldi iterations we'll end up needing), the
-			// amount of memory we have free to store GramMat, and the number of cores we have available
-			El::Matrix<double> localGramChunk;
+	if (ctx.is_driver) {
+		ctx.log->info("Multiplying {}{}x{} by {}{}x{} matrix using {}", transpose_a ? "transposed " : "", a_rows, a_cols,
+				transpose_b ? "transposed " : "", b_rows, b_cols, gemm_algorithm_name(alg));
+	}
+	else {
+		El::AbstractDistMatrix<double> * A = nullptr, * B = nullptr;
+		for (auto it = in.begin(); it != in.end(); it++) {
+			if ((*it)->name == "A")
+				A = reinterpret_cast<El::AbstractDistMatrix<double> * >((*it)->p);
+			else if ((*it)->name == "B")
+				B = reinterpret_cast<El::AbstractDistMatrix<double> * >((*it)->p);
+		}
 
-			if (method == 1) {
-				localGramChunk.Resize(n, n);
-				log->info("Computing the local contribution to A'*A");
-				log->info("Local matrix's dimensions are {}x{}", A->LockedMatrix().Height(), A->LockedMatrix().Width());
-				log->info("Storing A'*A in {}x{} matrix", n, n);
-				auto startFillLocalMat = std::chrono::system_clock::now();
-				if (A->LockedMatrix().Height() > 0)
-					El::Gemm(El::TRANSPOSE, El::NORMAL, 1.0, A->LockedMatrix(), A->LockedMatrix(), 0.0, localGramChunk);
-				else
-					El::Zeros(localGramChunk, n, n);
-				std::chrono::duration<double, std::milli> fillLocalMat_duration(std::chrono::system_clock::now() - startFillLocalMat);
-				log->info("Took {} ms to compute local contribution to A'*A", fillLocalMat_duration.count());
-			}
+		auto startMultiply = std::chrono::system_clock::now();
+		auto C = multiply(pool, transpose_a ? El::TRANSPOSE : El::NORMAL, transpose_b ? El::TRANSPOSE : El::NORMAL, *A, *B, alg);
+		std::chrono::duration<double, std::milli> multiply_duration(std::chrono::system_clock::now() - startMultiply);
+		ctx.log->info("Computed {}x{} product in {} ms", C->Height(), C->Width(), multiply_duration.count());
 
-			uint8_t command;
-			std::unique_ptr<double[]> vecIn{new double[n]};
-			El::Matrix<double> localx(n, 1);
-			El::Matrix<double> localintermed(A->LocalHeight(), 1);
-			El::Matrix<double> localy(n, 1);
-			localx.LockedAttach(n, 1, vecIn.get(), 1);
-			auto distx = new DistMatrix(n, 1, grid);
-			auto distintermed = new DistMatrix(m, 1, grid);
-		//	auto distx = El::DistMatrix<double, El::STAR, El::STAR>(n, 1, self->grid);
-		//	auto distintermed = El::DistMatrix<double, El::STAR, El::STAR>(m, 1, self->grid);
-
-			log->info("Finished initialization for truncated SVD");
-
-			while(true) {
-				MPI_Bcast(&command, 1, MPI_UNSIGNED_CHAR, 0, world);
-		//		mpi::broadcast(self->world, command, 0);
-				if (command == 1 && method == 0) {
-					void * uut;
-					MPI_Bcast(vecIn.get(), n, MPI_DOUBLE, 0, world);
-					auto uu = vecIn.get();
-					El::Gemv(El::NORMAL, 1.0, A->LockedMatrix(), localx, 0.0, localintermed);
-					El::Gemv(El::TRANSPOSE, 1.0, A->LockedMatrix(), localintermed, 0.0, localy);
-					MPI_Reduce(localy.LockedBuffer(), uut, n, MPI_DOUBLE, MPI_SUM, 0, world);
-				}
-				if (command == 1 && method == 1) {
-					MPI_Bcast(vecIn.get(), n, MPI_DOUBLE, 0, world);
-					void * uut;
-					El::Gemv(El::NORMAL, 1.0, localGramChunk, localx, 0.0, localy);
-					MPI_Reduce(localy.LockedBuffer(), uut, n, MPI_DOUBLE, MPI_SUM, 0, world);
-				}
-				if (command == 1 && method == 2) {
-		//			El::Zeros(distx, n, 1);
-		//			log->info("Computing a mat-vec prod against A^TA");
-		//			if (self->world.rank() == 1) {
-		//				self->world.recv(0, 0, vecIn.get(), n);
-		//				distx.Reserve(n);
-		//				for(El::Int row=0; row < n; row++)
-		//					distx.QueueUpdate(row, 0, vecIn[row]);
-		//			}
-		//			else {
-		//				distx.Reserve(0);
-		//			}
-		//			distx.ProcessQueues();
-		//			log->info("Retrieved x, computing A^TAx");
-		//			El::Gemv(El::NORMAL, 1.0, *workingMat, distx, 0.0, distintermed);
-		//			log->info("Computed y = A*x");
-		//			El::Gemv(El::TRANSPOSE, 1.0, *workingMat, distintermed, 0.0, distx);
-		//			log->info("Computed x = A^T*y");
-		//			if(self->world.rank() == 1) {
-		//				world.send(0, 0, distx.LockedBuffer(), n);
-		//			}
-				}
-				if (command == 2) {
-					uint32_t nconv;
-					MPI_Bcast(&nconv, 1, MPI_UNSIGNED, 0, world);
-
-					Eigen::MatrixXd rightEigs(n, nconv);
-					MPI_Bcast(rightEigs.data(), n*nconv, MPI_DOUBLE, 0, world);
-					Eigen::VectorXd singValsSq(nconv);
-					MPI_Bcast(singValsSq.data(), nconv, MPI_DOUBLE, 0, world);
-					log->info("Received the right eigenvectors and the eigenvalues");
-
-//					DistMatrix_ptr U    = std::make_shared<El::DistMatrix<double, El::VR, El::STAR>>(m, nconv, grid);
-//					DistMatrix_ptr S    = std::make_shared<El::DistMatrix<double, El::VR, El::STAR>>(nconv, 1, grid);
-//					DistMatrix_ptr Sinv = std::make_shared<El::DistMatrix<double, El::VR, El::STAR>>(nconv, 1, grid);
-//					DistMatrix_ptr V    = std::make_shared<El::DistMatrix<double, El::VR, El::STAR>>(n, nconv, grid);
-
-
-					El::DistMatrix<double, El::VR, El::STAR> * U    = new El::DistMatrix<double, El::VR, El::STAR>(m, nconv, grid);
-					El::DistMatrix<double, El::VR, El::STAR> * S    = new El::DistMatrix<double, El::VR, El::STAR>(nconv, 1, grid);
-					El::DistMatrix<double, El::VR, El::STAR> * Sinv = new El::DistMatrix<double, El::VR, El::STAR>(nconv, 1, grid);
-					El::DistMatrix<double, El::VR, El::STAR> * V    = new El::DistMatrix<double, El::VR, El::STAR>(n, nconv, grid);
-
-					log->info("Created new matrix objects to hold U, S, and V");
-
-					// populate V
-					for (El::Int rowIdx = 0; rowIdx < n; rowIdx++)
-						for (El::Int colIdx = 0; colIdx < (El::Int) nconv; colIdx++)
-							if (V->IsLocal(rowIdx, colIdx))
-								V->SetLocal(V->LocalRow(rowIdx), V->LocalCol(colIdx), rightEigs(rowIdx,colIdx));
-					rightEigs.resize(0,0); // clear any memory this temporary variable used (a lot, since it's on every rank)
-
-					// populate S, Sinv
-					for (El::Int idx = 0; idx < (El::Int) nconv; idx++) {
-						if (S->IsLocal(idx, 0)) {
-							S->SetLocal(S->LocalRow(idx), 0, std::sqrt(singValsSq(idx)));
-						}
-						if (Sinv->IsLocal(idx, 0))
-							Sinv->SetLocal(Sinv->LocalRow(idx), 0, 1/std::sqrt(singValsSq(idx)));
-					}
-					log->info("Stored V and S");
-
-					// form U
-					log->info("Computing A*V = U*Sigma");
-					log->info("A is {}x{}, V is {}x{}, U will be {}x{}", A->Height(), A->Width(), V->Height(), V->Width(), U->Height(), U->Width());
-					//Gemm(1.0, *workingMat, *V, 0.0, *U, self->log);
-					El::Gemm(El::NORMAL, El::NORMAL, 1.0, *A, *V, 0.0, *U);
-					log->info("Done computing A*V, rescaling to get U");
-					// TODO: do a QR instead to ensure stability, but does column pivoting so would require postprocessing S,V to stay consistent
-					El::DiagonalScale(El::RIGHT, El::NORMAL, *Sinv, *U);
-					log->info("Computed and stored U");
-//
-//					out.add_distmatrix("S", S);
-//					out.add_distmatrix("U", U);
-//					out.add_distmatrix("V", V);
+		out.push_back(std::make_shared<Parameter>("C", DISTMATRIX_MC_MR, keep_resident(C)));
+	}
+	MPI_Barrier(ctx.comm);
+
+	return 0;
+}
 
-					out.push_back(std::make_shared<Parameter>("S", DISTMATRIX_VR_STAR, reinterpret_cast<void *>(S)));
-					out.push_back(std::make_shared<Parameter>("U", DISTMATRIX_VR_STAR, reinterpret_cast<void *>(U)));
-					out.push_back(std::make_shared<Parameter>("V", DISTMATRIX_VR_STAR, reinterpret_cast<void *>(V)));
+int TestLib::run_gram(TaskContext & ctx, vector<Parameter_ptr> & in, vector<Parameter_ptr> & out)
+{
+	string algorithm = "auto";				// "auto", "local": sum the Gramians of local rows, "syrk": El::Syrk
+	for (auto it = in.begin(); it != in.end(); it++) {
+		if ((*it)->name == "algorithm")
+			algorithm = * reinterpret_cast<string * >((*it)->p);
+	}
 
-					break;
-				}
-			}
-			MPI_Barrier(world);
+	uint64_t m, n;
+	input_dims(ctx, in, "A", m, n);
+
+	if (algorithm != "auto" && algorithm != "local" && algorithm != "syrk") {
+		ctx.log->error("Unknown gram algorithm {}", algorithm);
+		return -1;
+	}
+
+	if (ctx.is_driver) {
+		ctx.log->info("Computing the Gramian of {}x{} matrix", m, n);
+	}
+	else {
+		El::AbstractDistMatrix<double> * A = nullptr;
+		for (auto it = in.begin(); it != in.end(); it++) {
+			if ((*it)->name == "A")
+				A = reinterpret_cast<El::AbstractDistMatrix<double> * >((*it)->p);
+		}
+
+		// The local algorithm needs the rows of A to be local
+		bool local = (algorithm == "auto") ? gram_is_local(*A) : algorithm == "local";
+		std::unique_ptr<El::DistMatrix<double, El::VR, El::STAR> > Arows;
+		bool row_distributed = (A->ColDist() == El::VR || A->ColDist() == El::VC) && A->RowDist() == El::STAR;
+		if (local && !row_distributed) {
+			Arows.reset(new El::DistMatrix<double, El::VR, El::STAR>(*A));
+			A = Arows.get();
+		}
+
+		auto startGram = std::chrono::system_clock::now();
+		auto G = gram(pool, *A, local);
+		std::chrono::duration<double, std::milli> gram_duration(std::chrono::system_clock::now() - startGram);
+		ctx.log->info("Computed {}x{} Gramian in {} ms ({})", n, n, gram_duration.count(), local ? "sum of local Gramians" : "Syrk");
+
+		out.push_back(std::make_shared<Parameter>("G", local ? DISTMATRIX_VR_STAR : DISTMATRIX_MC_MR, keep_resident(G)));
+	}
+	MPI_Barrier(ctx.comm);
+
+	return 0;
+}
+
+int TestLib::run_column_stats(TaskContext & ctx, vector<Parameter_ptr> & in, vector<Parameter_ptr> & out)
+{
+	string sketch_name = "none";			// "none", "count": CountSketch, "gaussian": dense Gaussian sketch, "srht"
+	uint32_t sketch_rows = 0;				// 0 for four times the number of columns
+	uint64_t seed = 0;
+	bool cache = true;						// Reuse, and keep, the statistics of a resident matrix
+	for (auto it = in.begin(); it != in.end(); it++) {
+		if ((*it)->name == "sketch")
+			sketch_name = * reinterpret_cast<string * >((*it)->p);
+		else if ((*it)->name == "sketch_rows")
+			sketch_rows = * reinterpret_cast<uint32_t * >((*it)->p);
+		else if ((*it)->name == "seed")
+			seed = * reinterpret_cast<uint64_t * >((*it)->p);
+		else if ((*it)->name == "cache")
+			cache = * reinterpret_cast<bool * >((*it)->p);
+	}
+
+	uint64_t m, n;
+	input_dims(ctx, in, "A", m, n);
+
+	uint8_t sketch;
+	if (sketch_name == "none") sketch = SKETCH_NONE;
+	else if (sketch_name == "count") sketch = SKETCH_COUNT;
+	else if (sketch_name == "gaussian") sketch = SKETCH_GAUSSIAN;
+	else if (sketch_name == "srht") sketch = SKETCH_SRHT;
+	else {
+		ctx.log->error("Unknown sketch {}", sketch_name);
+		return -1;
+	}
+	if (sketch != SKETCH_NONE && sketch_rows == 0) sketch_rows = (uint32_t) std::max(n * 4, uint64_t(1));
+
+	if (ctx.is_driver) {
+		if (sketch == SKETCH_NONE) ctx.log->info("Computing column statistics of {}x{} matrix", m, n);
+		else ctx.log->info("Computing column statistics and {} {}x{} sketch of {}x{} matrix", sketch_name, sketch_rows, n, m, n);
+	}
+	else {
+		El::AbstractDistMatrix<double> * A = nullptr;
+		for (auto it = in.begin(); it != in.end(); it++) {
+			if ((*it)->name == "A")
+				A = reinterpret_cast<El::AbstractDistMatrix<double> * >((*it)->p);
 		}
-		log->info("Completed truncated SVD task");
+
+		// Replicated entries would be counted more than once
+		bool distinct = (A->ColDist() == El::MC && A->RowDist() == El::MR) ||
+				((A->ColDist() == El::VR || A->ColDist() == El::VC) && A->RowDist() == El::STAR);
+		std::shared_ptr<ColumnStats> stats;
+		auto startStats = std::chrono::system_clock::now();
+		if (distinct) stats = get_column_stats(*A, sketch, sketch_rows, seed, cache);
+		else {
+			El::DistMatrix<double, El::VR, El::STAR> Arows(*A);
+			stats = get_column_stats(Arows, sketch, sketch_rows, seed, false);
+		}
+		std::chrono::duration<double, std::milli> stats_duration(std::chrono::system_clock::now() - startStats);
+		ctx.log->info("Computed column statistics in {} ms", stats_duration.count());
+
+		El::Matrix<double> mean, variance, min, max, norm;
+		El::Zeros(mean, n, 1);
+		El::Zeros(variance, n, 1);
+		El::Zeros(min, n, 1);
+		El::Zeros(max, n, 1);
+		El::Zeros(norm, n, 1);
+		for (El::Int j = 0; j < (El::Int) n; j++) {
+			mean.Set(j, 0, stats->mean[j]);
+			variance.Set(j, 0, stats->variance(j));
+			min.Set(j, 0, stats->min[j]);
+			max.Set(j, 0, stats->max[j]);
+			norm.Set(j, 0, stats->norm(j));
+		}
+
+		const El::Grid & grid = A->Grid();
+		out.push_back(std::make_shared<Parameter>("mean", DISTMATRIX_VR_STAR, keep_resident(distribute_replicated(pool, mean, grid))));
+		out.push_back(std::make_shared<Parameter>("variance", DISTMATRIX_VR_STAR, keep_resident(distribute_replicated(pool, variance, grid))));
+		out.push_back(std::make_shared<Parameter>("min", DISTMATRIX_VR_STAR, keep_resident(distribute_replicated(pool, min, grid))));
+		out.push_back(std::make_shared<Parameter>("max", DISTMATRIX_VR_STAR, keep_resident(distribute_replicated(pool, max, grid))));
+		out.push_back(std::make_shared<Parameter>("norm", DISTMATRIX_VR_STAR, keep_resident(distribute_replicated(pool, norm, grid))));
+		if (sketch != SKETCH_NONE)
+			out.push_back(std::make_shared<Parameter>("sketch", DISTMATRIX_VR_STAR, keep_resident(distribute_replicated(pool, stats->sketch_matrix, grid))));
 	}
+	MPI_Barrier(ctx.comm);
 
 	return 0;
 }
 
+int TestLib::run_sketched_lstsq(TaskContext & ctx, vector<Parameter_ptr> & in, vector<Parameter_ptr> & out)
+{
+	string sketch_name = "count";			// "count": CountSketch, "gaussian" or "srht"
+	uint32_t sketch_rows = 0;				// 0 for four times the number of columns
+	uint64_t seed = 0;
+	string solver = "direct";				// "direct": solve the sketched problem, "lsqr": use it to precondition LSQR
+	double tol = 1e-10;
+	uint32_t max_iterations = 100;
+	for (auto it = in.begin(); it != in.end(); it++) {
+		if ((*it)->name == "sketch")
+			sketch_name = * reinterpret_cast<string * >((*it)->p);
+		else if ((*it)->name == "sketch_rows")
+			sketch_rows = * reinterpret_cast<uint32_t * >((*it)->p);
+		else if ((*it)->name == "seed")
+			seed = * reinterpret_cast<uint64_t * >((*it)->p);
+		else if ((*it)->name == "solver")
+			solver = * reinterpret_cast<string * >((*it)->p);
+		else if ((*it)->name == "tol")
+			tol = * reinterpret_cast<double * >((*it)->p);
+		else if ((*it)->name == "max_iterations")
+			max_iterations = * reinterpret_cast<uint32_t * >((*it)->p);
+	}
+
+	uint64_t m, n, mb, k;
+	input_dims(ctx, in, "A", m, n);
+	input_dims(ctx, in, "b", mb, k);
+
+	uint8_t sketch;
+	if (sketch_name == "count") sketch = SKETCH_COUNT;
+	else if (sketch_name == "gaussian") sketch = SKETCH_GAUSSIAN;
+	else if (sketch_name == "srht") sketch = SKETCH_SRHT;
+	else {
+		ctx.log->error("Unknown sketch {}", sketch_name);
+		return -1;
+	}
+	if (solver != "direct" && solver != "lsqr") {
+		ctx.log->error("Unknown least-squares solver {}", solver);
+		return -1;
+	}
+	if (mb != m || m < n) {
+		ctx.log->error("sketched_lstsq needs a tall {}x{} matrix and a right-hand side of as many rows, not {}", m, n, mb);
+		return -1;
+	}
+	if (sketch_rows == 0) sketch_rows = (uint32_t) std::min(4 * n, m);
+	if (sketch_rows < n) {
+		ctx.log->error("A sketch of {} rows cannot embed {} columns", sketch_rows, n);
+		return -1;
+	}
+
+	// Iterations and residual, from the first worker
+	double result[3] = {0.0, 0.0, 0.0};
+
+	if (ctx.is_driver) {
+		ctx.log->info("Solving {}x{} least-squares problem with {} {}x{} sketch{}", m, n, sketch_name, sketch_rows, m,
+				(solver == "lsqr") ? " and preconditioned LSQR" : "");
+	}
+	else {
+		El::AbstractDistMatrix<double> * A = nullptr, * b = nullptr;
+		for (auto it = in.begin(); it != in.end(); it++) {
+			if ((*it)->name == "A")
+				A = reinterpret_cast<El::AbstractDistMatrix<double> * >((*it)->p);
+			else if ((*it)->name == "b")
+				b = reinterpret_cast<El::AbstractDistMatrix<double> * >((*it)->p);
+		}
+
+		// LSQR works on local rows of A and b, so both have to be distributed by rows, alike, and with
+		// the same row on the same process
+		bool aligned = (A->ColDist() == El::VR || A->ColDist() == El::VC) && A->RowDist() == El::STAR &&
+				b->ColDist() == A->ColDist() && b->RowDist() == El::STAR && b->ColAlign() == A->ColAlign();
+		std::unique_ptr<El::DistMatrix<double, El::VR, El::STAR> > Arows, brows;
+		if (!aligned) {
+			if (A->ColDist() != El::VR || A->RowDist() != El::STAR) {
+				Arows.reset(new El::DistMatrix<double, El::VR, El::STAR>(*A));
+				A = Arows.get();
+			}
+			brows.reset(new El::DistMatrix<double, El::VR, El::STAR>(A->Grid()));
+			brows->AlignWith(*A);
+			El::Copy(*b, *brows);
+			b = brows.get();
+		}
+
+		auto startSolve = std::chrono::system_clock::now();
+		El::Matrix<double> X;
+		LstsqInfo info;
+		bool solved = sketched_lstsq(*A, *b, sketch, sketch_rows, seed, (solver == "lsqr") ? max_iterations : 0, tol, X, info);
+		std::chrono::duration<double, std::milli> solve_duration(std::chrono::system_clock::now() - startSolve);
+
+		if (solved) {
+			ctx.log->info("Solved in {} ms, {} LSQR iterations, residual {}", solve_duration.count(), info.iterations, info.residual);
+			out.push_back(std::make_shared<Parameter>("x", DISTMATRIX_VR_STAR, keep_resident(distribute_replicated(pool, X, A->Grid()))));
+		}
+		else ctx.log->error("Sketch of A is rank deficient, use more sketch rows or remove dependent columns");
+
+		result[0] = (double) info.iterations;
+		result[1] = info.residual;
+		result[2] = (solved) ? 0.0 : 1.0;
+	}
+	MPI_Bcast(result, 3, MPI_DOUBLE, 1, ctx.comm);
+
+	if (ctx.is_driver && result[2] == 0.0) {
+		out.push_back(std::make_shared<Parameter>("iterations", UINT32, reinterpret_cast<void *>(ctx.arena->make<uint32_t>((uint32_t) result[0]))));
+		out.push_back(std::make_shared<Parameter>("residual", DOUBLE, reinterpret_cast<void *>(ctx.arena->make<double>(result[1]))));
+	}
+	MPI_Barrier(ctx.comm);
+
+	return (result[2] == 0.0) ? 0 : -1;
+}
+
+int TestLib::run_nmf(TaskContext & ctx, vector<Parameter_ptr> & in, vector<Parameter_ptr> & out)
+{
+	uint32_t rank = 0;
+	string algorithm = "hals";				// "hals": hierarchical alternating least squares, "mu": multiplicative updates
+	uint32_t max_iterations = 100;
+	double tol = 1e-4;						// Stop once the relative error changes by less than this fraction
+	uint64_t seed = 0;
+	for (auto it = in.begin(); it != in.end(); it++) {
+		if ((*it)->name == "rank")
+			rank = * reinterpret_cast<uint32_t * >((*it)->p);
+		else if ((*it)->name == "algorithm")
+			algorithm = * reinterpret_cast<string * >((*it)->p);
+		else if ((*it)->name == "max_iterations")
+			max_iterations = * reinterpret_cast<uint32_t * >((*it)->p);
+		else if ((*it)->name == "tol")
+			tol = * reinterpret_cast<double * >((*it)->p);
+		else if ((*it)->name == "seed")
+			seed = * reinterpret_cast<uint64_t * >((*it)->p);
+	}
+
+	uint64_t m, n;
+	input_dims(ctx, in, "A", m, n);
+
+	if (algorithm != "hals" && algorithm != "mu") {
+		ctx.log->error("Unknown NMF algorithm {}", algorithm);
+		return -1;
+	}
+	if (rank == 0 || rank > std::min(m, n)) {
+		ctx.log->error("Cannot factor {}x{} matrix with rank {}", m, n, rank);
+		return -1;
+	}
+
+	std::unique_ptr<El::DistMatrix<double, El::VR, El::STAR> > Arows;
+	std::unique_ptr<NMF> nmf;
+
+	// Smallest entry of A, from the first worker
+	double smallest = 0.0;
+
+	if (ctx.is_driver) {
+		ctx.log->info("Computing rank-{} nonnegative factorization of {}x{} matrix ({})", rank, m, n, algorithm);
+	}
+	else {
+		El::AbstractDistMatrix<double> * A = nullptr;
+		for (auto it = in.begin(); it != in.end(); it++) {
+			if ((*it)->name == "A")
+				A = reinterpret_cast<El::AbstractDistMatrix<double> * >((*it)->p);
+		}
+
+		// The factorization works on local rows, but the statistics of A may already be cached
+		bool row_distributed = A->ColDist() == El::VR && A->RowDist() == El::STAR;
+		bool distinct = row_distributed || (A->ColDist() == El::MC && A->RowDist() == El::MR) ||
+				(A->ColDist() == El::VC && A->RowDist() == El::STAR);
+		if (!row_distributed) Arows.reset(new El::DistMatrix<double, El::VR, El::STAR>(*A));
+		std::shared_ptr<ColumnStats> stats = get_column_stats((distinct) ? *A : *Arows);
+		if (!row_distributed) A = Arows.get();
+
+		double norm2 = 0.0, mean = 0.0;
+		smallest = (n > 0) ? stats->min[0] : 0.0;
+		for (El::Int j = 0; j < (El::Int) n; j++) {
+			norm2 += stats->norm(j) * stats->norm(j);
+			mean += stats->mean[j] / (double) n;
+			smallest = std::min(smallest, stats->min[j]);
+		}
+
+		// Uniform entries in [0, scale) make W*H match the mean of A on average
+		double scale = 2.0 * std::sqrt(std::max(mean, 0.0) / (double) rank);
+		if (smallest >= 0.0) nmf.reset(new NMF(pool, *A, (El::Int) rank, algorithm == "hals", seed, scale, norm2));
+	}
+	MPI_Bcast(&smallest, 1, MPI_DOUBLE, 1, ctx.comm);
+	if (smallest < 0.0) {
+		ctx.log->error("Cannot factor a matrix with negative entries, the smallest is {}", smallest);
+		return -1;
+	}
+
+	uint32_t iteration = 0;
+	double error = std::numeric_limits<double>::max();
+	bool cancelled = false;
+	while (iteration < max_iterations) {
+		// One small reduction carries the error to the driver, and its cancellation and the
+		// convergence of the workers to everybody
+		double state[3] = {0.0, 0.0, (ctx.cancel_requested()) ? 1.0 : 0.0};
+		if (!ctx.is_driver) {
+			double previous = error;
+			state[0] = nmf->iterate();
+			state[1] = (std::abs(previous - state[0]) <= tol * previous) ? 1.0 : 0.0;
+		}
+		MPI_Allreduce(MPI_IN_PLACE, state, 3, MPI_DOUBLE, MPI_MAX, ctx.comm);
+		iteration++;
+		error = state[0];
+
+		ctx.report(iteration, max_iterations, error);
+		if (ctx.is_driver && iteration % 20 == 0) ctx.log->info("Iteration {}, relative error {:.4e}", iteration, error);
+		if (state[2] != 0.0) {
+			cancelled = true;
+			break;
+		}
+		if (state[1] != 0.0) break;
+	}
+
+	if (cancelled) {
+		// The workers' handles end up cancelled too, rather than failed
+		if (ctx.handle != nullptr) ctx.handle->cancel();
+		ctx.log->info("Cancelled NMF after {} iterations", iteration);
+		MPI_Barrier(ctx.comm);
+		return -1;
+	}
+
+	if (ctx.is_driver) {
+		ctx.log->info("Finished NMF after {} iterations, relative error {:.4e}", iteration, error);
+		out.push_back(std::make_shared<Parameter>("iterations", UINT32, reinterpret_cast<void *>(ctx.arena->make<uint32_t>(iteration))));
+		out.push_back(std::make_shared<Parameter>("error", DOUBLE, reinterpret_cast<void *>(ctx.arena->make<double>(error))));
+	}
+	else {
+		out.push_back(std::make_shared<Parameter>("W", DISTMATRIX_VR_STAR, keep_resident(nmf->W)));
+		out.push_back(std::make_shared<Parameter>("H", DISTMATRIX_VR_STAR, keep_resident(distribute_replicated(pool, nmf->H, nmf->W->Grid()))));
+	}
+	MPI_Barrier(ctx.comm);
+
+	return 0;
+}
+
+int TestLib::run_cur(TaskContext & ctx, vector<Parameter_ptr> & in, vector<Parameter_ptr> & out)
+{
+	uint32_t num_columns = 0;
+	uint32_t num_rows = 0;					// Expected number of rows, num_columns by default
+	string selection = "random";			// "random": sample columns by leverage, "deterministic": take the largest scores
+	uint64_t seed = 0;
+	for (auto it = in.begin(); it != in.end(); it++) {
+		if ((*it)->name == "columns")
+			num_columns = * reinterpret_cast<uint32_t * >((*it)->p);
+		else if ((*it)->name == "rows")
+			num_rows = * reinterpret_cast<uint32_t * >((*it)->p);
+		else if ((*it)->name == "selection")
+			selection = * reinterpret_cast<string * >((*it)->p);
+		else if ((*it)->name == "seed")
+			seed = * reinterpret_cast<uint64_t * >((*it)->p);
+	}
+
+	uint64_t m, n, nv, k;
+	input_dims(ctx, in, "A", m, n);
+	input_dims(ctx, in, "V", nv, k);
+
+	if (selection != "random" && selection != "deterministic") {
+		ctx.log->error("Unknown column selection {}", selection);
+		return -1;
+	}
+	if (nv != n) {
+		ctx.log->error("V has {} rows, but A has {} columns", nv, n);
+		return -1;
+	}
+	if (num_columns == 0 || num_columns > n) {
+		ctx.log->error("Cannot select {} of {} columns", num_columns, n);
+		return -1;
+	}
+	if (num_rows == 0) num_rows = num_columns;
+
+	// Rows actually sampled, from the first worker
+	uint32_t sampled_rows = 0;
+
+	if (ctx.is_driver) {
+		ctx.log->info("Computing CUR decomposition of {}x{} matrix with {} columns and about {} rows, from rank-{} leverage scores",
+				m, n, num_columns, num_rows, k);
+	}
+	else {
+		El::AbstractDistMatrix<double> * A = nullptr, * V = nullptr;
+		for (auto it = in.begin(); it != in.end(); it++) {
+			if ((*it)->name == "A")
+				A = reinterpret_cast<El::AbstractDistMatrix<double> * >((*it)->p);
+			else if ((*it)->name == "V")
+				V = reinterpret_cast<El::AbstractDistMatrix<double> * >((*it)->p);
+		}
+
+		// Rows are sampled and copied locally
+		std::unique_ptr<El::DistMatrix<double, El::VR, El::STAR> > Arows, Vrows;
+		if (A->ColDist() != El::VR || A->RowDist() != El::STAR) {
+			Arows.reset(new El::DistMatrix<double, El::VR, El::STAR>(*A));
+			A = Arows.get();
+		}
+		bool distinct = ((V->ColDist() == El::VR || V->ColDist() == El::VC) && V->RowDist() == El::STAR) ||
+				(V->ColDist() == El::MC && V->RowDist() == El::MR);
+		if (!distinct) {
+			Vrows.reset(new El::DistMatrix<double, El::VR, El::STAR>(*V));
+			V = Vrows.get();
+		}
+
+		auto startCUR = std::chrono::system_clock::now();
+		std::vector<double> scores = leverage_scores(*V);
+		std::vector<El::Int> columns = select_columns(scores, (El::Int) num_columns, selection == "random", seed);
+
+		CURFactors factors;
+		cur(pool, *A, columns, (El::Int) num_rows, seed, factors);
+		std::chrono::duration<double, std::milli> cur_duration(std::chrono::system_clock::now() - startCUR);
+		sampled_rows = (uint32_t) factors.rows.size();
+		ctx.log->info("Selected {} columns and {} rows in {} ms", columns.size(), sampled_rows, cur_duration.count());
+
+		El::Matrix<double> column_indices, row_indices;
+		El::Zeros(column_indices, (El::Int) columns.size(), 1);
+		El::Zeros(row_indices, (El::Int) sampled_rows, 1);
+		for (size_t q = 0; q < columns.size(); q++) column_indices.Set((El::Int) q, 0, (double) columns[q]);
+		for (size_t q = 0; q < factors.rows.size(); q++) row_indices.Set((El::Int) q, 0, (double) factors.rows[q]);
+
+		const El::Grid & grid = A->Grid();
+		out.push_back(std::make_shared<Parameter>("C", DISTMATRIX_VR_STAR, keep_resident(factors.C)));
+		out.push_back(std::make_shared<Parameter>("U", DISTMATRIX_VR_STAR, keep_resident(distribute_replicated(pool, factors.U, grid))));
+		out.push_back(std::make_shared<Parameter>("R", DISTMATRIX_VR_STAR, keep_resident(distribute_replicated(pool, factors.R, grid))));
+		out.push_back(std::make_shared<Parameter>("column_indices", DISTMATRIX_VR_STAR, keep_resident(distribute_replicated(pool, column_indices, grid))));
+		out.push_back(std::make_shared<Parameter>("row_indices", DISTMATRIX_VR_STAR, keep_resident(distribute_replicated(pool, row_indices, grid))));
+	}
+	MPI_Bcast(&sampled_rows, 1, MPI_UNSIGNED, 1, ctx.comm);
+
+	if (ctx.is_driver)
+		out.push_back(std::make_shared<Parameter>("num_rows", UINT32, reinterpret_cast<void *>(ctx.arena->make<uint32_t>(sampled_rows))));
+	MPI_Barrier(ctx.comm);
+
+	return 0;
+}
+
+int TestLib::run_random_features(TaskContext & ctx, vector<Parameter_ptr> & in, vector<Parameter_ptr> & out)
+{
+	return run_kernel_features("random_features", ctx, in, out);
+}
+
+int TestLib::run_nystrom(TaskContext & ctx, vector<Parameter_ptr> & in, vector<Parameter_ptr> & out)
+{
+	return run_kernel_features("nystrom", ctx, in, out);
+}
+
+// "random_features" and "nystrom" differ only in how the features are computed
+int TestLib::run_kernel_features(const string & method, TaskContext & ctx, vector<Parameter_ptr> & in, vector<Parameter_ptr> & out)
+{
+	uint32_t num_features = 0;				// Random features, or landmarks for Nystrom
+	double gamma = 0.0;						// Of exp(-gamma |x - y|^2), 1/columns by default
+	uint64_t seed = 0;
+	for (auto it = in.begin(); it != in.end(); it++) {
+		if ((*it)->name == "features" || (*it)->name == "landmarks")
+			num_features = * reinterpret_cast<uint32_t * >((*it)->p);
+		else if ((*it)->name == "gamma")
+			gamma = * reinterpret_cast<double * >((*it)->p);
+		else if ((*it)->name == "seed")
+			seed = * reinterpret_cast<uint64_t * >((*it)->p);
+	}
+
+	uint64_t m, d;
+	input_dims(ctx, in, "A", m, d);
+
+	bool nystrom = method == "nystrom";
+	if (num_features == 0) {
+		ctx.log->error("{} needs the number of {}", method, (nystrom) ? "landmarks" : "features");
+		return -1;
+	}
+	if (gamma <= 0.0) gamma = 1.0 / (double) std::max(d, uint64_t(1));
+
+	// Features kept by Nystrom, from the first worker
+	uint32_t width = num_features;
+
+	if (ctx.is_driver) {
+		if (nystrom) ctx.log->info("Computing Nystrom features of {}x{} matrix from {} landmarks, gamma {}", m, d, num_features, gamma);
+		else ctx.log->info("Computing {} random Fourier features of {}x{} matrix, gamma {}", num_features, m, d, gamma);
+	}
+	else {
+		El::AbstractDistMatrix<double> * A = nullptr;
+		for (auto it = in.begin(); it != in.end(); it++) {
+			if ((*it)->name == "A")
+				A = reinterpret_cast<El::AbstractDistMatrix<double> * >((*it)->p);
+		}
+
+		// Features are computed from the local rows
+		std::unique_ptr<El::DistMatrix<double, El::VR, El::STAR> > Arows;
+		if (A->ColDist() != El::VR || A->RowDist() != El::STAR) {
+			Arows.reset(new El::DistMatrix<double, El::VR, El::STAR>(*A));
+			A = Arows.get();
+		}
+
+		auto startFeatures = std::chrono::system_clock::now();
+		std::shared_ptr<El::DistMatrix<double, El::VR, El::STAR> > Z;
+		if (nystrom) Z = nystrom_features(pool, *A, (El::Int) num_features, gamma, seed);
+		else Z = random_fourier_features(pool, *A, (El::Int) num_features, gamma, seed);
+		std::chrono::duration<double, std::milli> features_duration(std::chrono::system_clock::now() - startFeatures);
+		width = (uint32_t) Z->Width();
+		ctx.log->info("Computed {}x{} features in {} ms", m, width, features_duration.count());
+
+		out.push_back(std::make_shared<Parameter>("Z", DISTMATRIX_VR_STAR, keep_resident(Z)));
+	}
+	if (nystrom) MPI_Bcast(&width, 1, MPI_UNSIGNED, 1, ctx.comm);
+
+	if (ctx.is_driver)
+		out.push_back(std::make_shared<Parameter>("num_features", UINT32, reinterpret_cast<void *>(ctx.arena->make<uint32_t>(width))));
+	MPI_Barrier(ctx.comm);
+
+	return 0;
+}
+
+// How truncated_svd computes products with A'*A: 0 forms A'*(A*x) from A every time, 1 keeps the
+// Gramian of the local rows of A on every worker, 3 sums the local Gramians once and leaves a block
+// of columns of A'*A on each worker
+static uint8_t svd_method(const string & gram)
+{
+	if (gram == "none") return 0;
+	if (gram == "distributed") return 3;
+	return 1;
+}
+
+// Whether the square roots of two sets of Ritz values of A'*A agree to within tol relative to the new
+// ones; false if there is no previous set
+static bool singular_values_settled(const std::vector<double> & previous, const std::vector<double> & current, double tol)
+{
+	if (previous.size() != current.size() || current.empty()) return false;
+	for (size_t i = 0; i < current.size(); i++) {
+		double before = std::sqrt(std::max(previous[i], 0.0)), now = std::sqrt(std::max(current[i], 0.0));
+		if (std::abs(now - before) > tol * now) return false;
+	}
+	return true;
+}
+
+// Entries after the eigenvalues in the summary that truncated_svd broadcasts: the number of
+// converged eigenvalues, the implicit restarts and the products with A'*A
+static const uint32_t CONVERGENCE_FIELDS = 3;
+
+// Datatype of the layouts truncated_svd can build V in, NONE for any other
+static datatype replicated_layout(const string & layout)
+{
+	if (layout == "VR_STAR") return DISTMATRIX_VR_STAR;
+	if (layout == "VC_STAR") return DISTMATRIX_VC_STAR;
+	if (layout == "MC_MR") return DISTMATRIX_MC_MR;
+	if (layout == "STAR_STAR") return DISTMATRIX_STAR_STAR;
+	return NONE;
+}
+
+// Whether name is one of the entries of a comma-separated list, ignoring blanks around entries
+static bool in_list(const string & list, const string & name)
+{
+	size_t begin = 0;
+	while (begin <= list.size()) {
+		size_t end = std::min(list.find(',', begin), list.size());
+		size_t first = list.find_first_not_of(" \t", begin);
+		size_t last = list.find_last_not_of(" \t", (end > 0) ? end - 1 : 0);
+		if (first < end && last != string::npos && last >= first && list.compare(first, last - first + 1, name) == 0) return true;
+		begin = end + 1;
+	}
+	return false;
+}
+
+// Outputs of truncated_svd with small_outputs = "array", on every process: the singular values if
+// wanted, the eigenvalues of A'*A and the convergence summary
+static void push_svd_arrays(TaskContext & ctx, const std::vector<double> & summary, uint32_t nconv, bool want_S,
+		vector<Parameter_ptr> & out)
+{
+	ArrayBlockDouble * S = ctx.arena->make<ArrayBlockDouble>(std::vector<uint64_t>{nconv});
+	ArrayBlockDouble * eigenvalues = ctx.arena->make<ArrayBlockDouble>(std::vector<uint64_t>{nconv});
+	ArrayBlockDouble * convergence = ctx.arena->make<ArrayBlockDouble>(std::vector<uint64_t>{CONVERGENCE_FIELDS});
+	for (uint32_t idx = 0; idx < nconv; idx++) {
+		eigenvalues->data[idx] = summary[idx];
+		S->data[idx] = std::sqrt(std::max(summary[idx], 0.0));
+	}
+	std::copy(summary.begin() + nconv, summary.end(), convergence->data.begin());
+
+	if (want_S) out.push_back(std::make_shared<Parameter>("S", ARRAY_BLOCK_DOUBLE, reinterpret_cast<void *>(S)));
+	out.push_back(std::make_shared<Parameter>("eigenvalues", ARRAY_BLOCK_DOUBLE, reinterpret_cast<void *>(eigenvalues)));
+	out.push_back(std::make_shared<Parameter>("convergence", ARRAY_BLOCK_DOUBLE, reinterpret_cast<void *>(convergence)));
+}
+
+// Start vector of truncated_svd on the driver, from "v0", an array of n entries on every process, or
+// from "initial_subspace", a distributed matrix with n rows whose columns are summed; empty if neither
+// is given. Collective over ctx with initial_subspace.
+static int warm_start(TaskContext & ctx, vector<Parameter_ptr> & in, uint64_t n, std::vector<double> & start)
+{
+	const ArrayBlockDouble * v0 = nullptr;
+	El::AbstractDistMatrix<double> * subspace = nullptr;
+	bool from_subspace = false;
+	for (auto it = in.begin(); it != in.end(); it++) {
+		if ((*it)->name == "v0") {
+			v0 = reinterpret_cast<const ArrayBlockDouble * >((*it)->p);
+		}
+		else if ((*it)->name == "initial_subspace") {
+			from_subspace = true;
+			if (!ctx.is_driver) subspace = reinterpret_cast<El::AbstractDistMatrix<double> * >((*it)->p);
+		}
+	}
+
+	if (from_subspace) {
+		// Every entry is counted once, by the processes that hold its first copy
+		std::vector<double> sum(n, 0.0);
+		if (subspace != nullptr && subspace->Height() != (El::Int) n)
+			ctx.log->warn("initial_subspace has {} rows, but A has {} columns; starting from a random vector", subspace->Height(), n);
+		else if (subspace != nullptr && subspace->RedundantRank() == 0) {
+			const El::Matrix<double> & local = subspace->LockedMatrix();
+			for (El::Int jl = 0; jl < local.Width(); jl++)
+				for (El::Int il = 0; il < local.Height(); il++) sum[subspace->GlobalRow(il)] += local.Get(il, jl);
+		}
+		MPI_Reduce((ctx.is_driver) ? MPI_IN_PLACE : sum.data(), sum.data(), (int) n, MPI_DOUBLE, MPI_SUM, 0, ctx.comm);
+		if (ctx.is_driver) start.swap(sum);
+	}
+	else if (v0 != nullptr) {
+		if (v0->size() != n) {
+			ctx.log->error("v0 has {} entries, but A has {} columns", v0->size(), n);
+			return -1;
+		}
+		if (ctx.is_driver) start = v0->data;
+	}
+
+	// A zero vector would make ARPACK stop at once
+	if (std::all_of(start.begin(), start.end(), [](double x) { return x == 0.0; })) start.clear();
+	return 0;
+}
+
+int TestLib::run_truncated_svd(TaskContext & ctx, vector<Parameter_ptr> & in, vector<Parameter_ptr> & out)
+{
+	uint64_t m, n;
+	input_dims(ctx, in, "A", m, n);
+
+	// Set when the driver broadcasts command 3; every process then leaves the command loop
+	bool cancelled = false;
+
+	// Phases of the run, returned by the driver: the Arnoldi iterations and the broadcast of the
+	// eigenvectors are timed on the driver, the Gramian and U on the slowest worker
+	uint32_t matvecs = 0;
+	double gram_ms = 0.0, arnoldi_ms = 0.0, broadcast_ms = 0.0, u_ms = 0.0;
+
+	// How the results come back, read on every process
+	string V_layout = "VR_STAR";
+	bool arrays = false;
+	string outputs = "U,S,V";
+	for (auto it = in.begin(); it != in.end(); it++) {
+		if ((*it)->name == "V_layout") {
+			V_layout = * reinterpret_cast<string * >((*it)->p);
+		}
+		else if ((*it)->name == "outputs") {
+			outputs = * reinterpret_cast<string * >((*it)->p);
+		}
+		else if ((*it)->name == "small_outputs") {
+			arrays = (* reinterpret_cast<string * >((*it)->p) == "array");
+		}
+	}
+	datatype V_type = replicated_layout(V_layout);
+	if (V_type == NONE) {
+		ctx.log->error("truncated_svd: V_layout must be VR_STAR, VC_STAR, MC_MR or STAR_STAR, not {}", V_layout);
+		return -1;
+	}
+	bool want_U = in_list(outputs, "U"), want_S = in_list(outputs, "S"), want_V = in_list(outputs, "V");
+	bool want_operator = in_list(outputs, "U_operator");
+
+	// Warm start on the driver: v0 as given, or the sum of the columns of initial_subspace, typically
+	// V from an earlier run
+	std::vector<double> warmStart;
+	if (warm_start(ctx, in, n, warmStart) != 0) return -1;
+
+	if (ctx.is_driver) {
+
+		int rank = 0;
+		string checkpoint_dir = "";
+		uint32_t checkpoint_interval = 0;
+		double checkpoint_seconds = 0.0;
+		string resume_from = "";
+		string gram = "local";
+		string collectives = "flat";
+		double tol = 0.0;						// ARPACK's relative error bound, machine precision by default
+		uint32_t max_iterations = 0;			// Implicit restarts, 100*rank by default
+		uint32_t ncv = 0;						// Krylov subspace size, 2*rank+1 by default
+		double ritz_tol = 0.0;					// Stop once the singular values move less than this between restarts
+
+		for (auto it = in.begin(); it != in.end(); it++) {
+			if ((*it)->name == "rank") {
+				rank = (int) * reinterpret_cast<uint32_t * >((*it)->p);
+			}
+			else if ((*it)->name == "tol") {
+				tol = * reinterpret_cast<double * >((*it)->p);
+			}
+			else if ((*it)->name == "max_iterations") {
+				max_iterations = * reinterpret_cast<uint32_t * >((*it)->p);
+			}
+			else if ((*it)->name == "ncv") {
+				ncv = * reinterpret_cast<uint32_t * >((*it)->p);
+			}
+			else if ((*it)->name == "ritz_tol") {
+				ritz_tol = * reinterpret_cast<double * >((*it)->p);
+			}
+			else if ((*it)->name == "gram") {
+				gram = * reinterpret_cast<string * >((*it)->p);
+			}
+			else if ((*it)->name == "collectives") {
+				collectives = * reinterpret_cast<string * >((*it)->p);
+			}
+			else if ((*it)->name == "checkpoint_dir") {
+				checkpoint_dir = * reinterpret_cast<string * >((*it)->p);
+			}
+			else if ((*it)->name == "checkpoint_interval") {
+				checkpoint_interval = * reinterpret_cast<uint32_t * >((*it)->p);
+			}
+			else if ((*it)->name == "checkpoint_seconds") {
+				checkpoint_seconds = * reinterpret_cast<double * >((*it)->p);
+			}
+			else if ((*it)->name == "resume_from") {
+				resume_from = * reinterpret_cast<string * >((*it)->p);
+			}
+		}
+
+
+		uint8_t method = svd_method(gram);
+
+		if (rank > m) rank = m;
+		if (rank > n) rank = n;
+		// ARPACK needs rank < ncv <= n
+		if (ncv != 0) ncv = (uint32_t) std::min((uint64_t) std::max(ncv, (uint32_t) rank + 1), n);
+
+		ctx.log->info("Starting truncated SVD on {}x{} matrix", m, n);
+		ctx.log->info("Settings:");
+		ctx.log->info("    rank = {}", rank);
+		if (tol > 0.0) ctx.log->info("    tol = {}", tol);
+		if (max_iterations > 0) ctx.log->info("    max_iterations = {}", max_iterations);
+		if (ncv > 0) ctx.log->info("    ncv = {}", ncv);
+		if (ritz_tol > 0.0) ctx.log->info("    ritz_tol = {}", ritz_tol);
+
+		MPI_Barrier(ctx.comm);
+
+		//	int LOCALEIGS = 0; // TODO: make these an enumeration, and global to Alchemist
+		//	int LOCALEIGSPRECOMPUTE = 1;
+		//	int DISTEIGS = 2;
+
+		switch(method) {
+		case 3:
+			ctx.log->info("Using distributed matrix-vector products against A'*A, summed into one block of columns per worker");
+			break;
+		case 2:
+			ctx.log->info("Using distributed matrix-vector products against A, then A tranpose");
+			break;
+		case 1:
+			ctx.log->info("Using local matrix-vector products against the precomputed local Gramians");
+			break;
+		case 0:
+			ctx.log->info("Using local matrix-vector products A'*(A*x) computed on the fly");
+			break;
+		}
+
+		// Warm start from the Ritz subspace saved by an earlier run on the same matrix. ARPACK starts
+		// afresh, so the products are counted from zero.
+		uint32_t iterNum = 0;
+		std::vector<double> startVector;
+		if (!resume_from.empty()) {
+			ArnoldiCheckpoint checkpoint;
+			if (!read_checkpoint(resume_from, checkpoint))
+				ctx.log->warn("Could not read checkpoint {}, starting from a random vector", resume_from);
+			else if (checkpoint.n != n)
+				ctx.log->warn("Checkpoint {} is for a matrix with {} columns, starting from a random vector", resume_from, checkpoint.n);
+			else {
+				startVector = checkpoint.start_vector();
+				ctx.log->info("Warm-starting from checkpoint {}, saved after {} matrix-vector products", resume_from, checkpoint.matvecs);
+			}
+		}
+		if (startVector.empty() && !warmStart.empty()) {
+			startVector.swap(warmStart);
+			ctx.log->info("Starting from the given subspace");
+		}
+
+		string checkpoint_path = "";
+		if (!checkpoint_dir.empty()) {
+			checkpoint_path = checkpoint_dir + "/truncated_svd_" + std::to_string(m) + "x" + std::to_string(n) + "_k" + std::to_string(rank) + ".ckpt";
+			if (checkpoint_interval == 0 && checkpoint_seconds <= 0.0) checkpoint_interval = 100;
+			ctx.log->info("    checkpoint = {} (every {} products or {} s)", checkpoint_path, checkpoint_interval, checkpoint_seconds);
+		}
+		AsyncCheckpointWriter checkpointer(checkpoint_path, checkpoint_interval, checkpoint_seconds);
+
+		CheckpointableSymStdEig prob((int) n, rank, "LM", (int) ncv, tol, (int) max_iterations, startVector.empty() ? nullptr : startVector.data());
+		uint8_t command;
+		std::vector<double> zerosVector(n);
+		for (uint32_t idx = 0; idx < n; idx++)
+			zerosVector[idx] = 0.0;
+
+		// Stage the Krylov vectors through shared memory on every node
+		std::unique_ptr<NodeCollectives> nodeShared;
+		if (collectives == "node") {
+			nodeShared.reset(new NodeCollectives(ctx.comm, (int) n, 0));
+			ctx.log->info("Using node-shared collectives over {} nodes with {} processes on this one", nodeShared->num_nodes(), nodeShared->ranks_per_node());
+		}
+
+		// Block of the product that each process returns, for method 3
+		std::vector<int> blockCounts(ctx.size), blockOffsets(ctx.size);
+		int noBlock[2] = {0, 0};
+		MPI_Gather(noBlock, 1, MPI_INT, blockCounts.data(), 1, MPI_INT, 0, ctx.comm);
+		MPI_Gather(noBlock + 1, 1, MPI_INT, blockOffsets.data(), 1, MPI_INT, 0, ctx.comm);
+
+		auto startArnoldi = std::chrono::system_clock::now();
+		// Upper bound: the allowed restarts (ARPACK's default is 100*nev), each extending the basis by ncv-nev vectors
+		uint64_t maxRestarts = (max_iterations > 0) ? (uint64_t) max_iterations : 100 * (uint64_t) rank;
+		uint64_t maxIterNum = (uint64_t) prob.GetNcv() + maxRestarts * (uint64_t) (prob.GetNcv() - rank);
+
+		// The Ritz values only change at restarts; once every wanted one has moved by less than ritz_tol
+		// since the previous restart, ARPACK is told to accept them at the end of the next
+		std::vector<double> previousRitz;
+		bool accepted = false;
+
+		while (!prob.ArnoldiBasisFound()) {
+			prob.TakeStep();
+			++iterNum;
+			double residual = prob.residual_estimate();
+			ctx.report(iterNum, maxIterNum, residual, prob.target_residual());
+			if (ritz_tol > 0.0 && !accepted) {
+				std::vector<double> ritz = prob.wanted_ritz_values();
+				if (!ritz.empty() && ritz != previousRitz) {
+					if (singular_values_settled(previousRitz, ritz, ritz_tol)) {
+						prob.accept_at_next_restart();
+						accepted = true;
+						ctx.log->info("Singular values settled to {} after {} matrix-vector products, residual estimate {:.3e}", ritz_tol, iterNum, residual);
+					}
+					previousRitz = ritz;
+				}
+			}
+			if (iterNum % 20 == 0) ctx.log->info("Computed {} matrix-vector products, residual estimate {:.3e}", iterNum, residual);
+			// The basis is only fully populated once the first Lanczos factorization is complete
+			if (iterNum > (uint32_t) prob.GetNcv() && checkpointer.due(iterNum))
+				checkpointer.write(prob.snapshot(iterNum));
+			if (prob.GetIdo() == 1 || prob.GetIdo() == -1) {
+				// The command broadcast doubles as the cancellation point, so stopping costs no extra collective
+				command = (ctx.cancel_requested()) ? 3 : 1;
+
+				MPI_Bcast(&command, 1, MPI_UNSIGNED_CHAR, 0, ctx.comm);
+				if (command == 3) {
+					cancelled = true;
+					break;
+				}
+				if (nodeShared) std::memcpy(nodeShared->vector(), prob.GetVector(), n * sizeof(double));
+				if ((method == 0 || method == 1) && nodeShared) {
+					nodeShared->broadcast();
+					nodeShared->reduce(prob.PutVector());
+				}
+				else if (method == 0 || method == 1) {
+					auto temp = prob.GetVector();
+					MPI_Bcast(prob.GetVector(), n, MPI_DOUBLE, 0, ctx.comm);
+					MPI_Reduce(zerosVector.data(), prob.PutVector(), n, MPI_DOUBLE, MPI_SUM, 0, ctx.comm);
+					auto temp1 = prob.GetVector();
+				}
+				if (method == 3) {
+					if (nodeShared) nodeShared->broadcast();
+					else MPI_Bcast(prob.GetVector(), n, MPI_DOUBLE, 0, ctx.comm);
+					MPI_Gatherv(nullptr, 0, MPI_DOUBLE, prob.PutVector(), blockCounts.data(), blockOffsets.data(), MPI_DOUBLE, 0, ctx.comm);
+				}
+				if (method == 2) {
+	//				MPI_Status status;
+	//				MPI_Send(prob.GetVector(), n, MPI_DOUBLE, 1, 0, group);
+	//				MPI_Recv(prob.PutVector(), n, MPI_DOUBLE, 1, 0, group, status);
+	////				world.send(1, 0, prob.GetVector(), n);
+	////				world.recv(1, 0, prob.PutVector(), n);
+				}
+			}
+		}
+
+		checkpointer.wait();
+		if (cancelled) {
+			// Leave a checkpoint behind, so a later run can be warm-started with resume_from
+			if (checkpointer.enabled() && iterNum > (uint32_t) prob.GetNcv()) {
+				checkpointer.write(prob.snapshot(iterNum));
+				checkpointer.wait();
+				ctx.log->info("Saved the Arnoldi state in {}", checkpointer.get_path());
+			}
+			ctx.log->info("Cancelled truncated SVD after {} matrix-vector products", iterNum);
+			MPI_Barrier(ctx.comm);
+			return -1;
+		}
+		if (checkpointer.enabled())
+			ctx.log->info("Wrote {} checkpoints to {}", checkpointer.num_written(), checkpointer.get_path());
+
+		prob.FindEigenvectors();
+		uint32_t nconv = prob.ConvergedEigenvalues();
+		uint32_t niters = prob.GetIter();
+		matvecs = iterNum;
+		arnoldi_ms = std::chrono::duration<double, std::milli>(std::chrono::system_clock::now() - startArnoldi).count();
+		ctx.log->info("Done after {} Arnoldi iterations, converged to {} eigenvectors of size {}", niters, nconv, n);
+
+		// The eigenvalues, then the number converged, the restarts and the products, for one broadcast
+		std::vector<double> summary(nconv + CONVERGENCE_FIELDS);
+		std::copy(prob.RawEigenvalues(), prob.RawEigenvalues() + nconv, summary.begin());
+		summary[nconv] = nconv;
+		summary[nconv + 1] = niters;
+		summary[nconv + 2] = matvecs;
+
+		// Populate U, V, S. ARPACK keeps the eigenvectors in one n x nconv column-major block, which
+		// is broadcast as it is if the workers need all of it, and otherwise scattered by rows
+		// NB: it may be the case that n*nconv > 4 GB, then have to be careful!
+		auto startBroadcast = std::chrono::system_clock::now();
+		command = 2;
+		MPI_Bcast(&command, 1, MPI_UNSIGNED_CHAR, 0, ctx.comm);
+		MPI_Bcast(&nconv, 1, MPI_UNSIGNED, 0, ctx.comm);
+	//	mpi::broadcast(world, nconv, 0);
+		ctx.log->info("Broadcasted command and number of converged eigenvectors");
+		int replicate = 0;
+		MPI_Allreduce(MPI_IN_PLACE, &replicate, 1, MPI_INT, MPI_MAX, ctx.comm);
+		if (replicate) {
+			if (nconv > 0) MPI_Bcast(prob.RawEigenvector(0), n*nconv, MPI_DOUBLE, 0, ctx.comm);
+		//	mpi::broadcast(world, rightVecs.data(), n*nconv, 0);
+			ctx.log->info("Broadcasted right eigenvectors");
+		}
+		else {
+			scatter_rows(ctx.comm, (nconv > 0) ? prob.RawEigenvector(0) : nullptr, n, nconv, n, 0);
+			ctx.log->info("Scattered the rows of the right eigenvectors");
+		}
+		MPI_Bcast(summary.data(), nconv + CONVERGENCE_FIELDS, MPI_DOUBLE, 0, ctx.comm);
+		ctx.log->info("Broadcasted eigenvalues");
+		broadcast_ms = std::chrono::duration<double, std::milli>(std::chrono::system_clock::now() - startBroadcast).count();
+
+		if (arrays) push_svd_arrays(ctx, summary, nconv, want_S, out);
+
+		ctx.log->info("Waiting on workers to store U, S, and V");
+
+		MPI_Barrier(ctx.comm);
+	}
+	else {
+		int rank = 0;
+		DistMatrix * A = nullptr;
+		string gram = "local";
+		string collectives = "flat";
+
+		for (auto it = in.begin(); it != in.end(); it++) {
+			if ((*it)->name == "rank") {
+				rank = (int) * reinterpret_cast<uint32_t * >((*it)->p);
+			}
+			else if ((*it)->name == "A") {
+				A = reinterpret_cast<DistMatrix * >((*it)->p);
+			}
+			else if ((*it)->name == "gram") {
+				gram = * reinterpret_cast<string * >((*it)->p);
+			}
+			else if ((*it)->name == "collectives") {
+				collectives = * reinterpret_cast<string * >((*it)->p);
+			}
+		}
+
+//		for (auto it = in.begin(); it != in.end(); it++) {
+//			if ((*it)->name == "rank") {
+//				rank = (int) * (* reinterpret_cast<std::shared_ptr<uint32_t> * >((*it)->p));
+//			}
+//			else if ((*it)->name == "A") {
+//				A = * (* reinterpret_cast<std::shared_ptr<DistMatrix_ptr> * >((*it)->p));
+//			}
+//		}
+
+		uint8_t method = svd_method(gram);
+
+		const El::Grid & grid = A->Grid();
+
+		int m = A->Height();
+		int n = A->Width();
+
+		if (rank > m) rank = m;
+		if (rank > n) rank = n;
+
+		MPI_Barrier(ctx.comm);
+
+		ctx.log->info("Starting truncated SVD");
+
+		//	  int LOCALEIGS = 0; // TODO: make these an enumeration, and global to Alchemist
+		//	  int LOCALEIGSPRECOMPUTE = 1;
+		//	  int DISTEIGS = 2;
+
+		// Assume matrix is row-partitioned b/c relaying it out doubles memory requirements
+
+		//NB: sometimes it makes sense to precompute the gramMat (when it's cheap (we have a lot of cores and enough memory), sometimes
+		// it makes more sense to compute A'*(A*x) separately each time (when we don't have enough memory for gramMat, or its too expensive
+		// time-wise to precompute GramMat). trade-off depends on k (through the number of Arnoldi iterations we'll end up needing), the
+		// amount of memory we have free to store GramMat, and the number of cores we have available
+		El::Matrix<double> localGramChunk;
+		std::shared_ptr<double> localGramBuffer;
+
+		auto startGram = std::chrono::system_clock::now();
+		if (method == 1) {
+			localGramBuffer = pool->acquire((size_t) n * n);
+			attach_pooled(localGramChunk, localGramBuffer, n, n);
+			first_touch(localGramChunk);
+			ctx.log->info("Computing the local contribution to A'*A");
+			ctx.log->info("Local matrix's dimensions are {}x{}", A->LockedMatrix().Height(), A->LockedMatrix().Width());
+			ctx.log->info("Storing A'*A in {}x{} matrix", n, n);
+			auto startFillLocalMat = std::chrono::system_clock::now();
+			if (A->LockedMatrix().Height() > 0)
+				El::Gemm(El::TRANSPOSE, El::NORMAL, 1.0, A->LockedMatrix(), A->LockedMatrix(), 0.0, localGramChunk);
+			else
+				El::Zeros(localGramChunk, n, n);
+			std::chrono::duration<double, std::milli> fillLocalMat_duration(std::chrono::system_clock::now() - startFillLocalMat);
+			ctx.log->info("Took {} ms to compute local contribution to A'*A", fillLocalMat_duration.count());
+		}
+
+		// With method 3 worker w ends up with columns [n*w/p, n*(w+1)/p) of A'*A, summed onto it one
+		// panel at a time, so no worker ever holds the full local Gramian. As A'*A is symmetric, these
+		// columns are also its rows, and a product needs only one local Gemv on n*n/p entries.
+		El::Matrix<double> gramColumns;
+		std::shared_ptr<double> gramColumnsBuffer;
+		int blockCount = 0, blockOffset = 0;
+		if (method == 3) {
+			MPI_Comm workerComm = grid.Comm().comm;
+			int numWorkers, workerRank;
+			MPI_Comm_size(workerComm, &numWorkers);
+			MPI_Comm_rank(workerComm, &workerRank);
+
+			blockOffset = (int) (((int64_t) n * workerRank) / numWorkers);
+			blockCount = (int) (((int64_t) n * (workerRank + 1)) / numWorkers) - blockOffset;
+
+			gramColumnsBuffer = pool->acquire((size_t) n * std::max(blockCount, 1));
+			attach_pooled(gramColumns, gramColumnsBuffer, n, blockCount);
+			first_touch(gramColumns);
+
+			auto startReduce = std::chrono::system_clock::now();
+			for (int w = 0; w < numWorkers; w++) {
+				int offset = (int) (((int64_t) n * w) / numWorkers);
+				int count = (int) (((int64_t) n * (w + 1)) / numWorkers) - offset;
+				reduce_gram_columns(pool, A->LockedMatrix(), offset, 1, count, w, workerComm, gramColumns.Buffer());
+			}
+			std::chrono::duration<double, std::milli> reduce_duration(std::chrono::system_clock::now() - startReduce);
+			ctx.log->info("Took {} ms to compute and reduce A'*A, keeping columns {} to {}", reduce_duration.count(), blockOffset, blockOffset + blockCount);
+		}
+		gram_ms = std::chrono::duration<double, std::milli>(std::chrono::system_clock::now() - startGram).count();
+
+		uint8_t command;
+		El::Int localm = A->LocalHeight();
+		// Scratch comes from the pool and goes back when the task ends, not with the outputs
+		std::shared_ptr<double> vecInBuffer = pool->acquire((size_t) n);
+		std::shared_ptr<double> intermedBuffer = pool->acquire((size_t) std::max(localm, El::Int(1)));
+		std::shared_ptr<double> localyBuffer = pool->acquire((size_t) n);
+		double * vecIn = vecInBuffer.get();
+		El::Matrix<double> localx, localintermed, localy;
+		attach_pooled(localintermed, intermedBuffer, localm, 1);
+		attach_pooled(localy, localyBuffer, n, 1);
+		first_touch(vecIn, n);
+		first_touch(localintermed);
+		first_touch(localy);
+		localx.LockedAttach(n, 1, vecIn, 1);
+
+		// With node-shared collectives x is read where the node leader received it, and the products
+		// are written straight into shared memory for the node to sum
+		std::unique_ptr<NodeCollectives> nodeShared;
+		if (collectives == "node") {
+			nodeShared.reset(new NodeCollectives(ctx.comm, (int) n, 0));
+			localx.LockedAttach(n, 1, nodeShared->vector(), n);
+			localy.Attach(n, 1, nodeShared->contribution(), n);
+		}
+		El::Matrix<double> localBlock;
+		std::shared_ptr<double> localBlockBuffer;
+		if (method == 3) {
+			localBlockBuffer = pool->acquire((size_t) std::max(blockCount, 1));
+			attach_pooled(localBlock, localBlockBuffer, blockCount, 1);
+			first_touch(localBlock);
+		}
+		std::unique_ptr<DistMatrix> distx, distintermed;
+		if (method == 2) {
+			distx.reset(new DistMatrix(n, 1, grid));
+			distintermed.reset(new DistMatrix(m, 1, grid));
+		}
+	//	auto distx = El::DistMatrix<double, El::STAR, El::STAR>(n, 1, self->grid);
+	//	auto distintermed = El::DistMatrix<double, El::STAR, El::STAR>(m, 1, self->grid);
+
+		MPI_Gather(&blockCount, 1, MPI_INT, nullptr, 1, MPI_INT, 0, ctx.comm);
+		MPI_Gather(&blockOffset, 1, MPI_INT, nullptr, 1, MPI_INT, 0, ctx.comm);
+
+		ctx.log->info("Finished initialization for truncated SVD");
+
+		while(true) {
+			MPI_Bcast(&command, 1, MPI_UNSIGNED_CHAR, 0, ctx.comm);
+	//		mpi::broadcast(self->world, command, 0);
+			if (command == 1 && method == 0) {
+				void * uut;
+				if (nodeShared) nodeShared->broadcast();
+				else MPI_Bcast(vecIn, n, MPI_DOUBLE, 0, ctx.comm);
+				El::Gemv(El::NORMAL, 1.0, A->LockedMatrix(), localx, 0.0, localintermed);
+				El::Gemv(El::TRANSPOSE, 1.0, A->LockedMatrix(), localintermed, 0.0, localy);
+				if (nodeShared) nodeShared->reduce(nullptr);
+				else MPI_Reduce(localy.LockedBuffer(), uut, n, MPI_DOUBLE, MPI_SUM, 0, ctx.comm);
+			}
+			if (command == 1 && method == 1) {
+				if (nodeShared) nodeShared->broadcast();
+				else MPI_Bcast(vecIn, n, MPI_DOUBLE, 0, ctx.comm);
+				void * uut;
+				// A'*A is symmetric, so the transposed product, which reads down the contiguous columns, gives the same result
+				El::Gemv(El::TRANSPOSE, 1.0, localGramChunk, localx, 0.0, localy);
+				if (nodeShared) nodeShared->reduce(nullptr);
+				else MPI_Reduce(localy.LockedBuffer(), uut, n, MPI_DOUBLE, MPI_SUM, 0, ctx.comm);
+			}
+			if (command == 1 && method == 3) {
+				if (nodeShared) nodeShared->broadcast();
+				else MPI_Bcast(vecIn, n, MPI_DOUBLE, 0, ctx.comm);
+				El::Gemv(El::TRANSPOSE, 1.0, gramColumns, localx, 0.0, localBlock);
+				MPI_Gatherv(localBlock.LockedBuffer(), blockCount, MPI_DOUBLE, nullptr, nullptr, nullptr, MPI_DOUBLE, 0, ctx.comm);
+			}
+			if (command == 1 && method == 2) {
+	//			El::Zeros(distx, n, 1);
+	//			log->info("Computing a mat-vec prod against A^TA");
+	//			if (self->world.rank() == 1) {
+	//				self->world.recv(0, 0, vecIn.get(), n);
+	//				distx.Reserve(n);
+	//				for(El::Int row=0; row < n; row++)
+	//					distx.QueueUpdate(row, 0, vecIn[row]);
+	//			}
+	//			else {
+	//				distx.Reserve(0);
+	//			}
+	//			distx.ProcessQueues();
+	//			log->info("Retrieved x, computing A^TAx");
+	//			El::Gemv(El::NORMAL, 1.0, *workingMat, distx, 0.0, distintermed);
+	//			log->info("Computed y = A*x");
+	//			El::Gemv(El::TRANSPOSE, 1.0, *workingMat, distintermed, 0.0, distx);
+	//			log->info("Computed x = A^T*y");
+	//			if(self->world.rank() == 1) {
+	//				world.send(0, 0, distx.LockedBuffer(), n);
+	//			}
+			}
+			if (command == 3) {
+				if (ctx.handle != nullptr) ctx.handle->cancel();
+				cancelled = true;
+				break;
+			}
+			if (command == 2) {
+				uint32_t nconv;
+				MPI_Bcast(&nconv, 1, MPI_UNSIGNED, 0, ctx.comm);
+
+				// Forming U from the local rows of A, or keeping it as an operator, needs the right
+				// eigenvectors in full on every worker, and so does V in [STAR,STAR]. Otherwise each
+				// worker only receives its rows of V.
+				bool rowsOfA = A->ColDist() == El::VR && A->RowDist() == El::STAR;
+				// On any other layout of A the operator would need a copy of A, which is larger than U
+				if (want_operator && !rowsOfA) {
+					ctx.log->warn("U_operator needs A in [VR,STAR], forming U instead");
+					want_operator = false;
+					want_U = true;
+				}
+				int replicate = (want_operator || (want_U && rowsOfA) || (want_V && V_layout == "STAR_STAR")) ? 1 : 0;
+				MPI_Allreduce(MPI_IN_PLACE, &replicate, 1, MPI_INT, MPI_MAX, ctx.comm);
+
+				// The replicated eigenvectors live in the pool only until U is formed
+				std::shared_ptr<double> rightBuffer;
+				El::Matrix<double> rightEigs;
+				std::shared_ptr<El::DistMatrix<double, El::VR, El::STAR> > Vrows;
+				if (replicate) {
+					rightBuffer = pool->acquire((size_t) n * std::max(nconv, 1u));
+					attach_pooled(rightEigs, rightBuffer, n, nconv);
+					if (nconv > 0) MPI_Bcast(rightEigs.Buffer(), n*nconv, MPI_DOUBLE, 0, ctx.comm);
+				}
+				else {
+					Vrows = make_pooled_distmatrix<El::VR, El::STAR>(pool, n, nconv, grid);
+					receive_rows(ctx.comm, *Vrows, 0, n);
+				}
+				std::vector<double> summary(nconv + CONVERGENCE_FIELDS);
+				MPI_Bcast(summary.data(), nconv + CONVERGENCE_FIELDS, MPI_DOUBLE, 0, ctx.comm);
+				ctx.log->info("Received the right eigenvectors and the eigenvalues");
+
+//				DistMatrix_ptr U    = std::make_shared<El::DistMatrix<double, El::VR, El::STAR>>(m, nconv, grid);
+//				DistMatrix_ptr S    = std::make_shared<El::DistMatrix<double, El::VR, El::STAR>>(nconv, 1, grid);
+//				DistMatrix_ptr Sinv = std::make_shared<El::DistMatrix<double, El::VR, El::STAR>>(nconv, 1, grid);
+//				DistMatrix_ptr V    = std::make_shared<El::DistMatrix<double, El::VR, El::STAR>>(n, nconv, grid);
+
+
+				auto startU = std::chrono::system_clock::now();
+
+				// V straight in the layout the client asked for, so that retrieving it needs no redistribution
+				const LocalKernels & kernels = local_kernels();
+				std::shared_ptr<El::AbstractDistMatrix<double> > V;
+				if (want_V) {
+					V = (replicate) ? distribute_replicated(pool, rightEigs, grid, V_layout) : redistribute_rows(pool, Vrows, V_layout);
+					ctx.log->info("Stored V in [{}] with the {} kernels", V_layout, kernels.isa);
+				}
+
+				// the inverses of S are replicated, so rescaling U needs no communication
+				std::vector<double> Sinv(nconv);
+				for (uint32_t idx = 0; idx < nconv; idx++) Sinv[idx] = 1/std::sqrt(summary[idx]);
+
+				// U as an operator keeps A and V*inv(S) instead of the m x k product
+				std::shared_ptr<LeftSingularVectors> Uop;
+				if (want_operator) {
+					Uop = std::make_shared<LeftSingularVectors>(share_input(A), rightEigs, Sinv);
+					ctx.log->info("Kept U as an operator on A and V*inv(S)");
+				}
+
+				// form U; with A in [VR,STAR] its local rows are those of U, and A*V is a local product
+				// with the replicated eigenvectors
+				std::shared_ptr<El::DistMatrix<double, El::VR, El::STAR> > U;
+				if (want_U) {
+					U = make_pooled_distmatrix<El::VR, El::STAR>(pool, m, nconv, grid);
+					ctx.log->info("Computing A*V = U*Sigma");
+					ctx.log->info("A is {}x{}, V is {}x{}, U will be {}x{}", A->Height(), A->Width(), n, nconv, U->Height(), U->Width());
+					if (rowsOfA) {
+						if (U->LocalHeight() > 0 && nconv > 0)
+							El::Gemm(El::NORMAL, El::NORMAL, 1.0, A->LockedMatrix(), rightEigs, 0.0, U->Matrix());
+					}
+					else {
+						std::shared_ptr<const El::AbstractDistMatrix<double> > Vdist = (V) ? V : Vrows;
+						if (!Vdist) Vdist = distribute_replicated(pool, rightEigs, grid);
+						//Gemm(1.0, *workingMat, *V, 0.0, *U, self->log);
+						El::Gemm(El::NORMAL, El::NORMAL, 1.0, *A, *Vdist, 0.0, *U);
+					}
+					ctx.log->info("Done computing A*V, rescaling to get U");
+					// TODO: do a QR instead to ensure stability, but does column pivoting so would require postprocessing S,V to stay consistent
+					kernels.scale_columns(U->Buffer(), U->LocalHeight(), U->LDim(), nconv, Sinv.data());
+					ctx.log->info("Computed and stored U");
+				}
+				rightEigs.Empty();
+				rightBuffer.reset();
+				Vrows.reset();
+				u_ms = std::chrono::duration<double, std::milli>(std::chrono::system_clock::now() - startU).count();
+//
+//				out.add_distmatrix("S", S);
+//				out.add_distmatrix("U", U);
+//				out.add_distmatrix("V", V);
+
+				if (arrays) push_svd_arrays(ctx, summary, nconv, want_S, out);
+				else if (want_S) {
+					auto S = make_pooled_distmatrix<El::VR, El::STAR>(pool, nconv, 1, grid);
+					for (El::Int il = 0; il < S->LocalHeight(); il++)
+						S->SetLocal(il, 0, std::sqrt(summary[S->GlobalRow(il)]));
+					out.push_back(std::make_shared<Parameter>("S", DISTMATRIX_VR_STAR, keep_resident(S)));
+				}
+				if (U) out.push_back(std::make_shared<Parameter>("U", DISTMATRIX_VR_STAR, keep_resident(U)));
+				if (Uop) out.push_back(std::make_shared<Parameter>("U_operator", VOID_POINTER, keep_resident(Uop)));
+				if (V) out.push_back(std::make_shared<Parameter>("V", V_type, keep_resident(V)));
+
+				break;
+			}
+		}
+		MPI_Barrier(ctx.comm);
+	}
+	if (cancelled) {
+		ctx.log->info("Cancelled truncated SVD task");
+		return -1;
+	}
+
+	double worker_ms[2] = {gram_ms, u_ms};
+	MPI_Reduce((ctx.is_driver) ? MPI_IN_PLACE : worker_ms, worker_ms, 2, MPI_DOUBLE, MPI_MAX, 0, ctx.comm);
+	if (ctx.is_driver) {
+		ctx.log->info("Gramian {} ms, Arnoldi {} ms for {} products, broadcast {} ms, U {} ms", worker_ms[0], arnoldi_ms, matvecs, broadcast_ms, worker_ms[1]);
+		out.push_back(std::make_shared<Parameter>("matvecs", UINT32, reinterpret_cast<void *>(ctx.arena->make<uint32_t>(matvecs))));
+		out.push_back(std::make_shared<Parameter>("gram_ms", DOUBLE, reinterpret_cast<void *>(ctx.arena->make<double>(worker_ms[0]))));
+		out.push_back(std::make_shared<Parameter>("arnoldi_ms", DOUBLE, reinterpret_cast<void *>(ctx.arena->make<double>(arnoldi_ms))));
+		out.push_back(std::make_shared<Parameter>("broadcast_ms", DOUBLE, reinterpret_cast<void *>(ctx.arena->make<double>(broadcast_ms))));
+		out.push_back(std::make_shared<Parameter>("u_ms", DOUBLE, reinterpret_cast<void *>(ctx.arena->make<double>(worker_ms[1]))));
+	}
+	ctx.log->info("Completed truncated SVD task");
+
+	return 0;
+}
+
+// The lazy U passed as "U" and its dimensions, which only the workers know, on every process of ctx
+static LeftSingularVectors * left_vectors_input(TaskContext & ctx, vector<Parameter_ptr> & in, uint64_t & m, uint64_t & k)
+{
+	LeftSingularVectors * U = nullptr;
+	for (auto it = in.begin(); it != in.end(); it++) {
+		if ((*it)->name == "U")
+			U = reinterpret_cast<LeftSingularVectors * >((*it)->p);
+	}
+
+	uint64_t dims[2] = {0, 0};
+	if (!ctx.is_driver) {
+		dims[0] = (uint64_t) U->Height();
+		dims[1] = (uint64_t) U->Width();
+	}
+	MPI_Bcast(dims, 2, MPI_UINT64_T, 1, ctx.comm);
+	m = dims[0];
+	k = dims[1];
+
+	return (ctx.is_driver) ? nullptr : U;
+}
+
+int TestLib::run_apply_u(TaskContext & ctx, vector<Parameter_ptr> & in, vector<Parameter_ptr> & out)
+{
+	const ArrayBlockDouble * X = nullptr;
+	for (auto it = in.begin(); it != in.end(); it++) {
+		if ((*it)->name == "X")
+			X = reinterpret_cast<const ArrayBlockDouble * >((*it)->p);
+	}
+
+	uint64_t m, k;
+	LeftSingularVectors * U = left_vectors_input(ctx, in, m, k);
+
+	if (X == nullptr || X->dims.empty() || X->dims.size() > 2 || X->dims[0] != k) {
+		ctx.log->error("apply_u needs X with {} rows", k);
+		return -1;
+	}
+	uint64_t c = (X->dims.size() == 2) ? X->dims[1] : 1;
+
+	if (ctx.is_driver) {
+		ctx.log->info("Multiplying {}x{} left singular vectors by {} columns", m, k, c);
+	}
+	else {
+		El::Matrix<double> Xl;
+		El::Zeros(Xl, (El::Int) k, (El::Int) c);
+		std::copy(X->data.begin(), X->data.end(), Xl.Buffer());
+
+		auto startApply = std::chrono::system_clock::now();
+		auto Y = U->apply(pool, Xl);
+		std::chrono::duration<double, std::milli> apply_duration(std::chrono::system_clock::now() - startApply);
+		ctx.log->info("Computed U*X in {} ms", apply_duration.count());
+
+		out.push_back(std::make_shared<Parameter>("Y", DISTMATRIX_VR_STAR, keep_resident(Y)));
+	}
+	MPI_Barrier(ctx.comm);
+
+	return 0;
+}
+
+int TestLib::run_u_rows(TaskContext & ctx, vector<Parameter_ptr> & in, vector<Parameter_ptr> & out)
+{
+	uint64_t first = 0;
+	uint32_t count = 0;
+	for (auto it = in.begin(); it != in.end(); it++) {
+		if ((*it)->name == "first")
+			first = * reinterpret_cast<uint64_t * >((*it)->p);
+		else if ((*it)->name == "count")
+			count = * reinterpret_cast<uint32_t * >((*it)->p);
+	}
+
+	uint64_t m, k;
+	LeftSingularVectors * U = left_vectors_input(ctx, in, m, k);
+
+	if (first > m || count > m - first) {
+		ctx.log->error("Cannot take rows {} to {} of {} rows", first, first + count, m);
+		return -1;
+	}
+
+	ArrayBlockDouble * rows = ctx.arena->make<ArrayBlockDouble>(std::vector<uint64_t>{count, k});
+	if (ctx.is_driver) {
+		ctx.log->info("Forming rows {} to {} of {}x{} left singular vectors", first, first + count, m, k);
+	}
+	else {
+		El::Matrix<double> R;
+		U->rows((El::Int) first, (El::Int) count, R);
+		for (uint64_t c = 0; c < k; c++)
+			for (uint64_t i = 0; i < count; i++) rows->data[i + c * count] = R.Get((El::Int) i, (El::Int) c);
+	}
+	MPI_Bcast(rows->data.data(), (int) (count * k), MPI_DOUBLE, 1, ctx.comm);
+	out.push_back(std::make_shared<Parameter>("rows", ARRAY_BLOCK_DOUBLE, reinterpret_cast<void *>(rows)));
+	MPI_Barrier(ctx.comm);
+
+	return 0;
+}
+
+int TestLib::run_incremental_svd(TaskContext & ctx, vector<Parameter_ptr> & in, vector<Parameter_ptr> & out)
+{
+	string V_layout = "VR_STAR";
+	bool arrays = false;
+	for (auto it = in.begin(); it != in.end(); it++) {
+		if ((*it)->name == "V_layout")
+			V_layout = * reinterpret_cast<string * >((*it)->p);
+		else if ((*it)->name == "small_outputs")
+			arrays = (* reinterpret_cast<string * >((*it)->p) == "array");
+	}
+
+	uint64_t m, k, n, kv, b, nb;
+	input_dims(ctx, in, "U", m, k);
+	input_dims(ctx, in, "V", n, kv);
+	input_dims(ctx, in, "B", b, nb);
+
+	datatype V_type = replicated_layout(V_layout);
+	if (V_type == NONE) {
+		ctx.log->error("incremental_svd: V_layout must be VR_STAR, VC_STAR, MC_MR or STAR_STAR, not {}", V_layout);
+		return -1;
+	}
+	if (kv != k || nb != n) {
+		ctx.log->error("Cannot update {}x{} U and {}x{} V with {}x{} rows", m, k, n, kv, b, nb);
+		return -1;
+	}
+
+	// Singular values and the directions the new rows added, from the first worker
+	std::vector<double> summary(k + 1, 0.0);
+
+	if (ctx.is_driver) {
+		ctx.log->info("Appending {} rows to rank-{} SVD of {}x{} matrix", b, k, m, n);
+	}
+	else {
+		El::AbstractDistMatrix<double> * U = nullptr, * V = nullptr, * B = nullptr, * Smatrix = nullptr;
+		const ArrayBlockDouble * Sarray = nullptr;
+		for (auto it = in.begin(); it != in.end(); it++) {
+			if ((*it)->name == "U")
+				U = reinterpret_cast<El::AbstractDistMatrix<double> * >((*it)->p);
+			else if ((*it)->name == "V")
+				V = reinterpret_cast<El::AbstractDistMatrix<double> * >((*it)->p);
+			else if ((*it)->name == "B")
+				B = reinterpret_cast<El::AbstractDistMatrix<double> * >((*it)->p);
+			else if ((*it)->name == "S" && (*it)->dt == ARRAY_BLOCK_DOUBLE)
+				Sarray = reinterpret_cast<const ArrayBlockDouble * >((*it)->p);
+			else if ((*it)->name == "S")
+				Smatrix = reinterpret_cast<El::AbstractDistMatrix<double> * >((*it)->p);
+		}
+
+		// U and B are used row by row, V and S in full on every worker. The rows of U stay where they
+		// are in the new U, which starts on the first process.
+		std::unique_ptr<El::DistMatrix<double, El::VR, El::STAR> > Urows, Brows;
+		if (U->ColDist() != El::VR || U->RowDist() != El::STAR || U->ColAlign() != 0) {
+			Urows.reset(new El::DistMatrix<double, El::VR, El::STAR>(U->Grid()));
+			Urows->AlignCols(0);
+			El::Copy(*U, *Urows);
+			U = Urows.get();
+		}
+		if (B->ColDist() != El::VR || B->RowDist() != El::STAR) {
+			Brows.reset(new El::DistMatrix<double, El::VR, El::STAR>(*B));
+			B = Brows.get();
+		}
+		El::DistMatrix<double, El::STAR, El::STAR> Vfull(*V);
+
+		std::vector<double> S(k, 0.0);
+		if (Sarray != nullptr) {
+			std::copy(Sarray->data.begin(), Sarray->data.begin() + std::min((uint64_t) Sarray->data.size(), k), S.begin());
+		}
+		else if (Smatrix != nullptr) {
+			El::DistMatrix<double, El::STAR, El::STAR> Sfull(*Smatrix);
+			for (uint64_t idx = 0; idx < k && idx < (uint64_t) Sfull.Height(); idx++) S[idx] = Sfull.LockedMatrix().Get(idx, 0);
+		}
+
+		auto startUpdate = std::chrono::system_clock::now();
+		SVDUpdate update;
+		append_rows(pool, *U, S, Vfull.LockedMatrix(), *B, update);
+		std::chrono::duration<double, std::milli> update_duration(std::chrono::system_clock::now() - startUpdate);
+		ctx.log->info("Updated the SVD with {} rows, {} new directions, in {} ms", b, update.residual_rank, update_duration.count());
+
+		std::copy(update.S.begin(), update.S.end(), summary.begin());
+		summary[k] = (double) update.residual_rank;
+
+		const El::Grid & grid = U->Grid();
+		if (!arrays) {
+			El::Matrix<double> Scolumn;
+			El::Zeros(Scolumn, (El::Int) k, 1);
+			std::copy(update.S.begin(), update.S.end(), Scolumn.Buffer());
+			out.push_back(std::make_shared<Parameter>("S", DISTMATRIX_VR_STAR, keep_resident(distribute_replicated(pool, Scolumn, grid))));
+		}
+		out.push_back(std::make_shared<Parameter>("U", DISTMATRIX_VR_STAR, keep_resident(update.U)));
+		out.push_back(std::make_shared<Parameter>("V", V_type, keep_resident(distribute_replicated(pool, update.V, grid, V_layout))));
+	}
+	MPI_Bcast(summary.data(), (int) (k + 1), MPI_DOUBLE, 1, ctx.comm);
+
+	if (arrays) {
+		ArrayBlockDouble * S = ctx.arena->make<ArrayBlockDouble>(std::vector<uint64_t>{k});
+		std::copy(summary.begin(), summary.begin() + k, S->data.begin());
+		out.push_back(std::make_shared<Parameter>("S", ARRAY_BLOCK_DOUBLE, reinterpret_cast<void *>(S)));
+	}
+	if (ctx.is_driver)
+		out.push_back(std::make_shared<Parameter>("new_directions", UINT32, reinterpret_cast<void *>(ctx.arena->make<uint32_t>((uint32_t) summary[k]))));
+	MPI_Barrier(ctx.comm);
+
+	return 0;
+}
+
+static RowStream * stream_input(TaskContext & ctx, vector<Parameter_ptr> & in, uint64_t & m, uint64_t & n)
+{
+	RowStream * S = nullptr;
+	for (auto it = in.begin(); it != in.end(); it++) {
+		if ((*it)->name == "stream")
+			S = reinterpret_cast<RowStream * >((*it)->p);
+	}
+
+	uint64_t dims[2] = {0, 0};
+	if (!ctx.is_driver) {
+		dims[0] = (uint64_t) S->Height();
+		dims[1] = (uint64_t) S->Width();
+	}
+	MPI_Bcast(dims, 2, MPI_UINT64_T, 1, ctx.comm);
+	m = dims[0];
+	n = dims[1];
+
+	return (ctx.is_driver) ? nullptr : S;
+}
+
+int TestLib::run_stream_open(TaskContext & ctx, vector<Parameter_ptr> & in, vector<Parameter_ptr> & out)
+{
+	uint64_t n = 0;
+	uint64_t expected_rows = 0;			// Hint for the first buffer, which grows as needed
+	bool keep_gram = true;				// Also sum A'*A as the rows arrive
+	for (auto it = in.begin(); it != in.end(); it++) {
+		if ((*it)->name == "cols")
+			n = * reinterpret_cast<uint64_t * >((*it)->p);
+		else if ((*it)->name == "rows")
+			expected_rows = * reinterpret_cast<uint64_t * >((*it)->p);
+		else if ((*it)->name == "gram")
+			keep_gram = * reinterpret_cast<bool * >((*it)->p);
+	}
+
+	if (n == 0) {
+		ctx.log->error("stream_open needs cols > 0");
+		return -1;
+	}
+
+	if (ctx.is_driver) {
+		ctx.log->info("Opening a stream of rows with {} columns{}", n, keep_gram ? " and their Gramian" : "");
+	}
+	else {
+		auto S = std::make_shared<RowStream>(pool, *ctx.grid, (El::Int) n, (El::Int) expected_rows, keep_gram);
+		out.push_back(std::make_shared<Parameter>("stream", VOID_POINTER, keep_resident(S)));
+	}
+	MPI_Barrier(ctx.comm);
+
+	return 0;
+}
+
+int TestLib::run_stream_append(TaskContext & ctx, vector<Parameter_ptr> & in, vector<Parameter_ptr> & out)
+{
+	const ArrayBlockDouble * B = nullptr;
+	for (auto it = in.begin(); it != in.end(); it++) {
+		if ((*it)->name == "rows")
+			B = reinterpret_cast<const ArrayBlockDouble * >((*it)->p);
+	}
+
+	uint64_t m, n;
+	RowStream * S = stream_input(ctx, in, m, n);
+
+	// Only the driver needs the rows; it checks them and tells the workers how many there are
+	int64_t b = -1;
+	if (ctx.is_driver && B != nullptr && B->dims.size() == 2 && B->dims[1] == n) b = (int64_t) B->dims[0];
+	MPI_Bcast(&b, 1, MPI_INT64_T, 0, ctx.comm);
+	if (b < 0) {
+		ctx.log->error("stream_append needs rows with {} columns", n);
+		return -1;
+	}
+
+	if (ctx.is_driver) {
+		ctx.log->info("Appending {} rows to {}x{} stream", b, m, n);
+		out.push_back(std::make_shared<Parameter>("num_rows", UINT64, reinterpret_cast<void *>(ctx.arena->make<uint64_t>(m + b))));
+		scatter_rows(ctx.comm, B->data.data(), (El::Int) b, (El::Int) n, std::max((El::Int) b, El::Int(1)), (El::Int) m);
+	}
+	else {
+		auto startAppend = std::chrono::system_clock::now();
+		S->receive(ctx.comm, (El::Int) b);
+		std::chrono::duration<double, std::milli> append_duration(std::chrono::system_clock::now() - startAppend);
+		ctx.log->info("Appended {} rows in {} ms", b, append_duration.count());
+	}
+	MPI_Barrier(ctx.comm);
+
+	return 0;
+}
+
+int TestLib::run_stream_matrix(TaskContext & ctx, vector<Parameter_ptr> & in, vector<Parameter_ptr> & out)
+{
+	uint64_t m, n;
+	RowStream * S = stream_input(ctx, in, m, n);
+
+	// Sums of the columns, which every process returns
+	ArrayBlockDouble * sums = ctx.arena->make<ArrayBlockDouble>(std::vector<uint64_t>{n});
+	if (ctx.is_driver) {
+		ctx.log->info("Finishing {}x{} stream", m, n);
+	}
+	else {
+		auto startFinish = std::chrono::system_clock::now();
+		auto A = S->matrix();
+		auto stats = std::make_shared<ColumnStats>();
+		S->stats(*stats);
+		for (uint64_t j = 0; j < n; j++) sums->data[j] = stats->mean[j] * (double) stats->count;
+
+		void * p = keep_resident(A);
+		{
+			std::lock_guard<std::mutex> lock(resident_mutex);
+			stats_cache[p] = stats;
+		}
+		out.push_back(std::make_shared<Parameter>("A", DISTMATRIX_VR_STAR, p));
+
+		auto G = S->local_gram();
+		if (G) {
+			allreduce_sum(G->Buffer(), (El::Int) (n * n), ctx.grid->VRComm().comm);
+			out.push_back(std::make_shared<Parameter>("G", DISTMATRIX_VR_STAR, keep_resident(distribute_replicated(pool, *G, *ctx.grid))));
+		}
+		std::chrono::duration<double, std::milli> finish_duration(std::chrono::system_clock::now() - startFinish);
+		ctx.log->info("Reduced the statistics of {} local rows in {} ms", A->LocalHeight(), finish_duration.count());
+	}
+	MPI_Bcast(sums->data.data(), (int) n, MPI_DOUBLE, 1, ctx.comm);
+	out.push_back(std::make_shared<Parameter>("column_sums", ARRAY_BLOCK_DOUBLE, reinterpret_cast<void *>(sums)));
+	MPI_Barrier(ctx.comm);
+
+	return 0;
+}
+
+}
+
+// C entry points of TestLib::run_async, for servers that only hold the library through
+// alchemist_create_library. An alchemist_task owns the handle of its task, which in_flight may share.
+struct alchemist_task {
+	alchemist::TaskHandle_ptr handle;
+};
+
+using alchemist::TestLib;
+using alchemist::Parameter;
+using alchemist::Parameter_ptr;
+
+static_assert(alchemist::TASK_RUNNING == ALCHEMIST_TASK_RUNNING && alchemist::TASK_DONE == ALCHEMIST_TASK_DONE &&
+		alchemist::TASK_FAILED == ALCHEMIST_TASK_FAILED && alchemist::TASK_CANCELLED == ALCHEMIST_TASK_CANCELLED,
+		"Task states of AlchemistLibrary.h and async.hpp differ");
+
+extern "C" alchemist_task * alchemist_run_async(void * library, const char * task_name, const alchemist_parameter * inputs, uint32_t num_inputs)
+{
+	if (library == nullptr || task_name == nullptr) return nullptr;
+
+	std::vector<Parameter_ptr> in;
+	for (uint32_t i = 0; i < num_inputs; i++)
+		in.push_back(std::make_shared<Parameter>(inputs[i].name, (alchemist::datatype) inputs[i].dt, inputs[i].p));
+
+	std::string name = task_name;
+	alchemist_task * task = new alchemist_task;
+	task->handle = reinterpret_cast<TestLib *>(library)->run_async(name, in);
+	return task;
+}
+
+extern "C" int alchemist_task_poll(const alchemist_task * task)
+{
+	return task->handle->poll() ? 1 : 0;
+}
+
+extern "C" uint8_t alchemist_task_state(const alchemist_task * task)
+{
+	return (uint8_t) task->handle->get_state();
+}
+
+extern "C" void alchemist_task_progress(const alchemist_task * task, alchemist_progress * progress)
+{
+	alchemist::TaskProgress p = task->handle->progress();
+	progress->iteration = p.iteration;
+	progress->max_iterations = p.max_iterations;
+	progress->residual = p.residual;
+	progress->elapsed_seconds = p.elapsed_seconds;
+	progress->eta_seconds = p.eta_seconds;
+}
+
+extern "C" void alchemist_task_cancel(alchemist_task * task)
+{
+	task->handle->cancel();
+}
+
+extern "C" int alchemist_task_wait(alchemist_task * task)
+{
+	return task->handle->wait();
+}
+
+extern "C" const char * alchemist_task_error(const alchemist_task * task)
+{
+	return task->handle->get_error().c_str();
+}
+
+extern "C" uint32_t alchemist_task_outputs(const alchemist_task * task, alchemist_parameter * outputs, uint32_t capacity)
+{
+	if (!task->handle->poll()) return 0;
+
+	const std::vector<Parameter_ptr> & out = task->handle->outputs;
+	for (uint32_t i = 0; i < capacity && i < (uint32_t) out.size(); i++) {
+		outputs[i].name = out[i]->name.c_str();
+		outputs[i].dt = (uint8_t) out[i]->dt;
+		outputs[i].p = out[i]->p;
+	}
+	return (uint32_t) out.size();
+}
+
+extern "C" void alchemist_task_free(alchemist_task * task)
+{
+	if (task == nullptr) return;
+	task->handle->wait();
+	delete task;
 }
@@ -5,21 +5,80 @@
 #include <stdio.h>
 #include <iostream>
 #include <vector>
+#include <map>
 #include <poll.h>
 #include <thread>
 #include <algorithm>
 #include <random>
 #include <cmath>
+#include <limits>
 #include <chrono>
 #include <El.hpp>
 #include <eigen3/Eigen/Dense>
 #include "arpackpp/arrssym.h"
 #include "include/Alchemist.hpp"
-//#include "nla/nla.hpp"						// Include all NLA routines
+#include "include/AlchemistLibrary.h"
+#include "utility/numa.hpp"
+#include "utility/arena.hpp"
+#include "utility/arnoldi.hpp"
+#include "utility/matrix_io.hpp"
+#include "utility/array_block.hpp"
+#include "utility/async.hpp"
+#include "utility/node_collectives.hpp"
+#include "TestLibTasks.hpp"
+#include "nla/nla.hpp"							// Include all NLA routines
 //#include "ml/ml.hpp"							// Include all ML/Data-mining routines
 
 namespace alchemist {
 
+// Processes a task runs on: either all of world, with world rank 0 as the driver, or one worker
+// group, whose lowest rank drives the others
+struct TaskContext {
+	uint32_t group;							// 0 for world
+	MPI_Comm comm;
+	int rank, size;
+	bool is_driver;
+	Log_ptr log;
+	const El::Grid * grid;					// Non-driver processes of comm; nullptr on the driver
+	TaskArena * arena;						// Scratch space and scalar outputs
+	TaskHandle * handle;					// nullptr unless started with run_async
+
+	// Progress of an iterative task, reported by its driver once per iteration
+	void report(uint64_t iteration, uint64_t max_iterations, double residual = -1.0, double target_residual = 0.0) const {
+		if (handle != nullptr) handle->report(iteration, max_iterations, residual, target_residual);
+	}
+
+	// Whether the task has been asked to stop. Only the driver's answer counts: it has to pass the
+	// decision on to the workers, either in a command it broadcasts anyway or with stop_requested().
+	bool cancel_requested() const { return handle != nullptr && handle->cancelled(); }
+
+	// Collective over comm: true everywhere if the driver has been asked to stop
+	bool stop_requested() const {
+		uint8_t stop = (is_driver && cancel_requested()) ? 1 : 0;
+		MPI_Bcast(&stop, 1, MPI_UNSIGNED_CHAR, 0, comm);
+		if (stop && handle != nullptr) handle->cancel();
+		return stop != 0;
+	}
+};
+
+// Disjoint subset of the workers, created by the "create_groups" task, on which tasks can run
+// without involving the other workers
+struct WorkerGroup {
+	uint32_t id;							// 1-based
+	MPI_Comm comm;
+	MPI_Comm workers;
+	std::shared_ptr<El::Grid> grid;
+	Log_ptr log;
+
+	WorkerGroup() : id(0), comm(MPI_COMM_NULL), workers(MPI_COMM_NULL) { }
+
+	~WorkerGroup() {
+		grid.reset();
+		if (workers != MPI_COMM_NULL) MPI_Comm_free(&workers);
+		if (comm != MPI_COMM_NULL) MPI_Comm_free(&comm);
+	}
+};
+
 struct TestLib : Library {
 
 	TestLib(MPI_Comm & world);
@@ -30,10 +89,126 @@ struct TestLib : Library {
 
 	int world_rank;
 
+	NumaTopology topology;
+
+	// Thread support MPI was initialized with
+	int thread_level;
+
+	// Communicator and process grid spanning only the workers, for tasks that create matrices
+	// without being given one. Created on first use; the driver holds MPI_COMM_NULL.
+	MPI_Comm workers;
+	std::shared_ptr<El::Grid> worker_grid;
+	bool workers_initialized;
+
+	// Worker group of this process, if the workers have been split; the driver belongs to none
+	std::shared_ptr<WorkerGroup> group;
+	uint32_t num_groups;
+
+	// Scratch space and scalar outputs of the tasks started with run(), one arena per task that lives
+	// as long as the task's output parameters
+	ArenaPool_ptr arenas;
+	// Backing stores of large matrices, reused across tasks; TESTLIB_POOL_CACHE_MB caps the memory
+	// it keeps for reuse (256 MiB by default)
+	BufferPool_ptr pool;
+	// Output matrices handed to Alchemist; the pointers in the output parameters are non-owning and
+	// stay valid until they are passed back to the "release" task or the library is unloaded
+	std::map<void *, DistMatrix_ptr> resident;
+	std::mutex resident_mutex;
+	// Column statistics of resident matrices, computed by column_stats and reused by later tasks until
+	// the matrix is released. Guarded by resident_mutex.
+	std::map<const void *, std::shared_ptr<ColumnStats> > stats_cache;
+	// Lazy left singular vectors handed out by truncated_svd, released like resident matrices.
+	// Guarded by resident_mutex.
+	std::map<void *, std::shared_ptr<LeftSingularVectors> > operators;
+	// Row streams opened by stream_open, released like resident matrices. Guarded by resident_mutex.
+	std::map<void *, std::shared_ptr<RowStream> > streams;
+
+	// Last task started with run_async on each group (0 for world) that this process takes part in
+	std::map<uint32_t, TaskHandle_ptr> in_flight;
+
 	int load();
 	int unload();
 
+	// Output parameters, and the scalars they point to, stay valid while the caller holds them
 	int run(string & name, std::vector<Parameter_ptr> & in, std::vector<Parameter_ptr> & out);
+	int run_in_arena(string & name, TaskArena & arena, std::vector<Parameter_ptr> & in, std::vector<Parameter_ptr> & out);
+	// Whether run() knows the task, which is the case for every task alchemist_describe_library lists
+	static bool has_task(const string & name);
+
+	// Starts the task on a compute thread of its own and returns without waiting for it. Like run(),
+	// it must be called on every process, in the same order, from one thread; the parameters in in
+	// must stay valid until the task has finished. Tasks on different worker groups overlap. Without
+	// MPI_THREAD_MULTIPLE the task runs on the calling thread and has finished when this returns.
+	// alchemist_run_async is its C entry point.
+	TaskHandle_ptr run_async(string & name, std::vector<Parameter_ptr> & in);
+
+	// Collective over world
+	const El::Grid * get_worker_grid();
+
+	// Collective over world
+	int create_groups(TaskArena & out_arena, std::vector<Parameter_ptr> & in, std::vector<Parameter_ptr> & out);
+	// Returns false if this process is not part of the group
+	bool make_context(uint32_t group_id, TaskContext & ctx);
+	// Dimensions of a matrix input, on every process of ctx; collective over a worker group
+	void input_dims(TaskContext & ctx, std::vector<Parameter_ptr> & in, const string & name, uint64_t & m, uint64_t & n);
+	// Waits for asynchronous tasks whose collective calls could interleave with those of a new task on group_id
+	void wait_in_flight(uint32_t group_id);
+	// Statistics of A, from the cache if A is resident and they were computed with the same sketch;
+	// collective over the grid of A
+	std::shared_ptr<ColumnStats> get_column_stats(const El::AbstractDistMatrix<double> & A, uint8_t sketch = SKETCH_NONE,
+			El::Int sketch_rows = 0, uint64_t seed = 0, bool cache = true);
+	// A as a shared pointer: the owning one if an earlier task left A resident, otherwise one that
+	// does not own it
+	DistMatrixConst_ptr share_input(const El::AbstractDistMatrix<double> * A);
+
+	typedef int (TestLib::*TaskMethod)(TaskContext & ctx, std::vector<Parameter_ptr> & in, std::vector<Parameter_ptr> & out);
+	static const std::map<string, TaskMethod> task_methods;
+
+	int dispatch(const string & name, TaskContext & ctx, std::vector<Parameter_ptr> & in, std::vector<Parameter_ptr> & out);
+
+	int run_greet(TaskContext & ctx, std::vector<Parameter_ptr> & in, std::vector<Parameter_ptr> & out);
+	int run_release(TaskContext & ctx, std::vector<Parameter_ptr> & in, std::vector<Parameter_ptr> & out);
+	int run_load_matrix(TaskContext & ctx, std::vector<Parameter_ptr> & in, std::vector<Parameter_ptr> & out);
+	int run_save_matrix(TaskContext & ctx, std::vector<Parameter_ptr> & in, std::vector<Parameter_ptr> & out);
+	int run_generate_matrix(TaskContext & ctx, std::vector<Parameter_ptr> & in, std::vector<Parameter_ptr> & out);
+	int run_matmul(TaskContext & ctx, std::vector<Parameter_ptr> & in, std::vector<Parameter_ptr> & out);
+	int run_gram(TaskContext & ctx, std::vector<Parameter_ptr> & in, std::vector<Parameter_ptr> & out);
+	int run_column_stats(TaskContext & ctx, std::vector<Parameter_ptr> & in, std::vector<Parameter_ptr> & out);
+	int run_sketched_lstsq(TaskContext & ctx, std::vector<Parameter_ptr> & in, std::vector<Parameter_ptr> & out);
+	int run_nmf(TaskContext & ctx, std::vector<Parameter_ptr> & in, std::vector<Parameter_ptr> & out);
+	int run_cur(TaskContext & ctx, std::vector<Parameter_ptr> & in, std::vector<Parameter_ptr> & out);
+	int run_random_features(TaskContext & ctx, std::vector<Parameter_ptr> & in, std::vector<Parameter_ptr> & out);
+	int run_nystrom(TaskContext & ctx, std::vector<Parameter_ptr> & in, std::vector<Parameter_ptr> & out);
+	int run_kernel_features(const string & method, TaskContext & ctx, std::vector<Parameter_ptr> & in, std::vector<Parameter_ptr> & out);
+	int run_truncated_svd(TaskContext & ctx, std::vector<Parameter_ptr> & in, std::vector<Parameter_ptr> & out);
+	int run_apply_u(TaskContext & ctx, std::vector<Parameter_ptr> & in, std::vector<Parameter_ptr> & out);
+	int run_u_rows(TaskContext & ctx, std::vector<Parameter_ptr> & in, std::vector<Parameter_ptr> & out);
+	int run_incremental_svd(TaskContext & ctx, std::vector<Parameter_ptr> & in, std::vector<Parameter_ptr> & out);
+	int run_stream_open(TaskContext & ctx, std::vector<Parameter_ptr> & in, std::vector<Parameter_ptr> & out);
+	int run_stream_append(TaskContext & ctx, std::vector<Parameter_ptr> & in, std::vector<Parameter_ptr> & out);
+	int run_stream_matrix(TaskContext & ctx, std::vector<Parameter_ptr> & in, std::vector<Parameter_ptr> & out);
+
+	template <typename T>
+	void * keep_resident(const std::shared_ptr<T> & M) {
+		std::lock_guard<std::mutex> lock(resident_mutex);
+		void * p = reinterpret_cast<void *>(M.get());
+		resident[p] = M;
+		return p;
+	}
+
+	void * keep_resident(const std::shared_ptr<LeftSingularVectors> & U) {
+		std::lock_guard<std::mutex> lock(resident_mutex);
+		void * p = reinterpret_cast<void *>(U.get());
+		operators[p] = U;
+		return p;
+	}
+
+	void * keep_resident(const std::shared_ptr<RowStream> & S) {
+		std::lock_guard<std::mutex> lock(resident_mutex);
+		void * p = reinterpret_cast<void *>(S.get());
+		streams[p] = S;
+		return p;
+	}
 };
 
 // Class factories
@@ -49,6 +224,15 @@ void destroy_library(void * p) {
 	delete reinterpret_cast<TestLib*>(p);
 }
 
+void * alchemist_create_library(MPI_Comm * world, uint32_t abi_version) {
+	if (world == nullptr || abi_version != ALCHEMIST_LIBRARY_ABI_VERSION) return nullptr;
+	return reinterpret_cast<void*>(new TestLib(*world));
+}
+
+void alchemist_destroy_library(void * p) {
+	delete reinterpret_cast<TestLib*>(p);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,320 @@
+#include <El.hpp>
+#include "include/Alchemist.hpp"
+#include "include/AlchemistLibrary.h"
+#include "TestLibTasks.hpp"
+
+// Static description of the tasks in TestLib::run, returned by alchemist_describe_library. The
+// tasks come from TestLibTasks.hpp; keep the parameters below in step with TestLib.cpp. The "group"
+// parameter that every task accepts is implied by ALCHEMIST_CAP_WORKER_GROUPS and not listed.
+
+namespace alchemist {
+
+#define REQUIRED ALCHEMIST_PARAM_REQUIRED
+#define OPTIONAL 0u
+#define COUNT(a) ((uint32_t) (sizeof(a)/sizeof(a[0])))
+
+static const uint8_t double_types[] = {DOUBLE};
+
+static const uint8_t row_layouts[] = {DISTMATRIX_VR_STAR, DISTMATRIX_VC_STAR};
+
+static const alchemist_parameter_descriptor greet_in[] = {
+	{"in_byte", UINT8, OPTIONAL, "Echoed back as out_byte"},
+	{"in_char", CHAR, OPTIONAL, "Echoed back as out_char"},
+	{"in_short", INT16, OPTIONAL, "Echoed back as out_short"},
+	{"in_int", INT32, OPTIONAL, "Echoed back as out_int"},
+	{"in_long", INT64, OPTIONAL, "Echoed back as out_long"},
+	{"in_float", FLOAT, OPTIONAL, "Echoed back as out_float"},
+	{"in_double", DOUBLE, OPTIONAL, "Echoed back as out_double"},
+	{"in_string", STRING, OPTIONAL, "Echoed back as out_string"}
+};
+
+static const alchemist_parameter_descriptor greet_out[] = {
+	{"out_byte", UINT8, OPTIONAL, ""},
+	{"out_char", CHAR, OPTIONAL, ""},
+	{"out_short", UINT16, OPTIONAL, ""},
+	{"out_int", UINT32, OPTIONAL, ""},
+	{"out_long", UINT64, OPTIONAL, ""},
+	{"out_float", FLOAT, OPTIONAL, ""},
+	{"out_double", DOUBLE, OPTIONAL, ""},
+	{"out_string", STRING, OPTIONAL, ""}
+};
+
+static const alchemist_parameter_descriptor truncated_svd_in[] = {
+	{"A", DISTMATRIX, REQUIRED, "Matrix to decompose"},
+	{"rank", UINT32, REQUIRED, "Number of singular triplets"},
+	{"tol", DOUBLE, OPTIONAL, "Relative error bound of the eigenvalues of A'*A at which ARPACK stops, machine precision by default"},
+	{"max_iterations", UINT32, OPTIONAL, "Implicit restarts allowed, 100*rank by default"},
+	{"ncv", UINT32, OPTIONAL, "Krylov subspace size, more than rank and 2*rank+1 by default"},
+	{"ritz_tol", DOUBLE, OPTIONAL, "Also stop once the singular values change by less than this, relatively, from one restart to the next"},
+	{"gram", STRING, OPTIONAL, "\"local\" (default): Gramian of the local rows on every worker, \"distributed\": A'*A split into block columns, \"none\": products with A"},
+	{"collectives", STRING, OPTIONAL, "\"flat\" (default) or \"node\": stage Krylov vectors through node shared memory"},
+	{"checkpoint_dir", STRING, OPTIONAL, "Directory on the driver for Arnoldi checkpoints"},
+	{"checkpoint_interval", UINT32, OPTIONAL, "Checkpoint every this many matrix-vector products"},
+	{"checkpoint_seconds", DOUBLE, OPTIONAL, "Checkpoint every this many seconds"},
+	{"resume_from", STRING, OPTIONAL, "Checkpoint file to warm-start from; products are counted afresh"},
+	{"v0", ARRAY_BLOCK_DOUBLE, OPTIONAL, "Start vector of n entries for ARPACK, random by default"},
+	{"initial_subspace", DISTMATRIX, OPTIONAL, "n x j matrix, typically V of an earlier run, whose columns summed are the start vector"},
+	{"V_layout", STRING, OPTIONAL, "Distribution of V: \"VR_STAR\" (default), \"VC_STAR\", \"MC_MR\" or \"STAR_STAR\""},
+	{"small_outputs", STRING, OPTIONAL, "\"matrix\" (default): S as a distributed matrix, or \"array\": S, eigenvalues and convergence as arrays on every process"},
+	{"outputs", STRING, OPTIONAL, "Comma-separated outputs to form, of U, S, V and U_operator; \"U,S,V\" by default"}
+};
+
+static const alchemist_parameter_descriptor truncated_svd_out[] = {
+	{"U", DISTMATRIX_VR_STAR, OPTIONAL, "Left singular vectors"},
+	{"U_operator", VOID_POINTER, OPTIONAL, "Left singular vectors as A*V*inv(S), formed on demand by apply_u and u_rows; for A in [VR,STAR] only, otherwise U is returned instead"},
+	{"S", DISTMATRIX_VR_STAR, OPTIONAL, "Singular values, an ARRAY_BLOCK_DOUBLE with small_outputs = \"array\""},
+	{"V", DISTMATRIX, OPTIONAL, "Right singular vectors, in V_layout"},
+	{"eigenvalues", ARRAY_BLOCK_DOUBLE, OPTIONAL, "Eigenvalues of A'*A, with small_outputs = \"array\""},
+	{"convergence", ARRAY_BLOCK_DOUBLE, OPTIONAL, "Converged eigenvalues, implicit restarts and products with A'*A, with small_outputs = \"array\""},
+	{"matvecs", UINT32, REQUIRED, "Products with A'*A"},
+	{"gram_ms", DOUBLE, REQUIRED, "Time to form the Gramian, on the slowest worker"},
+	{"arnoldi_ms", DOUBLE, REQUIRED, "Time of the Arnoldi iterations"},
+	{"broadcast_ms", DOUBLE, REQUIRED, "Time to broadcast the eigenvectors to the workers"},
+	{"u_ms", DOUBLE, REQUIRED, "Time to form V, S and U, on the slowest worker"}
+};
+
+static const alchemist_parameter_descriptor incremental_svd_in[] = {
+	{"U", DISTMATRIX, REQUIRED, "Left singular vectors of the rows so far"},
+	{"S", DISTMATRIX, REQUIRED, "Singular values, as a k x 1 matrix or an ARRAY_BLOCK_DOUBLE"},
+	{"V", DISTMATRIX, REQUIRED, "Right singular vectors"},
+	{"B", DISTMATRIX, REQUIRED, "New rows"},
+	{"V_layout", STRING, OPTIONAL, "Distribution of the new V: \"VR_STAR\" (default), \"VC_STAR\", \"MC_MR\" or \"STAR_STAR\""},
+	{"small_outputs", STRING, OPTIONAL, "\"matrix\" (default): S as a distributed matrix, or \"array\": as an array on every process"}
+};
+
+static const alchemist_parameter_descriptor incremental_svd_out[] = {
+	{"U", DISTMATRIX_VR_STAR, REQUIRED, "Left singular vectors of [A; B]"},
+	{"S", DISTMATRIX_VR_STAR, REQUIRED, "Singular values, an ARRAY_BLOCK_DOUBLE with small_outputs = \"array\""},
+	{"V", DISTMATRIX, REQUIRED, "Right singular vectors, in V_layout"},
+	{"new_directions", UINT32, REQUIRED, "Directions of B outside the span of the old V"}
+};
+
+static const alchemist_parameter_descriptor apply_u_in[] = {
+	{"U", VOID_POINTER, REQUIRED, "U_operator from truncated_svd"},
+	{"X", ARRAY_BLOCK_DOUBLE, REQUIRED, "k x c matrix, or k vector, on every process"}
+};
+
+static const alchemist_parameter_descriptor apply_u_out[] = {
+	{"Y", DISTMATRIX_VR_STAR, REQUIRED, "U*X, with the rows of A"}
+};
+
+static const alchemist_parameter_descriptor u_rows_in[] = {
+	{"U", VOID_POINTER, REQUIRED, "U_operator from truncated_svd"},
+	{"first", UINT64, OPTIONAL, "First row, 0 by default"},
+	{"count", UINT32, REQUIRED, "Number of rows"}
+};
+
+static const alchemist_parameter_descriptor u_rows_out[] = {
+	{"rows", ARRAY_BLOCK_DOUBLE, REQUIRED, "count x k rows of U, on every process"}
+};
+
+static const alchemist_parameter_descriptor stream_open_in[] = {
+	{"cols", UINT64, REQUIRED, "Number of columns"},
+	{"rows", UINT64, OPTIONAL, "Expected number of rows, to size the first buffer; it grows as needed"},
+	{"gram", BOOL, OPTIONAL, "Also sum A'*A as the rows arrive, true by default"}
+};
+
+static const alchemist_parameter_descriptor stream_open_out[] = {
+	{"stream", VOID_POINTER, REQUIRED, "Row stream, freed by release"}
+};
+
+static const alchemist_parameter_descriptor stream_append_in[] = {
+	{"stream", VOID_POINTER, REQUIRED, "Row stream from stream_open"},
+	{"rows", ARRAY_BLOCK_DOUBLE, REQUIRED, "b x cols block of rows, needed on the driver only; each worker is sent the rows it keeps"}
+};
+
+static const alchemist_parameter_descriptor stream_append_out[] = {
+	{"num_rows", UINT64, REQUIRED, "Rows in the stream so far"}
+};
+
+static const alchemist_parameter_descriptor stream_matrix_in[] = {
+	{"stream", VOID_POINTER, REQUIRED, "Row stream from stream_open"}
+};
+
+static const alchemist_parameter_descriptor stream_matrix_out[] = {
+	{"A", DISTMATRIX_VR_STAR, REQUIRED, "Rows so far, kept resident with their column statistics"},
+	{"column_sums", ARRAY_BLOCK_DOUBLE, REQUIRED, "Sums of the columns of A, on every process"},
+	{"G", DISTMATRIX_VR_STAR, OPTIONAL, "A'*A, if the stream keeps it"}
+};
+
+static const alchemist_parameter_descriptor release_in[] = {
+	{"*", DISTMATRIX, ALCHEMIST_PARAM_WILDCARD, "Resident output matrices, operators and streams to free"}
+};
+
+static const alchemist_parameter_descriptor load_matrix_in[] = {
+	{"path", STRING, REQUIRED, "Binary matrix file"},
+	{"mode", STRING, OPTIONAL, "\"mpiio\" (default) or \"mmap\""}
+};
+
+static const alchemist_parameter_descriptor load_matrix_out[] = {
+	{"A", DISTMATRIX_VR_STAR, REQUIRED, "Loaded matrix"}
+};
+
+static const alchemist_parameter_descriptor generate_matrix_in[] = {
+	{"rows", UINT64, REQUIRED, ""},
+	{"cols", UINT64, REQUIRED, ""},
+	{"rank", UINT32, OPTIONAL, "Of the low-rank part, 10 by default"},
+	{"decay", DOUBLE, OPTIONAL, "Ratio of consecutive singular values of the low-rank part, 0.9 by default"},
+	{"noise", DOUBLE, OPTIONAL, "Standard deviation of the noise times sqrt(rows), 0.01 by default"},
+	{"seed", UINT64, OPTIONAL, ""}
+};
+
+static const alchemist_parameter_descriptor generate_matrix_out[] = {
+	{"A", DISTMATRIX_VR_STAR, REQUIRED, "Generated matrix, the same for any number of workers"}
+};
+
+static const alchemist_parameter_descriptor save_matrix_in[] = {
+	{"A", DISTMATRIX, REQUIRED, "Matrix to write"},
+	{"path", STRING, REQUIRED, "Binary matrix file"},
+	{"panel_rows", UINT64, OPTIONAL, "Rows per panel"},
+	{"layout", STRING, OPTIONAL, "\"rows\" (default) or \"cyclic\""}
+};
+
+static const alchemist_parameter_descriptor create_groups_in[] = {
+	{"num_groups", UINT32, REQUIRED, "Number of worker groups, 0 to dissolve them"}
+};
+
+static const alchemist_parameter_descriptor create_groups_out[] = {
+	{"group", UINT32, OPTIONAL, "Group of the worker, from 1"},
+	{"num_groups", UINT32, OPTIONAL, "Number of groups, on the driver"}
+};
+
+static const alchemist_parameter_descriptor matmul_in[] = {
+	{"A", DISTMATRIX, REQUIRED, "Left factor"},
+	{"B", DISTMATRIX, REQUIRED, "Right factor"},
+	{"transpose_a", BOOL, OPTIONAL, "Multiply by A' instead of A"},
+	{"transpose_b", BOOL, OPTIONAL, "Multiply by B' instead of B"},
+	{"algorithm", STRING, OPTIONAL, "\"auto\" (default), \"default\", \"summa_a\", \"summa_b\", \"summa_c\" or \"summa_dot\""}
+};
+
+static const alchemist_parameter_descriptor matmul_out[] = {
+	{"C", DISTMATRIX_MC_MR, REQUIRED, "Product, kept resident"}
+};
+
+static const alchemist_parameter_descriptor gram_in[] = {
+	{"A", DISTMATRIX, REQUIRED, "Matrix"},
+	{"algorithm", STRING, OPTIONAL, "\"auto\" (default), \"local\": sum of local Gramians, or \"syrk\""}
+};
+
+static const alchemist_parameter_descriptor gram_out[] = {
+	{"G", DISTMATRIX, REQUIRED, "A'*A, [VR,STAR] if summed locally and [MC,MR] otherwise, kept resident"}
+};
+
+static const alchemist_parameter_descriptor column_stats_in[] = {
+	{"A", DISTMATRIX, REQUIRED, "Matrix"},
+	{"sketch", STRING, OPTIONAL, "\"none\" (default), \"count\": CountSketch, \"gaussian\" or \"srht\""},
+	{"sketch_rows", UINT32, OPTIONAL, "Rows of the sketch, four times the columns of A by default"},
+	{"seed", UINT64, OPTIONAL, "Seed of the sketch"},
+	{"cache", BOOL, OPTIONAL, "Keep the statistics of a resident A for later tasks, true by default"}
+};
+
+static const alchemist_parameter_descriptor column_stats_out[] = {
+	{"mean", DISTMATRIX_VR_STAR, REQUIRED, "Column means"},
+	{"variance", DISTMATRIX_VR_STAR, REQUIRED, "Sample variances of the columns"},
+	{"min", DISTMATRIX_VR_STAR, REQUIRED, "Column minima"},
+	{"max", DISTMATRIX_VR_STAR, REQUIRED, "Column maxima"},
+	{"norm", DISTMATRIX_VR_STAR, REQUIRED, "Column 2-norms"},
+	{"sketch", DISTMATRIX_VR_STAR, OPTIONAL, "S*A, if a sketch was asked for"}
+};
+
+static const alchemist_parameter_descriptor sketched_lstsq_in[] = {
+	{"A", DISTMATRIX, REQUIRED, "Tall matrix"},
+	{"b", DISTMATRIX, REQUIRED, "Right-hand sides, as many rows as A"},
+	{"sketch", STRING, OPTIONAL, "\"count\" (default): CountSketch, \"gaussian\" or \"srht\""},
+	{"sketch_rows", UINT32, OPTIONAL, "Rows of the sketch, four times the columns of A by default"},
+	{"seed", UINT64, OPTIONAL, "Seed of the sketch"},
+	{"solver", STRING, OPTIONAL, "\"direct\" (default): solve the sketched problem, or \"lsqr\": precondition LSQR with it"},
+	{"tol", DOUBLE, OPTIONAL, "Relative residual of the normal equations at which LSQR stops"},
+	{"max_iterations", UINT32, OPTIONAL, "Of LSQR"}
+};
+
+static const alchemist_parameter_descriptor sketched_lstsq_out[] = {
+	{"x", DISTMATRIX_VR_STAR, REQUIRED, "Least-squares solution, one column per right-hand side"},
+	{"iterations", UINT32, REQUIRED, "LSQR iterations, 0 for a direct solve"},
+	{"residual", DOUBLE, REQUIRED, "Estimate of |A*x - b|, of the sketched problem for a direct solve"}
+};
+
+static const alchemist_parameter_descriptor nmf_in[] = {
+	{"A", DISTMATRIX, REQUIRED, "Nonnegative matrix"},
+	{"rank", UINT32, REQUIRED, "Inner dimension of W*H"},
+	{"algorithm", STRING, OPTIONAL, "\"hals\" (default) or \"mu\": multiplicative updates"},
+	{"max_iterations", UINT32, OPTIONAL, "100 by default"},
+	{"tol", DOUBLE, OPTIONAL, "Relative change of the error at which to stop, 1e-4 by default"},
+	{"seed", UINT64, OPTIONAL, "Seed of the random start"}
+};
+
+static const alchemist_parameter_descriptor nmf_out[] = {
+	{"W", DISTMATRIX_VR_STAR, REQUIRED, "Left factor, m x rank"},
+	{"H", DISTMATRIX_VR_STAR, REQUIRED, "Right factor, rank x n"},
+	{"iterations", UINT32, REQUIRED, ""},
+	{"error", DOUBLE, REQUIRED, "|A - W*H|_F / |A|_F"}
+};
+
+static const alchemist_parameter_descriptor cur_in[] = {
+	{"A", DISTMATRIX, REQUIRED, "Matrix"},
+	{"V", DISTMATRIX, REQUIRED, "Right singular vectors of A, from truncated_svd"},
+	{"columns", UINT32, REQUIRED, "Number of columns to keep"},
+	{"rows", UINT32, OPTIONAL, "Expected number of rows to keep, as many as columns by default"},
+	{"selection", STRING, OPTIONAL, "\"random\" (default): sample columns by leverage score, or \"deterministic\": the largest scores"},
+	{"seed", UINT64, OPTIONAL, "Seed of the sampling"}
+};
+
+static const alchemist_parameter_descriptor cur_out[] = {
+	{"C", DISTMATRIX_VR_STAR, REQUIRED, "Selected columns of A"},
+	{"U", DISTMATRIX_VR_STAR, REQUIRED, "pinv(C)*A*pinv(R)"},
+	{"R", DISTMATRIX_VR_STAR, REQUIRED, "Selected rows of A"},
+	{"column_indices", DISTMATRIX_VR_STAR, REQUIRED, "0-based indices of the columns in C"},
+	{"row_indices", DISTMATRIX_VR_STAR, REQUIRED, "0-based indices of the rows in R"},
+	{"num_rows", UINT32, REQUIRED, "Rows in R"}
+};
+
+static const alchemist_parameter_descriptor random_features_in[] = {
+	{"A", DISTMATRIX, REQUIRED, "Data, one point per row"},
+	{"features", UINT32, REQUIRED, "Number of random features"},
+	{"gamma", DOUBLE, OPTIONAL, "Of the kernel exp(-gamma |x - y|^2), 1/columns by default"},
+	{"seed", UINT64, OPTIONAL, "Seed of the random frequencies and phases"}
+};
+
+static const alchemist_parameter_descriptor nystrom_in[] = {
+	{"A", DISTMATRIX, REQUIRED, "Data, one point per row"},
+	{"landmarks", UINT32, REQUIRED, "Number of rows of A to use as landmarks"},
+	{"gamma", DOUBLE, OPTIONAL, "Of the kernel exp(-gamma |x - y|^2), 1/columns by default"},
+	{"seed", UINT64, OPTIONAL, "Seed of the landmark selection"}
+};
+
+static const alchemist_parameter_descriptor kernel_features_out[] = {
+	{"Z", DISTMATRIX_VR_STAR, REQUIRED, "Features, Z*Z' approximating the kernel matrix, kept resident"},
+	{"num_features", UINT32, REQUIRED, "Columns of Z"}
+};
+
+static const uint8_t grid_layouts[] = {DISTMATRIX_MC_MR};
+
+#define PARAMS(a) COUNT(a), a
+#define NO_PARAMS 0, nullptr
+#define LAYOUTS(a) COUNT(a), a
+#define ANY_LAYOUT 0, nullptr
+#define DESCRIBE_TASK(name, description, inputs, outputs, layouts) {#name, description, inputs, outputs, layouts},
+
+static const alchemist_task_descriptor tasks[] = {
+	{"create_groups", "Splits the workers into groups that run tasks independently", PARAMS(create_groups_in),
+			PARAMS(create_groups_out), ANY_LAYOUT},
+	TESTLIB_TASKS(DESCRIBE_TASK)
+};
+
+static const alchemist_library_descriptor descriptor = {
+	ALCHEMIST_LIBRARY_ABI_VERSION,
+	(uint32_t) sizeof(alchemist_library_descriptor),
+	"TestLib",
+	"0.2",
+	ALCHEMIST_CAP_RESIDENT_OUTPUTS | ALCHEMIST_CAP_MPIIO | ALCHEMIST_CAP_MMAP | ALCHEMIST_CAP_CHECKPOINT |
+			ALCHEMIST_CAP_WORKER_GROUPS | ALCHEMIST_CAP_ASYNC,
+	COUNT(double_types), double_types,
+	COUNT(tasks), tasks
+};
+
+}
+
+extern "C" const alchemist_library_descriptor * alchemist_describe_library(void)
+{
+	return &alchemist::descriptor;
+}
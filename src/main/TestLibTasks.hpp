@@ -0,0 +1,51 @@
+#ifndef TESTLIB_TASKS_HPP
+#define TESTLIB_TASKS_HPP
+
+// The tasks of TestLib, in the order alchemist_describe_library lists them. TestLib::dispatch calls
+// TestLib::run_<name> for each, and TestLibDescriptor.cpp describes each from its <name>_in and
+// <name>_out parameter arrays, so a task is added or removed here and nowhere else.
+//
+//   TASK(name, description, inputs, outputs, layouts)
+//
+// inputs and outputs are PARAMS(array) or NO_PARAMS, layouts is LAYOUTS(array) or ANY_LAYOUT; only
+// TestLibDescriptor.cpp expands them. create_groups is handled by TestLib::run itself and described
+// separately.
+
+#define TESTLIB_TASKS(TASK) \
+	TASK(greet, "Echoes its scalar inputs", PARAMS(greet_in), PARAMS(greet_out), ANY_LAYOUT) \
+	TASK(truncated_svd, "Rank-k SVD through Arnoldi iterations on A'*A", PARAMS(truncated_svd_in), \
+			PARAMS(truncated_svd_out), LAYOUTS(row_layouts)) \
+	TASK(incremental_svd, "Rank-k SVD of [A; B] from that of A and the new rows B", PARAMS(incremental_svd_in), \
+			PARAMS(incremental_svd_out), ANY_LAYOUT) \
+	TASK(apply_u, "U*X for the lazy left singular vectors of truncated_svd", PARAMS(apply_u_in), \
+			PARAMS(apply_u_out), ANY_LAYOUT) \
+	TASK(u_rows, "A block of rows of the lazy left singular vectors of truncated_svd", PARAMS(u_rows_in), \
+			PARAMS(u_rows_out), ANY_LAYOUT) \
+	TASK(stream_open, "Starts a matrix that is appended to by blocks of rows", PARAMS(stream_open_in), \
+			PARAMS(stream_open_out), ANY_LAYOUT) \
+	TASK(stream_append, "Appends a block of rows to a stream, updating its statistics", PARAMS(stream_append_in), \
+			PARAMS(stream_append_out), ANY_LAYOUT) \
+	TASK(stream_matrix, "The rows of a stream so far, with their column sums and Gramian", PARAMS(stream_matrix_in), \
+			PARAMS(stream_matrix_out), ANY_LAYOUT) \
+	TASK(release, "Frees resident output matrices, operators and streams", PARAMS(release_in), NO_PARAMS, ANY_LAYOUT) \
+	TASK(load_matrix, "Reads a binary matrix file", PARAMS(load_matrix_in), PARAMS(load_matrix_out), ANY_LAYOUT) \
+	TASK(save_matrix, "Writes a binary matrix file", PARAMS(save_matrix_in), NO_PARAMS, LAYOUTS(row_layouts)) \
+	TASK(generate_matrix, "Low-rank plus noise matrix generated in place from a seed", PARAMS(generate_matrix_in), \
+			PARAMS(generate_matrix_out), ANY_LAYOUT) \
+	TASK(matmul, "C = op(A)*op(B) with a SUMMA variant chosen from the shapes", PARAMS(matmul_in), \
+			PARAMS(matmul_out), LAYOUTS(grid_layouts)) \
+	TASK(gram, "A'*A on a resident matrix", PARAMS(gram_in), PARAMS(gram_out), ANY_LAYOUT) \
+	TASK(column_stats, "Column means, variances, extremes and norms, and an optional sketch, in one pass", \
+			PARAMS(column_stats_in), PARAMS(column_stats_out), ANY_LAYOUT) \
+	TASK(sketched_lstsq, "Least squares for tall A from a one-pass sketch, optionally refined by LSQR", \
+			PARAMS(sketched_lstsq_in), PARAMS(sketched_lstsq_out), LAYOUTS(row_layouts)) \
+	TASK(nmf, "Nonnegative factorization A ~ W*H by alternating updates", PARAMS(nmf_in), PARAMS(nmf_out), \
+			LAYOUTS(row_layouts)) \
+	TASK(cur, "A ~ C*U*R from actual columns and rows, chosen by leverage scores", PARAMS(cur_in), PARAMS(cur_out), \
+			LAYOUTS(row_layouts)) \
+	TASK(random_features, "Random Fourier features for the Gaussian kernel", PARAMS(random_features_in), \
+			PARAMS(kernel_features_out), LAYOUTS(row_layouts)) \
+	TASK(nystrom, "Nystrom features for the Gaussian kernel", PARAMS(nystrom_in), PARAMS(kernel_features_out), \
+			LAYOUTS(row_layouts))
+
+#endif // TESTLIB_TASKS_HPP
@@ -0,0 +1,148 @@
+#ifndef ALCHEMIST_LIBRARY_H
+#define ALCHEMIST_LIBRARY_H
+
+/*
+ * Plain C interface of an Alchemist library shared object.
+ *
+ * alchemist_describe_library() returns a static descriptor of the library: its ABI version, the
+ * tasks it implements with their parameter schemas, the matrix element types it accepts and the
+ * matrix layouts each task prefers. It does no MPI communication and may be called before
+ * MPI_Init, so the server can dlsym it on a single process to plan data layout and reject
+ * unsupported requests before any collective call is made.
+ *
+ * Datatype codes are the values of the alchemist::datatype enumeration in Alchemist.hpp.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "mpi.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ALCHEMIST_LIBRARY_ABI_VERSION 1
+
+/* Capability flags */
+#define ALCHEMIST_CAP_RESIDENT_OUTPUTS   (UINT64_C(1) << 0)	/* Output matrices stay owned by the library until released */
+#define ALCHEMIST_CAP_MPIIO              (UINT64_C(1) << 1)	/* load_matrix/save_matrix with collective MPI-IO */
+#define ALCHEMIST_CAP_MMAP               (UINT64_C(1) << 2)	/* load_matrix with mode "mmap" */
+#define ALCHEMIST_CAP_CHECKPOINT         (UINT64_C(1) << 3)	/* Checkpoint/restart of iterative tasks */
+#define ALCHEMIST_CAP_WORKER_GROUPS      (UINT64_C(1) << 4)	/* Every task takes an optional UINT32 "group" parameter,
+																   see the create_groups task */
+#define ALCHEMIST_CAP_ASYNC              (UINT64_C(1) << 5)	/* Tasks can be started without blocking, see alchemist_run_async */
+
+/* Parameter flags */
+#define ALCHEMIST_PARAM_REQUIRED         (1u << 0)
+#define ALCHEMIST_PARAM_WILDCARD         (1u << 1)	/* Name "*": any number of parameters of this type */
+
+typedef struct alchemist_parameter_descriptor {
+	const char * name;
+	uint8_t dt;
+	uint32_t flags;
+	const char * description;
+} alchemist_parameter_descriptor;
+
+typedef struct alchemist_task_descriptor {
+	const char * name;
+	const char * description;
+
+	uint32_t num_inputs;
+	const alchemist_parameter_descriptor * inputs;
+	uint32_t num_outputs;
+	const alchemist_parameter_descriptor * outputs;
+
+	/* Layouts (DISTMATRIX_* datatype codes) in which matrix inputs are used without redistribution,
+	   most preferred first */
+	uint32_t num_layouts;
+	const uint8_t * preferred_layouts;
+} alchemist_task_descriptor;
+
+typedef struct alchemist_library_descriptor {
+	uint32_t abi_version;
+	uint32_t struct_size;					/* sizeof(alchemist_library_descriptor) when built */
+
+	const char * name;
+	const char * version;
+	uint64_t capabilities;
+
+	/* Element types accepted in matrices */
+	uint32_t num_datatypes;
+	const uint8_t * datatypes;
+
+	uint32_t num_tasks;
+	const alchemist_task_descriptor * tasks;
+} alchemist_library_descriptor;
+
+/* Entry points. Only alchemist_describe_library is free of MPI calls. */
+const alchemist_library_descriptor * alchemist_describe_library(void);
+
+/* Same as create_library, but C-callable; returns NULL if abi_version is not supported */
+void * alchemist_create_library(MPI_Comm * world, uint32_t abi_version);
+void alchemist_destroy_library(void * library);
+
+/* Task states, as returned by alchemist_task_state */
+#define ALCHEMIST_TASK_RUNNING           0
+#define ALCHEMIST_TASK_DONE              1
+#define ALCHEMIST_TASK_FAILED            2
+#define ALCHEMIST_TASK_CANCELLED         3
+
+/* Input or output of a task; p points to the value as in alchemist::Parameter */
+typedef struct alchemist_parameter {
+	const char * name;
+	uint8_t dt;
+	void * p;
+} alchemist_parameter;
+
+typedef struct alchemist_task alchemist_task;
+
+/* Progress of an iterative task, as its driver reports it once per iteration */
+typedef struct alchemist_progress {
+	uint64_t iteration;
+	uint64_t max_iterations;			/* 0 if unknown */
+	double residual;					/* Negative if unknown */
+	double elapsed_seconds;
+	double eta_seconds;					/* Negative if unknown, 0 once the task has finished */
+} alchemist_progress;
+
+/* Starts a task of a library from alchemist_create_library without waiting for it. Collective like
+   a synchronous run: every process calls it, in the same order, from one thread. The values the
+   inputs point to must stay valid until the task has finished. Returns NULL only for a NULL library
+   or task name; a task that cannot run fails, and alchemist_task_wait returns -1. */
+alchemist_task * alchemist_run_async(void * library, const char * task_name, const alchemist_parameter * inputs, uint32_t num_inputs);
+
+/* The functions below make no MPI calls and can be called from any thread */
+
+/* 1 once the task has finished, successfully or not, 0 while it runs */
+int alchemist_task_poll(const alchemist_task * task);
+uint8_t alchemist_task_state(const alchemist_task * task);
+/* Progress so far. Only the process that drives the task, rank 0 of world or of its worker group,
+   knows more than the elapsed time. The ETA follows the convergence rate of the residual where the
+   task reports a target residual, and the iteration count otherwise. */
+void alchemist_task_progress(const alchemist_task * task, alchemist_progress * progress);
+/* Asks the task to stop at its next cancellation point. Only the call on the process that drives the
+   task counts; the driver passes the request on to the workers. */
+void alchemist_task_cancel(alchemist_task * task);
+/* Blocks until the task has finished and returns its result, 0 on success */
+int alchemist_task_wait(alchemist_task * task);
+/* Message of the exception that failed the task, "" if none */
+const char * alchemist_task_error(const alchemist_task * task);
+/* Number of outputs of a finished task, of which the first capacity are copied to outputs; 0 while
+   the task runs. Names and values stay valid until alchemist_task_free. */
+uint32_t alchemist_task_outputs(const alchemist_task * task, alchemist_parameter * outputs, uint32_t capacity);
+/* Waits for the task and frees the handle; resident output matrices stay until released */
+void alchemist_task_free(alchemist_task * task);
+
+static inline const alchemist_task_descriptor * alchemist_find_task(const alchemist_library_descriptor * library, const char * name)
+{
+	uint32_t i;
+	for (i = 0; i < library->num_tasks; i++)
+		if (strcmp(library->tasks[i].name, name) == 0) return &library->tasks[i];
+	return NULL;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ALCHEMIST_LIBRARY_H */
@@ -0,0 +1,175 @@
+#include "nla.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+namespace alchemist {
+
+// Eigenvalues of a Gram matrix below this fraction of the largest belong to singular values under
+// 1e-6 of the largest, which forming the Gram matrix has mostly lost to rounding; inverting them
+// would only amplify noise
+static const double pinv_cutoff = 1e-12;
+
+El::Int psd_pinv(const El::Matrix<double> & G, El::Matrix<double> & P)
+{
+	El::Int c = G.Height();
+	El::Matrix<double> work(G), w, Z;
+	El::HermitianEig(El::LOWER, work, w, Z);
+
+	double largest = 0.0;
+	for (El::Int q = 0; q < c; q++) largest = std::max(largest, std::abs(w.Get(q, 0)));
+	double cutoff = pinv_cutoff * largest;
+
+	El::Int rank = 0;
+	El::Zeros(P, c, c);
+	for (El::Int q = 0; q < c; q++) {
+		double lambda = w.Get(q, 0);
+		if (lambda <= cutoff) continue;
+		rank++;
+		for (El::Int j = 0; j < c; j++)
+			for (El::Int i = 0; i < c; i++) P.Update(i, j, Z.Get(i, q) * Z.Get(j, q) / lambda);
+	}
+	return rank;
+}
+
+std::vector<double> leverage_scores(const El::AbstractDistMatrix<double> & V)
+{
+	const El::Matrix<double> & local = V.LockedMatrix();
+	std::vector<double> scores(V.Height(), 0.0);
+
+	for (El::Int jl = 0; jl < local.Width(); jl++)
+		for (El::Int il = 0; il < local.Height(); il++) scores[V.GlobalRow(il)] += local.Get(il, jl) * local.Get(il, jl);
+
+	MPI_Allreduce(MPI_IN_PLACE, scores.data(), (int) scores.size(), MPI_DOUBLE, MPI_SUM, V.Grid().VRComm().comm);
+	return scores;
+}
+
+std::vector<El::Int> select_columns(const std::vector<double> & scores, El::Int c, bool random, uint64_t seed)
+{
+	El::Int n = (El::Int) scores.size();
+	c = std::min(c, n);
+
+	// Sampling without replacement: the c largest keys log(u)/score (Efraimidis and Spirakis)
+	std::vector<double> keys(n);
+	for (El::Int j = 0; j < n; j++) {
+		if (!random) keys[j] = scores[j];
+		else if (scores[j] <= 0.0) keys[j] = -std::numeric_limits<double>::infinity();
+		else {
+			double u = ((double) (hash_row(seed, (uint64_t) j) >> 11) + 1.0) * (1.0 / 9007199254740992.0);
+			keys[j] = std::log(u) / scores[j];
+		}
+	}
+
+	std::vector<El::Int> order(n);
+	std::iota(order.begin(), order.end(), El::Int(0));
+	std::stable_sort(order.begin(), order.end(), [&keys](El::Int a, El::Int b) { return keys[a] > keys[b]; });
+
+	std::vector<El::Int> columns(order.begin(), order.begin() + c);
+	std::sort(columns.begin(), columns.end());
+	return columns;
+}
+
+void gather_rows(const El::AbstractDistMatrix<double> & A, const std::vector<El::Int> & local_rows, std::vector<El::Int> & rows,
+		El::Matrix<double> & R)
+{
+	const El::Matrix<double> & Al = A.LockedMatrix();
+	El::Int n = A.Width();
+	MPI_Comm comm = A.Grid().VRComm().comm;
+
+	// Rows of every process, one after another
+	int p;
+	MPI_Comm_size(comm, &p);
+	int local_count = (int) local_rows.size();
+	std::vector<int> counts(p), displacements(p), value_counts(p), value_displacements(p);
+	MPI_Allgather(&local_count, 1, MPI_INT, counts.data(), 1, MPI_INT, comm);
+	int total = 0;
+	for (int q = 0; q < p; q++) {
+		displacements[q] = total;
+		value_counts[q] = counts[q] * (int) n;
+		value_displacements[q] = total * (int) n;
+		total += counts[q];
+	}
+
+	std::vector<long long> local_indices(local_count), indices(total);
+	std::vector<double> local_values((size_t) local_count * n), values((size_t) total * n);
+	for (int s = 0; s < local_count; s++) {
+		local_indices[s] = (long long) A.GlobalRow(local_rows[s]);
+		for (El::Int j = 0; j < n; j++) local_values[s * n + j] = Al.Get(local_rows[s], j);
+	}
+	MPI_Allgatherv(local_indices.data(), local_count, MPI_LONG_LONG, indices.data(), counts.data(), displacements.data(), MPI_LONG_LONG, comm);
+	MPI_Allgatherv(local_values.data(), local_count * (int) n, MPI_DOUBLE, values.data(), value_counts.data(),
+			value_displacements.data(), MPI_DOUBLE, comm);
+
+	std::vector<int> order(total);
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [&indices](int a, int b) { return indices[a] < indices[b]; });
+	rows.resize(total);
+	El::Zeros(R, total, n);
+	for (int s = 0; s < total; s++) {
+		rows[s] = (El::Int) indices[order[s]];
+		for (El::Int j = 0; j < n; j++) R.Set(s, j, values[(size_t) order[s] * n + j]);
+	}
+}
+
+void cur(const BufferPool_ptr & pool, const El::AbstractDistMatrix<double> & A, const std::vector<El::Int> & columns,
+		El::Int r, uint64_t seed, CURFactors & factors)
+{
+	El::Int m = A.Height(), n = A.Width(), c = (El::Int) columns.size();
+	const El::Matrix<double> & Al = A.LockedMatrix();
+	El::Int local_height = Al.Height();
+	MPI_Comm comm = A.Grid().VRComm().comm;
+
+	factors.columns = columns;
+	factors.C = make_pooled_distmatrix<El::VR, El::STAR>(pool, m, c, A.Grid());
+	El::Matrix<double> & Cl = factors.C->Matrix();
+	for (El::Int q = 0; q < c; q++)
+		std::copy(Al.LockedBuffer(0, columns[q]), Al.LockedBuffer(0, columns[q]) + local_height, Cl.Buffer(0, q));
+
+	// C'*C and C'*A side by side, for one reduction
+	El::Matrix<double> reduced, CtC, CtA;
+	El::Zeros(reduced, c, c + n);
+	El::View(CtC, reduced, 0, 0, c, c);
+	El::View(CtA, reduced, 0, c, c, n);
+	if (local_height > 0) {
+		El::Gemm(El::TRANSPOSE, El::NORMAL, 1.0, Cl, Cl, 0.0, CtC);
+		El::Gemm(El::TRANSPOSE, El::NORMAL, 1.0, Cl, Al, 0.0, CtA);
+	}
+	MPI_Allreduce(MPI_IN_PLACE, reduced.Buffer(), (int) (c * (c + n)), MPI_DOUBLE, MPI_SUM, comm);
+
+	El::Matrix<double> Cpinv;
+	El::Int rank = psd_pinv(CtC, Cpinv);
+
+	// Row i is kept with probability r*l(i)/rank, where l(i) = C(i,:)*pinv(C'*C)*C(i,:)' sums to rank
+	El::Matrix<double> CP;
+	El::Zeros(CP, local_height, c);
+	if (local_height > 0) El::Gemm(El::NORMAL, El::NORMAL, 1.0, Cl, Cpinv, 0.0, CP);
+
+	std::vector<El::Int> local_rows;
+	for (El::Int il = 0; il < local_height; il++) {
+		double score = 0.0;
+		for (El::Int q = 0; q < c; q++) score += CP.Get(il, q) * Cl.Get(il, q);
+		double probability = (rank > 0) ? std::min(1.0, (double) r * score / (double) rank) : 0.0;
+		uint64_t row = (uint64_t) A.GlobalRow(il);
+		if ((double) (hash_row(~seed, row) >> 11) * (1.0 / 9007199254740992.0) < probability) local_rows.push_back(il);
+	}
+
+	gather_rows(A, local_rows, factors.rows, factors.R);
+	El::Int total = (El::Int) factors.rows.size();
+
+	// U = pinv(C'*C)*(C'*A)*R'*pinv(R*R')
+	El::Matrix<double> M, N, RRt, Rpinv;
+	El::Zeros(M, c, n);
+	El::Gemm(El::NORMAL, El::NORMAL, 1.0, Cpinv, CtA, 0.0, M);
+	El::Zeros(N, c, total);
+	El::Zeros(RRt, total, total);
+	if (total > 0) {
+		El::Gemm(El::NORMAL, El::TRANSPOSE, 1.0, M, factors.R, 0.0, N);
+		El::Gemm(El::NORMAL, El::TRANSPOSE, 1.0, factors.R, factors.R, 0.0, RRt);
+	}
+	psd_pinv(RRt, Rpinv);
+	El::Zeros(factors.U, c, total);
+	if (total > 0) El::Gemm(El::NORMAL, El::NORMAL, 1.0, N, Rpinv, 0.0, factors.U);
+}
+
+}
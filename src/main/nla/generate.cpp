@@ -0,0 +1,51 @@
+#include "nla.hpp"
+
+#include <algorithm>
+
+namespace alchemist {
+
+std::shared_ptr<El::DistMatrix<double, El::VR, El::STAR> > low_rank_plus_noise(const BufferPool_ptr & pool,
+		El::Int m, El::Int n, El::Int rank, double decay, double noise, uint64_t seed, const El::Grid & grid)
+{
+	auto A = make_pooled_distmatrix<El::VR, El::STAR>(pool, m, n, grid);
+	El::Matrix<double> & Al = A->Matrix();
+	El::Int local_height = Al.Height();
+	rank = std::min(rank, std::min(m, n));
+
+	// V*diag(s) on every process, the local rows of U, and their product
+	El::Matrix<double> VS, Ul;
+	El::Zeros(VS, n, rank);
+	std::vector<double> row(rank);
+	for (El::Int j = 0; j < n; j++) {
+		gaussian_vector(~seed, (uint64_t) j, rank, 1.0 / std::sqrt((double) n), row.data());
+		double s = 1.0;
+		for (El::Int q = 0; q < rank; q++, s *= decay) VS.Set(j, q, row[q] * s);
+	}
+	El::Zeros(Ul, local_height, rank);
+	for (El::Int il = 0; il < local_height; il++) {
+		gaussian_vector(seed, (uint64_t) A->GlobalRow(il), rank, 1.0 / std::sqrt((double) m), row.data());
+		for (El::Int q = 0; q < rank; q++) Ul.Set(il, q, row[q]);
+	}
+	if (local_height > 0 && rank > 0) El::Gemm(El::NORMAL, El::TRANSPOSE, 1.0, Ul, VS, 0.0, Al);
+	else El::Zeros(Al, local_height, n);
+
+	if (noise > 0.0) {
+		double * buffer = Al.Buffer();
+		El::Int ldim = Al.LDim();
+
+		#pragma omp parallel
+		{
+			std::vector<double> e(n);
+
+			#pragma omp for schedule(static)
+			for (El::Int il = 0; il < local_height; il++) {
+				gaussian_vector(seed ^ 0x5bd1e995ull, (uint64_t) A->GlobalRow(il), n, noise / std::sqrt((double) m), e.data());
+				for (El::Int j = 0; j < n; j++) buffer[il + j * ldim] += e[j];
+			}
+		}
+	}
+
+	return A;
+}
+
+}
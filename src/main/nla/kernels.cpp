@@ -0,0 +1,169 @@
+#include "nla.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace alchemist {
+
+static const double two_pi = 6.283185307179586;
+
+// Rows per block, so that a block of features stays in cache
+static El::Int block_rows(El::Int width)
+{
+	return std::max(El::Int(16), El::Int(32768) / std::max(width, El::Int(1)));
+}
+
+std::shared_ptr<El::DistMatrix<double, El::VR, El::STAR> > random_fourier_features(const BufferPool_ptr & pool,
+		const El::AbstractDistMatrix<double> & A, El::Int D, double gamma, uint64_t seed)
+{
+	El::Int d = A.Width();
+	const El::Matrix<double> & Al = A.LockedMatrix();
+	El::Int local_height = Al.Height();
+
+	El::Matrix<double> W;
+	El::Zeros(W, d, D);
+	std::vector<double> b(D);
+	for (El::Int f = 0; f < D; f++) {
+		gaussian_vector(seed, (uint64_t) f, d, std::sqrt(2.0 * gamma), W.Buffer(0, f));
+		b[f] = two_pi * (double) (hash_row(~seed, (uint64_t) f) >> 11) * (1.0 / 9007199254740992.0);
+	}
+
+	auto Z = make_pooled_distmatrix<El::VR, El::STAR>(pool, A.Height(), D, A.Grid());
+	El::Matrix<double> & Zl = Z->Matrix();
+	const double scale = std::sqrt(2.0 / (double) D);
+
+	El::Int block = block_rows(D);
+	El::Matrix<double> Ablock, Zblock;
+	for (El::Int i0 = 0; i0 < local_height; i0 += block) {
+		El::Int rows = std::min(block, local_height - i0);
+		El::LockedView(Ablock, Al, i0, 0, rows, d);
+		El::View(Zblock, Zl, i0, 0, rows, D);
+		El::Gemm(El::NORMAL, El::NORMAL, 1.0, Ablock, W, 0.0, Zblock);
+
+		#pragma omp parallel for schedule(static)
+		for (El::Int f = 0; f < D; f++) {
+			double * z = Zblock.Buffer(0, f);
+			double shift = b[f];
+			#pragma omp simd
+			for (El::Int i = 0; i < rows; i++) z[i] = scale * std::cos(z[i] + shift);
+		}
+	}
+
+	return Z;
+}
+
+// exp(-gamma |x - y|^2) from x*y' and the squared norms, in place
+static inline void gaussian_kernel(double * k, El::Int length, const double * row_norms, double column_norm, double gamma)
+{
+	#pragma omp simd
+	for (El::Int i = 0; i < length; i++)
+		k[i] = std::exp(-gamma * std::max(row_norms[i] + column_norm - 2.0 * k[i], 0.0));
+}
+
+std::shared_ptr<El::DistMatrix<double, El::VR, El::STAR> > nystrom_features(const BufferPool_ptr & pool,
+		const El::AbstractDistMatrix<double> & A, El::Int num_landmarks, double gamma, uint64_t seed)
+{
+	El::Int m = A.Height(), d = A.Width();
+	const El::Matrix<double> & Al = A.LockedMatrix();
+	El::Int local_height = Al.Height();
+	MPI_Comm comm = A.Grid().VRComm().comm;
+	El::Int L = std::min(num_landmarks, m);
+
+	// The landmarks are the L rows with the smallest hashes; every process offers its L smallest
+	std::vector<std::pair<uint64_t, uint64_t> > local_keys(local_height);
+	for (El::Int il = 0; il < local_height; il++) {
+		uint64_t row = (uint64_t) A.GlobalRow(il);
+		local_keys[il] = std::make_pair(hash_row(seed, row), row);
+	}
+	El::Int offered = std::min(L, local_height);
+	std::partial_sort(local_keys.begin(), local_keys.begin() + offered, local_keys.end());
+	local_keys.resize(L, std::make_pair(std::numeric_limits<uint64_t>::max(), std::numeric_limits<uint64_t>::max()));
+
+	int p;
+	MPI_Comm_size(comm, &p);
+	std::vector<std::pair<uint64_t, uint64_t> > keys((size_t) p * L);
+	MPI_Allgather(local_keys.data(), (int) (2 * L), MPI_UINT64_T, keys.data(), (int) (2 * L), MPI_UINT64_T, comm);
+	std::partial_sort(keys.begin(), keys.begin() + L, keys.end());
+
+	std::vector<El::Int> landmarks(L);
+	for (El::Int j = 0; j < L; j++) landmarks[j] = (El::Int) keys[j].second;
+	std::sort(landmarks.begin(), landmarks.end());
+
+	std::vector<El::Int> local_rows, rows;
+	for (El::Int il = 0; il < local_height; il++)
+		if (std::binary_search(landmarks.begin(), landmarks.end(), A.GlobalRow(il))) local_rows.push_back(il);
+	El::Matrix<double> X;
+	gather_rows(A, local_rows, rows, X);
+
+	std::vector<double> landmark_norms(L, 0.0);
+	for (El::Int j = 0; j < d; j++)
+		for (El::Int i = 0; i < L; i++) landmark_norms[i] += X.Get(i, j) * X.Get(i, j);
+
+	// K(L, L) = U*S*U', keeping the eigenvalues that psd_pinv would
+	El::Matrix<double> K, S, U;
+	El::Zeros(K, L, L);
+	El::Gemm(El::NORMAL, El::TRANSPOSE, 1.0, X, X, 0.0, K);
+	for (El::Int j = 0; j < L; j++) gaussian_kernel(K.Buffer(0, j), L, landmark_norms.data(), landmark_norms[j], gamma);
+	El::HermitianEig(El::LOWER, K, S, U);
+
+	double largest = 0.0;
+	for (El::Int q = 0; q < L; q++) largest = std::max(largest, S.Get(q, 0));
+	std::vector<El::Int> kept;
+	for (El::Int q = 0; q < L; q++)
+		if (S.Get(q, 0) > 1e-12 * largest) kept.push_back(q);
+	El::Int r = (El::Int) kept.size();
+
+	El::Matrix<double> T;
+	El::Zeros(T, L, r);
+	for (El::Int q = 0; q < r; q++) {
+		double scale = 1.0 / std::sqrt(S.Get(kept[q], 0));
+		for (El::Int i = 0; i < L; i++) T.Set(i, q, U.Get(i, kept[q]) * scale);
+	}
+
+	auto Z = make_pooled_distmatrix<El::VR, El::STAR>(pool, m, r, A.Grid());
+	El::Matrix<double> & Zl = Z->Matrix();
+
+	// A few landmarks are cheaper to compare with directly than through Gemm
+	const LocalKernels & kernels = local_kernels();
+	bool direct = L <= max_small_k;
+
+	El::Int block = block_rows(L);
+	El::Matrix<double> Ablock, Kblock, Zblock;
+	std::vector<double> row_norms(block);
+	for (El::Int i0 = 0; i0 < local_height; i0 += block) {
+		El::Int rows_in_block = std::min(block, local_height - i0);
+		El::LockedView(Ablock, Al, i0, 0, rows_in_block, d);
+		El::Zeros(Kblock, rows_in_block, L);
+
+		if (direct) {
+			kernels.squared_distances(Ablock.LockedBuffer(), rows_in_block, Ablock.LDim(), d, X.LockedBuffer(), X.LDim(),
+					landmark_norms.data(), L, Kblock.Buffer(), Kblock.LDim());
+			for (El::Int j = 0; j < L; j++) {
+				double * k = Kblock.Buffer(0, j);
+				#pragma omp simd
+				for (El::Int i = 0; i < rows_in_block; i++) k[i] = std::exp(-gamma * k[i]);
+			}
+		}
+		else {
+			std::fill(row_norms.begin(), row_norms.end(), 0.0);
+			for (El::Int j = 0; j < d; j++) {
+				const double * a = Ablock.LockedBuffer(0, j);
+				for (El::Int i = 0; i < rows_in_block; i++) row_norms[i] += a[i] * a[i];
+			}
+
+			El::Gemm(El::NORMAL, El::TRANSPOSE, 1.0, Ablock, X, 0.0, Kblock);
+			#pragma omp parallel for schedule(static)
+			for (El::Int j = 0; j < L; j++) gaussian_kernel(Kblock.Buffer(0, j), rows_in_block, row_norms.data(), landmark_norms[j], gamma);
+		}
+
+		if (r > 0) {
+			El::View(Zblock, Zl, i0, 0, rows_in_block, r);
+			El::Gemm(El::NORMAL, El::NORMAL, 1.0, Kblock, T, 0.0, Zblock);
+		}
+	}
+
+	return Z;
+}
+
+}
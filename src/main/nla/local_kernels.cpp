@@ -0,0 +1,234 @@
+#include "nla.hpp"
+
+#include <algorithm>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__)) && !defined(TESTLIB_GENERIC_KERNELS)
+#define LOCAL_KERNELS_X86
+#endif
+
+// Inlined into the wrappers of every instruction set, so that each gets its own vectorized copy
+#define KERNEL_INLINE inline __attribute__((always_inline))
+
+namespace alchemist {
+
+// Widest panel handled in one go
+static const int max_width = 8;
+
+// Rows of the distance accumulators, which stay in L1 for the widest panel
+static const El::Int distance_block = 64;
+
+// Calls kernel<w>(args...) for w = width, which is in [1, max_width]
+#define DISPATCH_WIDTH(kernel, width, ...) \
+	switch (width) { \
+	case 1: kernel<1>(__VA_ARGS__); break; \
+	case 2: kernel<2>(__VA_ARGS__); break; \
+	case 3: kernel<3>(__VA_ARGS__); break; \
+	case 4: kernel<4>(__VA_ARGS__); break; \
+	case 5: kernel<5>(__VA_ARGS__); break; \
+	case 6: kernel<6>(__VA_ARGS__); break; \
+	case 7: kernel<7>(__VA_ARGS__); break; \
+	default: kernel<8>(__VA_ARGS__); break; \
+	}
+
+template <int K>
+KERNEL_INLINE void scale_columns_fixed(double * u, El::Int rows, El::Int ldu, const double * d)
+{
+	for (int c = 0; c < K; c++) {
+		double * column = u + c * ldu;
+		const double scale = d[c];
+		#pragma omp simd
+		for (El::Int i = 0; i < rows; i++) column[i] *= scale;
+	}
+}
+
+template <int K>
+KERNEL_INLINE void scatter_rows_fixed(const double * full, El::Int ldf, El::Int first, El::Int stride, El::Int rows,
+		double * v, El::Int ldv)
+{
+	for (int c = 0; c < K; c++) {
+		const double * source = full + first + c * ldf;
+		double * column = v + c * ldv;
+		#pragma omp simd
+		for (El::Int i = 0; i < rows; i++) column[i] = source[i * stride];
+	}
+}
+
+// One block of at most distance_block rows against K centers, the K partial dot products of every
+// row kept in registers or L1 while the columns of x stream past
+template <int K>
+KERNEL_INLINE void squared_distances_fixed(const double * x, El::Int rows, El::Int ldx, El::Int d, const double * centers,
+		El::Int ldc, const double * center_norms, double * out, El::Int ldo)
+{
+	double dots[K][distance_block], norms[distance_block];
+
+	for (El::Int i0 = 0; i0 < rows; i0 += distance_block) {
+		El::Int block = std::min(distance_block, rows - i0);
+		std::fill(norms, norms + block, 0.0);
+		for (int c = 0; c < K; c++) std::fill(dots[c], dots[c] + block, 0.0);
+
+		for (El::Int j = 0; j < d; j++) {
+			const double * a = x + i0 + j * ldx;
+			#pragma omp simd
+			for (El::Int i = 0; i < block; i++) norms[i] += a[i] * a[i];
+			for (int c = 0; c < K; c++) {
+				const double w = centers[c + j * ldc];
+				double * dot = dots[c];
+				#pragma omp simd
+				for (El::Int i = 0; i < block; i++) dot[i] += a[i] * w;
+			}
+		}
+
+		for (int c = 0; c < K; c++) {
+			double * column = out + i0 + c * ldo;
+			const double * dot = dots[c];
+			const double norm = center_norms[c];
+			#pragma omp simd
+			for (El::Int i = 0; i < block; i++) column[i] = std::max(norms[i] + norm - 2.0 * dot[i], 0.0);
+		}
+	}
+}
+
+// Any k, as panels of max_width columns and a narrower last one
+
+KERNEL_INLINE void scale_columns_any(double * u, El::Int rows, El::Int ldu, El::Int k, const double * d)
+{
+	for (El::Int c0 = 0; c0 < k; c0 += max_width) {
+		int width = (int) std::min(El::Int(max_width), k - c0);
+		DISPATCH_WIDTH(scale_columns_fixed, width, u + c0 * ldu, rows, ldu, d + c0)
+	}
+}
+
+KERNEL_INLINE void scatter_rows_any(const double * full, El::Int ldf, El::Int first, El::Int stride, El::Int rows, El::Int k,
+		double * v, El::Int ldv)
+{
+	for (El::Int c0 = 0; c0 < k; c0 += max_width) {
+		int width = (int) std::min(El::Int(max_width), k - c0);
+		DISPATCH_WIDTH(scatter_rows_fixed, width, full + c0 * ldf, ldf, first, stride, rows, v + c0 * ldv, ldv)
+	}
+}
+
+KERNEL_INLINE void squared_distances_any(const double * x, El::Int rows, El::Int ldx, El::Int d, const double * centers,
+		El::Int ldc, const double * center_norms, El::Int k, double * out, El::Int ldo)
+{
+	for (El::Int c0 = 0; c0 < k; c0 += max_width) {
+		int width = (int) std::min(El::Int(max_width), k - c0);
+		DISPATCH_WIDTH(squared_distances_fixed, width, x, rows, ldx, d, centers + c0, ldc, center_norms + c0, out + c0 * ldo, ldo)
+	}
+}
+
+// Two passes, so that the deviations are taken from the mean of the values themselves
+KERNEL_INLINE void column_moments_any(const double * a, El::Int rows, double * moments)
+{
+	double sum = 0.0, lo = a[0], hi = a[0];
+	#pragma omp simd reduction(+:sum) reduction(min:lo) reduction(max:hi)
+	for (El::Int i = 0; i < rows; i++) {
+		sum += a[i];
+		lo = std::min(lo, a[i]);
+		hi = std::max(hi, a[i]);
+	}
+	double mean = sum / (double) rows, m2 = 0.0;
+	#pragma omp simd reduction(+:m2)
+	for (El::Int i = 0; i < rows; i++) m2 += (a[i] - mean) * (a[i] - mean);
+
+	moments[0] = (double) rows;
+	moments[1] = mean;
+	moments[2] = m2;
+	moments[3] = lo;
+	moments[4] = hi;
+}
+
+KERNEL_INLINE void fwht_any(double * x, El::Int length)
+{
+	for (El::Int h = 1; h < length; h <<= 1) {
+		for (El::Int i = 0; i < length; i += 2 * h) {
+			#pragma omp simd
+			for (El::Int k = i; k < i + h; k++) {
+				double a = x[k], b = x[k + h];
+				x[k] = a + b;
+				x[k + h] = a - b;
+			}
+		}
+	}
+}
+
+// The same kernels, compiled for one instruction set
+#define DEFINE_LOCAL_KERNELS(isa, target) \
+	target static void scale_columns_##isa(double * u, El::Int rows, El::Int ldu, El::Int k, const double * d) \
+	{ \
+		scale_columns_any(u, rows, ldu, k, d); \
+	} \
+	target static void scatter_rows_##isa(const double * full, El::Int ldf, El::Int first, El::Int stride, El::Int rows, \
+			El::Int k, double * v, El::Int ldv) \
+	{ \
+		scatter_rows_any(full, ldf, first, stride, rows, k, v, ldv); \
+	} \
+	target static void squared_distances_##isa(const double * x, El::Int rows, El::Int ldx, El::Int d, const double * centers, \
+			El::Int ldc, const double * center_norms, El::Int k, double * out, El::Int ldo) \
+	{ \
+		squared_distances_any(x, rows, ldx, d, centers, ldc, center_norms, k, out, ldo); \
+	} \
+	target static void column_moments_##isa(const double * a, El::Int rows, double * moments) \
+	{ \
+		column_moments_any(a, rows, moments); \
+	} \
+	target static void fwht_##isa(double * x, El::Int length) \
+	{ \
+		fwht_any(x, length); \
+	} \
+	static const LocalKernels isa##_kernels = {#isa, scale_columns_##isa, scatter_rows_##isa, squared_distances_##isa, \
+			column_moments_##isa, fwht_##isa};
+
+DEFINE_LOCAL_KERNELS(generic, )
+#ifdef LOCAL_KERNELS_X86
+DEFINE_LOCAL_KERNELS(avx2, __attribute__((target("avx2,fma"))))
+DEFINE_LOCAL_KERNELS(avx512, __attribute__((target("avx512f,avx512dq,avx2,fma"))))
+#endif
+
+// Widest first
+static std::vector<const LocalKernels *> supported_kernels()
+{
+	std::vector<const LocalKernels *> supported;
+#ifdef LOCAL_KERNELS_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq")) supported.push_back(&avx512_kernels);
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) supported.push_back(&avx2_kernels);
+#endif
+	supported.push_back(&generic_kernels);
+	return supported;
+}
+
+static const LocalKernels * selected_kernels = supported_kernels().front();
+
+const LocalKernels & local_kernels()
+{
+	return *selected_kernels;
+}
+
+bool select_local_kernels(const string & isa)
+{
+	std::vector<const LocalKernels *> supported = supported_kernels();
+	if (isa == "auto") {
+		selected_kernels = supported.front();
+		return true;
+	}
+	for (auto it = supported.begin(); it != supported.end(); it++) {
+		if (isa == (*it)->isa) {
+			selected_kernels = *it;
+			return true;
+		}
+	}
+	return false;
+}
+
+string supported_isas()
+{
+	std::vector<const LocalKernels *> supported = supported_kernels();
+	string list;
+	for (auto it = supported.begin(); it != supported.end(); it++) {
+		if (!list.empty()) list += ", ";
+		list += (*it)->isa;
+	}
+	return list;
+}
+
+}
@@ -0,0 +1,198 @@
+#include "nla.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace alchemist {
+
+// g = A'*t over the local rows, followed by |t|^2 over the local rows, summed over comm in one reduction
+static void reduce_transpose(const El::Matrix<double> & A, const El::Matrix<double> & t, El::Matrix<double> & packed, MPI_Comm comm)
+{
+	El::Int n = A.Width(), rows = t.Height();
+	El::Matrix<double> g;
+	El::View(g, packed, 0, 0, n, 1);
+
+	if (rows > 0) El::Gemv(El::TRANSPOSE, 1.0, A, t, 0.0, g);
+	else El::Zeros(g, n, 1);
+
+	const double * x = t.LockedBuffer();
+	double norm2 = 0.0;
+	#pragma omp simd reduction(+:norm2)
+	for (El::Int i = 0; i < rows; i++) norm2 += x[i] * x[i];
+	packed.Set(n, 0, norm2);
+
+	MPI_Allreduce(MPI_IN_PLACE, packed.Buffer(), (int) (n + 1), MPI_DOUBLE, MPI_SUM, comm);
+}
+
+// First n entries of x, copied into y
+static void head(const El::Matrix<double> & x, El::Int n, El::Matrix<double> & y)
+{
+	El::Zeros(y, n, 1);
+	std::copy(x.LockedBuffer(), x.LockedBuffer() + n, y.Buffer());
+}
+
+static double norm2(const El::Matrix<double> & x)
+{
+	const double * p = x.LockedBuffer();
+	double sum = 0.0;
+	for (El::Int i = 0; i < x.Height(); i++) sum += p[i] * p[i];
+	return std::sqrt(sum);
+}
+
+bool sketched_lstsq(const El::AbstractDistMatrix<double> & A, const El::AbstractDistMatrix<double> & B, uint8_t sketch,
+		El::Int s, uint64_t seed, El::Int max_iterations, double tol, El::Matrix<double> & X, LstsqInfo & info)
+{
+	El::Int n = A.Width(), k = B.Width();
+	MPI_Comm comm = A.Grid().VRComm().comm;
+	int rank;
+	MPI_Comm_rank(comm, &rank);
+
+	// [S*A, S*B] in one buffer, so that one reduction brings both to the first process
+	El::Matrix<double> SAB, SA, SB;
+	El::Zeros(SAB, s, n + k);
+	El::View(SA, SAB, 0, 0, s, n);
+	El::View(SB, SAB, 0, n, s, k);
+	sketch_local(A, sketch, s, seed, SA);
+	sketch_local(B, sketch, s, seed, SB);
+
+	MPI_Reduce((rank == 0) ? MPI_IN_PLACE : SAB.Buffer(), SAB.Buffer(), (int) (s * (n + k)), MPI_DOUBLE, MPI_SUM, 0, comm);
+
+	// R, then the solution of the sketched problem, its residual and whether R is singular
+	std::vector<double> solution((size_t) (n * n + n * k + 2), 0.0);
+	double * R_buffer = solution.data();
+	double * X_buffer = R_buffer + n * n;
+	if (rank == 0) {
+		El::Matrix<double> R, QtB;
+		El::qr::Explicit(SA, R);
+
+		double largest = 0.0;
+		for (El::Int j = 0; j < n; j++) largest = std::max(largest, std::abs(R.Get(j, j)));
+		bool deficient = (largest == 0.0);
+		for (El::Int j = 0; j < n; j++)
+			if (std::abs(R.Get(j, j)) <= (double) n * std::numeric_limits<double>::epsilon() * largest) deficient = true;
+
+		El::Zeros(QtB, n, k);
+		El::Gemm(El::TRANSPOSE, El::NORMAL, 1.0, SA, SB, 0.0, QtB);
+
+		// |S*B - S*A*X|^2 = |S*B|^2 - |Q'*S*B|^2 for every column
+		double residual = 0.0;
+		for (El::Int c = 0; c < k; c++) {
+			double all = 0.0, projected = 0.0;
+			for (El::Int i = 0; i < s; i++) all += SB.Get(i, c) * SB.Get(i, c);
+			for (El::Int j = 0; j < n; j++) projected += QtB.Get(j, c) * QtB.Get(j, c);
+			residual = std::max(residual, std::sqrt(std::max(all - projected, 0.0)));
+		}
+
+		if (!deficient) El::Trsm(El::LEFT, El::UPPER, El::NORMAL, El::NON_UNIT, 1.0, R, QtB);
+
+		for (El::Int j = 0; j < n; j++)
+			for (El::Int i = 0; i < n; i++) R_buffer[i + j * n] = R.Get(i, j);
+		for (El::Int c = 0; c < k; c++)
+			for (El::Int j = 0; j < n; j++) X_buffer[j + c * n] = QtB.Get(j, c);
+		solution[n * n + n * k] = residual;
+		solution[n * n + n * k + 1] = (deficient) ? 1.0 : 0.0;
+	}
+	MPI_Bcast(solution.data(), (int) solution.size(), MPI_DOUBLE, 0, comm);
+
+	info.iterations = 0;
+	info.residual = solution[n * n + n * k];
+	info.rank_deficient = solution[n * n + n * k + 1] != 0.0;
+	if (info.rank_deficient) return false;
+
+	El::Zeros(X, n, k);
+	for (El::Int c = 0; c < k; c++)
+		for (El::Int j = 0; j < n; j++) X.Set(j, c, X_buffer[j + c * n]);
+	if (max_iterations == 0) return true;
+
+	// LSQR on min |A*inv(R)*y - (b - A*x)|, one reduction of n+1 values per iteration
+	El::Matrix<double> R;
+	El::Zeros(R, n, n);
+	for (El::Int j = 0; j < n; j++)
+		for (El::Int i = 0; i <= j; i++) R.Set(i, j, R_buffer[i + j * n]);
+
+	const El::Matrix<double> & Al = A.LockedMatrix();
+	const El::Matrix<double> & Bl = B.LockedMatrix();
+	El::Int rows = Al.Height();
+
+	El::Matrix<double> x, u, t, v, w, y, z, packed;
+	El::Zeros(packed, n + 1, 1);
+	info.residual = 0.0;
+
+	for (El::Int c = 0; c < k; c++) {
+		El::View(x, X, 0, c, n, 1);
+
+		// t = b - A*x
+		El::Zeros(t, rows, 1);
+		for (El::Int i = 0; i < rows; i++) t.Set(i, 0, Bl.Get(i, c));
+		if (rows > 0) El::Gemv(El::NORMAL, -1.0, Al, x, 1.0, t);
+
+		reduce_transpose(Al, t, packed, comm);
+		double beta = std::sqrt(packed.Get(n, 0));
+		if (beta == 0.0) continue;
+
+		u = t;
+		El::Scale(1.0 / beta, u);
+		head(packed, n, v);
+		El::Trsv(El::UPPER, El::TRANSPOSE, El::NON_UNIT, R, v);
+		El::Scale(1.0 / beta, v);
+		double alpha = norm2(v);
+		if (alpha == 0.0) continue;
+		El::Scale(1.0 / alpha, v);
+
+		w = v;
+		El::Zeros(y, n, 1);
+		double phibar = beta, rhobar = alpha, anorm = 0.0;
+
+		El::Int iteration = 0;
+		while (iteration < max_iterations) {
+			iteration++;
+
+			// beta*u = A*inv(R)*v - alpha*u
+			z = v;
+			El::Trsv(El::UPPER, El::NORMAL, El::NON_UNIT, R, z);
+			t = u;
+			if (rows > 0) El::Gemv(El::NORMAL, 1.0, Al, z, -alpha, t);
+			reduce_transpose(Al, t, packed, comm);
+			beta = std::sqrt(packed.Get(n, 0));
+			anorm = std::sqrt(anorm * anorm + alpha * alpha + beta * beta);
+
+			// alpha*v = inv(R)'*A'*u - beta*v
+			if (beta > 0.0) {
+				u = t;
+				El::Scale(1.0 / beta, u);
+				head(packed, n, z);
+				El::Trsv(El::UPPER, El::TRANSPOSE, El::NON_UNIT, R, z);
+				El::Scale(1.0 / beta, z);
+				El::Axpy(-beta, v, z);
+				v = z;
+				alpha = norm2(v);
+				if (alpha > 0.0) El::Scale(1.0 / alpha, v);
+			}
+
+			double rho = std::sqrt(rhobar * rhobar + beta * beta);
+			double cs = rhobar / rho, sn = beta / rho;
+			double theta = sn * alpha;
+			double phi = cs * phibar;
+			rhobar = -cs * alpha;
+			phibar = sn * phibar;
+
+			El::Axpy(phi / rho, w, y);
+			El::Scale(-theta / rho, w);
+			El::Axpy(1.0, v, w);
+
+			// |(A*inv(R))'*r| = phibar*alpha*|cs|, relative to |A*inv(R)|*|r|
+			if (phibar == 0.0 || alpha * std::abs(cs) <= tol * anorm) break;
+		}
+
+		El::Trsv(El::UPPER, El::NORMAL, El::NON_UNIT, R, y);
+		El::Axpy(1.0, y, x);
+
+		info.iterations = std::max(info.iterations, iteration);
+		info.residual = std::max(info.residual, phibar);
+	}
+
+	return true;
+}
+
+}
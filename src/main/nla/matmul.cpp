@@ -0,0 +1,127 @@
+#include "nla.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace alchemist {
+
+El::GemmAlgorithm choose_gemm_algorithm(El::Int m, El::Int n, El::Int k)
+{
+	double a = (double) m * k, b = (double) k * n, c = (double) m * n;
+
+	if (4 * std::max(m, n) <= k) return El::GEMM_SUMMA_DOT;
+	if (c >= a && c >= b) return El::GEMM_SUMMA_C;
+	return (a >= b) ? El::GEMM_SUMMA_A : El::GEMM_SUMMA_B;
+}
+
+bool parse_gemm_algorithm(const string & name, El::Int m, El::Int n, El::Int k, El::GemmAlgorithm & alg)
+{
+	if (name == "auto") alg = choose_gemm_algorithm(m, n, k);
+	else if (name == "default") alg = El::GEMM_DEFAULT;
+	else if (name == "summa_a") alg = El::GEMM_SUMMA_A;
+	else if (name == "summa_b") alg = El::GEMM_SUMMA_B;
+	else if (name == "summa_c") alg = El::GEMM_SUMMA_C;
+	else if (name == "summa_dot") alg = El::GEMM_SUMMA_DOT;
+	else return false;
+	return true;
+}
+
+const char * gemm_algorithm_name(El::GemmAlgorithm alg)
+{
+	switch (alg) {
+	case El::GEMM_SUMMA_A: return "SUMMA with stationary A";
+	case El::GEMM_SUMMA_B: return "SUMMA with stationary B";
+	case El::GEMM_SUMMA_C: return "SUMMA with stationary C";
+	case El::GEMM_SUMMA_DOT: return "SUMMA dot-product";
+	default: return "Elemental's default";
+	}
+}
+
+std::shared_ptr<El::DistMatrix<double> > multiply(const BufferPool_ptr & pool, El::Orientation orientA, El::Orientation orientB,
+		const El::AbstractDistMatrix<double> & A, const El::AbstractDistMatrix<double> & B, El::GemmAlgorithm alg)
+{
+	El::Int m = (orientA == El::NORMAL) ? A.Height() : A.Width();
+	El::Int n = (orientB == El::NORMAL) ? B.Width() : B.Height();
+
+	auto C = make_pooled_distmatrix<El::MC, El::MR>(pool, m, n, A.Grid());
+	El::Gemm(orientA, orientB, 1.0, A, B, 0.0, *C, alg);
+
+	return C;
+}
+
+bool gram_is_local(const El::AbstractDistMatrix<double> & A)
+{
+	bool row_distributed = (A.ColDist() == El::VR || A.ColDist() == El::VC) && A.RowDist() == El::STAR;
+	return row_distributed && A.Width() * A.Grid().Size() <= A.Height();
+}
+
+void reduce_gram_columns(const BufferPool_ptr & pool, const El::Matrix<double> & local, El::Int first, El::Int stride,
+		El::Int count, int root, MPI_Comm comm, double * dest)
+{
+	const El::Int n = local.Width();
+	int rank;
+	MPI_Comm_rank(comm, &rank);
+
+	// Columns first + k*stride of local, k = c, ..., c+width-1, are one matrix with leading
+	// dimension stride*LDim. Panels stay below INT_MAX entries, the limit of an MPI count.
+	const El::Int max_width = std::max(El::Int(1), (El::Int) (std::numeric_limits<int>::max() / std::max(n, El::Int(1))));
+	const El::Int panel_width = std::max(El::Int(1), std::min(count, max_width));
+	El::Matrix<double> panel;
+	std::shared_ptr<double> panel_buffer = pool->acquire((size_t) (n * panel_width));
+
+	for (El::Int c = 0; c < count; c += panel_width) {
+		El::Int width = std::min(panel_width, count - c);
+		attach_pooled(panel, panel_buffer, n, width);
+		if (local.Height() > 0) {
+			El::Matrix<double> columns;
+			columns.LockedAttach(local.Height(), width, local.LockedBuffer(0, first + c * stride), stride * local.LDim());
+			El::Gemm(El::TRANSPOSE, El::NORMAL, 1.0, local, columns, 0.0, panel);
+		}
+		else El::Zeros(panel, n, width);
+
+		MPI_Reduce(panel.LockedBuffer(), (rank == root) ? dest + c * n : nullptr, (int) (n * width), MPI_DOUBLE, MPI_SUM,
+				root, comm);
+	}
+}
+
+void allreduce_sum(double * buffer, El::Int count, MPI_Comm comm)
+{
+	const El::Int piece = std::numeric_limits<int>::max();
+	for (El::Int offset = 0; offset < count; offset += piece)
+		MPI_Allreduce(MPI_IN_PLACE, buffer + offset, (int) std::min(piece, count - offset), MPI_DOUBLE, MPI_SUM, comm);
+}
+
+std::shared_ptr<El::AbstractDistMatrix<double> > gram(const BufferPool_ptr & pool, const El::AbstractDistMatrix<double> & A, bool local)
+{
+	const El::Grid & grid = A.Grid();
+	El::Int n = A.Width();
+
+	if (!local) {
+		auto C = make_pooled_distmatrix<El::MC, El::MR>(pool, n, n, grid);
+		El::Syrk(El::LOWER, El::TRANSPOSE, 1.0, A, 0.0, *C);
+		El::MakeSymmetric(El::LOWER, *C);
+		return C;
+	}
+
+	auto C = make_pooled_distmatrix<El::VR, El::STAR>(pool, n, n, grid);
+	int p = grid.Size();
+
+	// Row i of the result belongs to VR rank i % p. The Gramian is symmetric, so row i is also
+	// column i: each process sums the products of its rows with columns r, r+p, ... onto rank r,
+	// so no process ever holds more of A'*A than one owner's share.
+	El::Int local_rows = C->LocalHeight();
+	El::Matrix<double> rows;
+	std::shared_ptr<double> rows_buffer = pool->acquire((size_t) std::max(n * local_rows, El::Int(1)));
+	attach_pooled(rows, rows_buffer, n, local_rows);
+
+	for (int r = 0; r < p; r++)
+		reduce_gram_columns(pool, A.LockedMatrix(), r, p, El::Length(n, r, p), r, grid.VRComm().comm, rows.Buffer());
+
+	// Received as columns, stored as rows
+	El::Transpose(rows, C->Matrix());
+
+	return C;
+}
+
+}
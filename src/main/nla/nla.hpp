@@ -0,0 +1,388 @@
+#ifndef TESTLIB_NLA_HPP
+#define TESTLIB_NLA_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <El.hpp>
+#include "arena.hpp"
+
+namespace alchemist {
+
+using std::string;
+
+typedef std::shared_ptr<const El::AbstractDistMatrix<double> > DistMatrixConst_ptr;
+
+// =================================================================================================
+// ================================ Matrix products on resident data ===============================
+// =================================================================================================
+
+// SUMMA variant for C = op(A)*op(B), with C m x n and inner dimension k. Each variant keeps one
+// operand in place and moves the other two, so the largest of A (m x k), B (k x n) and C (m x n)
+// should stay put; when k dominates both m and n, the dot-product variant avoids moving the two
+// large operands altogether.
+El::GemmAlgorithm choose_gemm_algorithm(El::Int m, El::Int n, El::Int k);
+
+// "auto", "default", "summa_a", "summa_b", "summa_c" or "summa_dot"; returns false for anything else
+bool parse_gemm_algorithm(const string & name, El::Int m, El::Int n, El::Int k, El::GemmAlgorithm & alg);
+
+const char * gemm_algorithm_name(El::GemmAlgorithm alg);
+
+// C = op(A)*op(B) in a new [MC,MR] matrix on the grid of A, backed by the pool
+std::shared_ptr<El::DistMatrix<double> > multiply(const BufferPool_ptr & pool, El::Orientation orientA, El::Orientation orientB,
+		const El::AbstractDistMatrix<double> & A, const El::AbstractDistMatrix<double> & B, El::GemmAlgorithm alg);
+
+// Whether gram() will sum local Gramians rather than call El::Syrk: only for row-distributed A,
+// and only if A'*A is no larger than the local rows
+bool gram_is_local(const El::AbstractDistMatrix<double> & A);
+
+// A'*A with its lower triangle mirrored into the upper. If A is row-distributed, every process
+// multiplies its own rows by the columns each process owns and reductions sum them into a
+// [VR,STAR] result, so a process holds its n x n/p share and one panel of as much. Otherwise
+// El::Syrk computes the result in [MC,MR].
+std::shared_ptr<El::AbstractDistMatrix<double> > gram(const BufferPool_ptr & pool, const El::AbstractDistMatrix<double> & A, bool local);
+
+// Sums local'*local(:, first + k*stride), k < count, over comm into the n x count block at dest,
+// which is only written on root. Works panel by panel, so the full local Gramian never exists and
+// no MPI count overflows.
+void reduce_gram_columns(const BufferPool_ptr & pool, const El::Matrix<double> & local, El::Int first, El::Int stride,
+		El::Int count, int root, MPI_Comm comm, double * dest);
+
+// Sums count doubles over comm in place, in pieces below INT_MAX entries, the limit of an MPI count
+void allreduce_sum(double * buffer, El::Int count, MPI_Comm comm);
+
+// =================================================================================================
+// ===================================== Synthetic matrices ========================================
+// =================================================================================================
+
+// m x n matrix U*diag(s)*V' + E in [VR,STAR] on grid, with U m x rank and V n x rank of independent
+// N(0, 1/m) and N(0, 1/n) entries, so nearly orthonormal columns, s(q) = decay^q and E of N(0, noise^2/m)
+// entries. Every entry follows from the seed and its global indices, so every process generates its
+// own rows and the matrix does not depend on the number of processes.
+std::shared_ptr<El::DistMatrix<double, El::VR, El::STAR> > low_rank_plus_noise(const BufferPool_ptr & pool,
+		El::Int m, El::Int n, El::Int rank, double decay, double noise, uint64_t seed, const El::Grid & grid);
+
+// =================================================================================================
+// ===================================== Column statistics =========================================
+// =================================================================================================
+
+typedef enum _sketch_type : uint8_t {
+	SKETCH_NONE = 0,
+	SKETCH_COUNT,							// Row i is added to row h(i) of the sketch with sign s(i)
+	SKETCH_GAUSSIAN,						// Row i is added to every row of the sketch with N(0, 1/rows) weights
+	SKETCH_SRHT								// Chunks of rows are sign-flipped, Hadamard-transformed and sampled
+} sketch_type;
+
+// Statistics of every column, merged across processes with the pairwise update of Chan et al., which
+// stays accurate where sum and sum of squares would cancel
+struct ColumnStats {
+	uint64_t count;							// Rows
+	std::vector<double> mean, m2, min, max;	// m2: sum of squared deviations from the mean
+
+	// Optional sketch of the whole matrix, replicated on every process
+	uint8_t sketch;
+	El::Int sketch_rows;
+	uint64_t seed;
+	El::Matrix<double> sketch_matrix;
+
+	ColumnStats() : count(0), sketch(SKETCH_NONE), sketch_rows(0), seed(0) { }
+
+	double variance(El::Int j) const { return (count > 1) ? m2[j] / (double) (count - 1) : 0.0; }
+	double norm(El::Int j) const { return std::sqrt(m2[j] + (double) count * mean[j] * mean[j]); }
+};
+
+// Reproducible hash of a global row index, so sketches do not depend on how rows are distributed
+inline uint64_t hash_row(uint64_t seed, uint64_t row)
+{
+	uint64_t z = seed + 0x9e3779b97f4a7c15ull * (row + 1);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+	return z ^ (z >> 31);
+}
+
+// length normal variates with standard deviation scale, determined by seed and index alone
+void gaussian_vector(uint64_t seed, uint64_t index, El::Int length, double scale, double * g);
+
+// Collective over the grid of A, which may be distributed in any way that keeps one copy of every
+// entry ([MC,MR], [VR,STAR], ...). Reads the local entries once, in row blocks that stay in cache
+// while statistics and sketch are both updated, then merges the statistics with one reduction and
+// sums the sketch with another.
+void column_stats(const El::AbstractDistMatrix<double> & A, ColumnStats & stats, uint8_t sketch = SKETCH_NONE,
+		El::Int sketch_rows = 0, uint64_t seed = 0);
+
+// Moments of the local rows of n columns, kept as column_stats keeps them: empty, merged with those
+// of more rows, then merged over the processes of comm into stats (collective over comm)
+std::vector<double> empty_column_moments(El::Int n);
+void add_column_moments(const double * a, El::Int rows, El::Int ldim, El::Int n, std::vector<double> & fields);
+void reduce_column_moments(std::vector<double> & fields, El::Int n, MPI_Comm comm, ColumnStats & stats);
+
+// Adds this process's share of the s x n sketch of A, from its local entries, to S. The shares of all
+// processes of the grid sum to the sketch that column_stats computes with the same seed.
+void sketch_local(const El::AbstractDistMatrix<double> & A, uint8_t sketch, El::Int s, uint64_t seed, El::Matrix<double> & S);
+
+// Row-distributed copy of a matrix that every process holds in full, backed by the pool
+std::shared_ptr<El::DistMatrix<double, El::VR, El::STAR> > distribute_replicated(const BufferPool_ptr & pool,
+		const El::Matrix<double> & M, const El::Grid & grid);
+
+// The same in [VR,STAR], [VC,STAR], [MC,MR] or [STAR,STAR], named as "VR_STAR" and so on; nullptr
+// for any other layout
+std::shared_ptr<El::AbstractDistMatrix<double> > distribute_replicated(const BufferPool_ptr & pool,
+		const El::Matrix<double> & M, const El::Grid & grid, const std::string & layout);
+
+// A row-distributed matrix in one of the layouts above: rows itself for "VR_STAR", otherwise a copy
+std::shared_ptr<El::AbstractDistMatrix<double> > redistribute_rows(const BufferPool_ptr & pool,
+		const std::shared_ptr<El::DistMatrix<double, El::VR, El::STAR> > & rows, const std::string & layout);
+
+// Hands each process of a [VR,STAR] or [VC,STAR] matrix only its rows of an m x k column-major
+// block M held by rank 0 of comm, which is outside the grid: row i of M goes to the owner of global
+// row first + i. Rank 0 calls scatter_rows, every other process receive_rows, which writes into
+// the local rows of C. Collective over comm.
+void scatter_rows(MPI_Comm comm, const double * M, El::Int m, El::Int k, El::Int ldim, El::Int first);
+void receive_rows(MPI_Comm comm, El::AbstractDistMatrix<double> & C, El::Int first, El::Int m);
+
+// =================================================================================================
+// ================================= Sketched least squares ========================================
+// =================================================================================================
+
+struct LstsqInfo {
+	El::Int iterations;						// Of LSQR, the most taken by any right-hand side; 0 for a direct solve
+	double residual;						// Largest estimate of |A*x - b|, of the sketched problem for a direct solve
+	bool rank_deficient;					// The sketch of A had numerically dependent columns
+
+	LstsqInfo() : iterations(0), residual(0.0), rank_deficient(false) { }
+};
+
+// X = argmin |A*X - B| for tall A, replicated on every process. Both matrices are sketched in one
+// pass and the sketches are summed on the first process of the grid, which factors S*A = Q*R and
+// solves the sketched problem. Without max_iterations that solution is returned; otherwise it is
+// refined by LSQR on A*inv(R), whose condition number is close to 1, until the relative residual
+// of the normal equations falls below tol. A and B must be distributed alike, by rows, and aligned.
+bool sketched_lstsq(const El::AbstractDistMatrix<double> & A, const El::AbstractDistMatrix<double> & B, uint8_t sketch,
+		El::Int s, uint64_t seed, El::Int max_iterations, double tol, El::Matrix<double> & X, LstsqInfo & info);
+
+// =================================================================================================
+// ============================= Nonnegative matrix factorization ==================================
+// =================================================================================================
+
+// A ~ W*H for nonnegative m x n A and rank k, with W in [VR,STAR] like A and H replicated on every
+// process. Every iteration sums W'*A and W'*W over the grid in one reduction of k x (n+k) values,
+// updates H from them, then updates the local rows of W from A*H' and H*H' without communicating.
+class NMF {
+public:
+	// A must be in [VR,STAR] and outlive the factorization. W and H start uniformly random in
+	// [0, scale), from the seed and global indices only; norm2 is |A|_F^2.
+	NMF(const BufferPool_ptr & pool, const El::AbstractDistMatrix<double> & A, El::Int k, bool hals, uint64_t seed,
+			double scale, double norm2);
+
+	// One update of H and W, collective over the grid of A. Returns |A - W*H|_F / |A|_F for the new H
+	// and the W it was computed from.
+	double iterate();
+
+	std::shared_ptr<El::DistMatrix<double, El::VR, El::STAR> > W;
+	El::Matrix<double> H;
+
+private:
+	const El::AbstractDistMatrix<double> & A;
+	El::Int k;
+	bool hals;								// Hierarchical alternating least squares, or multiplicative updates
+	double norm2;
+	El::Matrix<double> reduced, WtA, WtW, AHt, HHt, scratch;
+
+	void update_H();
+	void update_W();
+};
+
+// =================================================================================================
+// ================================ CUR decomposition ==============================================
+// =================================================================================================
+
+// Pseudoinverse of a symmetric positive semidefinite matrix, dropping eigenvalues under 1e-12 of the
+// largest; returns the numerical rank
+El::Int psd_pinv(const El::Matrix<double> & G, El::Matrix<double> & P);
+
+// The given local rows of the row-distributed A, from every process, replicated on every process in
+// order of their global indices
+void gather_rows(const El::AbstractDistMatrix<double> & A, const std::vector<El::Int> & local_rows, std::vector<El::Int> & rows,
+		El::Matrix<double> & R);
+
+// Leverage scores |V(j,:)|^2 of the rows of V, replicated on every process; V may be distributed in
+// any way that keeps one copy of every entry
+std::vector<double> leverage_scores(const El::AbstractDistMatrix<double> & V);
+
+// Indices of c columns chosen by their leverage scores, the same on every process: the c largest,
+// or a weighted sample without replacement, drawn from the seed
+std::vector<El::Int> select_columns(const std::vector<double> & scores, El::Int c, bool random, uint64_t seed);
+
+struct CURFactors {
+	std::shared_ptr<El::DistMatrix<double, El::VR, El::STAR> > C;	// A(:, columns), m x c
+	El::Matrix<double> U;									// pinv(C)*A*pinv(R), c x r, replicated
+	El::Matrix<double> R;									// A(rows, :), r x n, replicated
+	std::vector<El::Int> columns, rows;
+};
+
+// A ~ C*U*R for A in [VR,STAR]. C*U*R is the best approximation with the chosen columns and rows.
+// Rows are sampled independently, each with probability proportional to its leverage score in the
+// column space of C (about r rows in expectation), so that no process needs the scores of another.
+// One pass over A forms C'*C and C'*A, which are summed in a single reduction, and one Allgatherv
+// collects R.
+void cur(const BufferPool_ptr & pool, const El::AbstractDistMatrix<double> & A, const std::vector<El::Int> & columns,
+		El::Int r, uint64_t seed, CURFactors & factors);
+
+// =================================================================================================
+// ===================================== Truncated SVD =============================================
+// =================================================================================================
+
+// U = A*V*inv(S) of a truncated SVD of A, applied on demand instead of stored. Products with U and
+// rows of U are formed from the local rows of A and the n x k matrix V*inv(S), which every process
+// holds in full, so a product costs one pass over A and no m x k storage.
+class LeftSingularVectors {
+public:
+	// A must be in [VR,STAR]; the operator shares ownership of it. V is n x k and replicated.
+	LeftSingularVectors(const DistMatrixConst_ptr & A, const El::Matrix<double> & V, const std::vector<double> & Sinv);
+
+	El::Int Height() const { return A->Height(); }
+	El::Int Width() const { return W.Width(); }
+
+	// U*X for k x c X, replicated on every process. The result is in [VR,STAR] with the rows of A,
+	// and every process forms its own rows without communicating.
+	std::shared_ptr<El::DistMatrix<double, El::VR, El::STAR> > apply(const BufferPool_ptr & pool, const El::Matrix<double> & X) const;
+
+	// Rows [first, first + count) of U, replicated on every process of the grid of A
+	void rows(El::Int first, El::Int count, El::Matrix<double> & R) const;
+
+private:
+	DistMatrixConst_ptr A;
+	El::Matrix<double> W;					// V*inv(S)
+};
+
+struct SVDUpdate {
+	std::shared_ptr<El::DistMatrix<double, El::VR, El::STAR> > U;	// (m + b) x k
+	std::vector<double> S;											// k, largest first
+	El::Matrix<double> V;											// n x k, replicated
+	El::Int residual_rank;											// Directions of B outside the span of V
+};
+
+// Brand's update of a rank-k SVD A ~ U*diag(S)*V' to one of [A; B], for b new rows B, from B and the
+// factors only, so that the cost grows with b and not with the rows of A. With B = B*V*V' + R, the
+// basis V is extended by an orthonormal basis Q of the rows of R, from a thin QR of the gathered R'
+// when b <= n and from R'*R otherwise, and the (k + r) x (k + r) problem in the basis [V, Q] is
+// solved on every process. U and B must be in [VR,STAR] on the same grid, in any alignment; S and V
+// are replicated and V has orthonormal columns.
+void append_rows(const BufferPool_ptr & pool, const El::AbstractDistMatrix<double> & U, const std::vector<double> & S,
+		const El::Matrix<double> & V, const El::AbstractDistMatrix<double> & B, SVDUpdate & update);
+
+// =================================================================================================
+// ======================================= Row streams =============================================
+// =================================================================================================
+
+// A matrix of n columns that grows by blocks of rows, in [VR,STAR] order: row i lives on process
+// i mod p of the grid, at local row i / p. The local rows share one pooled buffer whose capacity
+// doubles when it fills up. The column moments and, optionally, the Gramian of the local rows are
+// updated as every block arrives, so that only their reduction is left once the last block is in.
+class RowStream {
+public:
+	// expected_rows sizes the first buffer and may be 0
+	RowStream(const BufferPool_ptr & pool, const El::Grid & grid, El::Int n, El::Int expected_rows, bool keep_gram);
+
+	// Appends b rows that rank 0 of comm, outside the grid, sends with
+	// scatter_rows(comm, block, b, n, ldb, Height()); each process receives only the rows it keeps
+	void receive(MPI_Comm comm, El::Int b);
+
+	El::Int Height() const { return m; }
+	El::Int Width() const { return n; }
+
+	// The rows so far as a locked [VR,STAR] view of the stream's buffer, which later appends leave unchanged
+	std::shared_ptr<El::DistMatrix<double, El::VR, El::STAR> > matrix() const;
+
+	// Column statistics of the rows so far; collective over the grid
+	void stats(ColumnStats & stats) const;
+
+	// Copy of the Gramian of the local rows so far, nullptr unless kept; summed over the grid it is A'*A
+	std::shared_ptr<El::Matrix<double> > local_gram() const;
+
+private:
+	BufferPool_ptr pool;
+	const El::Grid & grid;
+	El::Int m, n;
+	El::Int local_rows, capacity;
+	std::shared_ptr<double> buffer;			// capacity x n, column-major
+	std::vector<double> moments;
+	bool keep_gram;
+	El::Matrix<double> gram;
+
+	void reserve(El::Int rows);
+};
+
+// =================================================================================================
+// ===================================== Kernel features ===========================================
+// =================================================================================================
+
+// Both map every row x of A to features z(x) with z(x)*z(y)' ~ exp(-gamma |x - y|^2), in a new
+// [VR,STAR] matrix with the rows of A. Every process expands its own rows, in blocks that stay in
+// cache between the product with A and the elementwise kernel function.
+
+// Random Fourier features sqrt(2/D) cos(W'*x + b), W ~ N(0, 2*gamma) and b ~ U(0, 2*pi). W and b are
+// drawn from the seed on every process, so nothing but the seed is communicated. A must be in
+// [VR,STAR].
+std::shared_ptr<El::DistMatrix<double, El::VR, El::STAR> > random_fourier_features(const BufferPool_ptr & pool,
+		const El::AbstractDistMatrix<double> & A, El::Int D, double gamma, uint64_t seed);
+
+// Nystrom features K(x, L)*U*inv(sqrt(S)) for landmarks L: num_landmarks rows of A chosen uniformly
+// from the seed, with K(L, L) = U*S*U'. Dependent landmarks are dropped, so there may be fewer
+// features than landmarks. A must be in [VR,STAR].
+std::shared_ptr<El::DistMatrix<double, El::VR, El::STAR> > nystrom_features(const BufferPool_ptr & pool,
+		const El::AbstractDistMatrix<double> & A, El::Int num_landmarks, double gamma, uint64_t seed);
+
+// =================================================================================================
+// ====================================== Local kernels ============================================
+// =================================================================================================
+
+// Widths up to this are worth the fixed-width kernels; wider distance computations go through Gemm
+const El::Int max_small_k = 32;
+
+// Hot loops on local data, compiled into the same shared object for AVX-512, AVX2 and the baseline.
+// Each instruction set gets its own copy through target attributes rather than per-file -march
+// flags, so no inline function from a shared header is ever compiled for an instruction set that
+// the processor running it may lack.
+struct LocalKernels {
+	const char * isa;
+
+	// The panel kernels work on column-major panels of k columns, unrolled over fixed widths of 1 to
+	// 8 columns; wider panels are taken 8 columns at a time
+
+	// u(:, c) *= d[c], for rows rows of k columns
+	void (*scale_columns)(double * u, El::Int rows, El::Int ldu, El::Int k, const double * d);
+
+	// v(i, c) = full(first + i*stride, c), for rows rows of k columns; the local rows of a
+	// [VR,STAR] matrix from a copy of the whole matrix
+	void (*scatter_rows)(const double * full, El::Int ldf, El::Int first, El::Int stride, El::Int rows, El::Int k,
+			double * v, El::Int ldv);
+
+	// out(i, c) = |x(i, :) - centers(c, :)|^2, for rows rows of x, d columns and k centers, given
+	// the squared norms of the centers
+	void (*squared_distances)(const double * x, El::Int rows, El::Int ldx, El::Int d, const double * centers, El::Int ldc,
+			const double * center_norms, El::Int k, double * out, El::Int ldo);
+
+	// Count, mean, sum of squared deviations from the mean, minimum and maximum of rows > 0 values
+	void (*column_moments)(const double * a, El::Int rows, double * moments);
+
+	// Unnormalized Walsh-Hadamard transform of a vector whose length is a power of two, in place
+	void (*fwht)(double * x, El::Int length);
+};
+
+// The kernels chosen by select_local_kernels, or for the widest instruction set the processor
+// supports if it was never called
+const LocalKernels & local_kernels();
+
+// Chooses the kernels for "avx512", "avx2" or "generic", or with "auto" for the widest instruction
+// set the processor supports. Returns false, leaving the choice as it was, for an instruction set
+// that was not compiled in or that the processor lacks.
+bool select_local_kernels(const string & isa);
+
+// Instruction sets with compiled kernels that the processor supports, widest first
+string supported_isas();
+}
+
+#endif // TESTLIB_NLA_HPP
@@ -0,0 +1,143 @@
+#include "nla.hpp"
+
+#include <algorithm>
+
+namespace alchemist {
+
+// Keeps entries off zero, where both update rules would leave them for good
+static const double floor_value = 1e-16;
+
+static inline double uniform(uint64_t h)
+{
+	return (double) (h >> 11) * (1.0 / 9007199254740992.0);
+}
+
+NMF::NMF(const BufferPool_ptr & pool, const El::AbstractDistMatrix<double> & _A, El::Int _k, bool _hals, uint64_t seed,
+		double scale, double _norm2) : A(_A), k(_k), hals(_hals), norm2(_norm2)
+{
+	El::Int n = A.Width();
+
+	W = make_pooled_distmatrix<El::VR, El::STAR>(pool, A.Height(), k, A.Grid());
+	El::Matrix<double> & Wl = W->Matrix();
+	for (El::Int il = 0; il < Wl.Height(); il++) {
+		uint64_t h = hash_row(seed, (uint64_t) W->GlobalRow(il));
+		for (El::Int c = 0; c < k; c++) Wl.Set(il, c, scale * uniform(hash_row(h, (uint64_t) c)));
+	}
+
+	El::Zeros(H, k, n);
+	for (El::Int j = 0; j < n; j++) {
+		uint64_t h = hash_row(~seed, (uint64_t) j);
+		for (El::Int c = 0; c < k; c++) H.Set(c, j, scale * uniform(hash_row(h, (uint64_t) c)));
+	}
+
+	// W'*A and W'*W side by side, for one reduction
+	El::Zeros(reduced, k, n + k);
+	El::View(WtA, reduced, 0, 0, k, n);
+	El::View(WtW, reduced, 0, n, k, k);
+}
+
+double NMF::iterate()
+{
+	El::Int n = A.Width();
+	const El::Matrix<double> & Al = A.LockedMatrix();
+	const El::Matrix<double> & Wl = W->LockedMatrix();
+
+	if (Al.Height() > 0) {
+		El::Gemm(El::TRANSPOSE, El::NORMAL, 1.0, Wl, Al, 0.0, WtA);
+		El::Gemm(El::TRANSPOSE, El::NORMAL, 1.0, Wl, Wl, 0.0, WtW);
+	}
+	else {
+		El::Zeros(WtA, k, n);
+		El::Zeros(WtW, k, k);
+	}
+	MPI_Allreduce(MPI_IN_PLACE, reduced.Buffer(), (int) (k * (n + k)), MPI_DOUBLE, MPI_SUM, A.Grid().VRComm().comm);
+
+	update_H();
+
+	El::Zeros(HHt, k, k);
+	El::Gemm(El::NORMAL, El::TRANSPOSE, 1.0, H, H, 0.0, HHt);
+
+	// |A - W*H|^2 = |A|^2 - 2 <W'*A, H> + <W'*W, H*H'>
+	double cross = 0.0, quadratic = 0.0;
+	for (El::Int j = 0; j < n; j++)
+		for (El::Int c = 0; c < k; c++) cross += WtA.Get(c, j) * H.Get(c, j);
+	for (El::Int j = 0; j < k; j++)
+		for (El::Int c = 0; c < k; c++) quadratic += WtW.Get(c, j) * HHt.Get(c, j);
+	double error2 = norm2 - 2.0 * cross + quadratic;
+
+	update_W();
+
+	return (norm2 > 0.0) ? std::sqrt(std::max(error2, 0.0) / norm2) : 0.0;
+}
+
+void NMF::update_H()
+{
+	El::Int n = A.Width();
+
+	if (!hals) {
+		El::Zeros(scratch, k, n);
+		El::Gemm(El::NORMAL, El::NORMAL, 1.0, WtW, H, 0.0, scratch);
+
+		#pragma omp parallel for schedule(static)
+		for (El::Int j = 0; j < n; j++) {
+			double * h = H.Buffer(0, j);
+			const double * numerator = WtA.LockedBuffer(0, j);
+			const double * denominator = scratch.LockedBuffer(0, j);
+			for (El::Int c = 0; c < k; c++) h[c] = std::max(floor_value, h[c] * numerator[c] / (denominator[c] + floor_value));
+		}
+		return;
+	}
+
+	// Rows of H one after another, each from the latest values of the others; the columns are independent
+	#pragma omp parallel for schedule(static)
+	for (El::Int j = 0; j < n; j++) {
+		double * h = H.Buffer(0, j);
+		for (El::Int c = 0; c < k; c++) {
+			double diagonal = WtW.Get(c, c);
+			if (diagonal <= 0.0) continue;
+			double gradient = WtA.Get(c, j);
+			for (El::Int l = 0; l < k; l++) gradient -= WtW.Get(c, l) * h[l];
+			h[c] = std::max(floor_value, h[c] + gradient / diagonal);
+		}
+	}
+}
+
+void NMF::update_W()
+{
+	const El::Matrix<double> & Al = A.LockedMatrix();
+	El::Matrix<double> & Wl = W->Matrix();
+	El::Int rows = Wl.Height();
+	if (rows == 0) return;
+
+	El::Zeros(AHt, rows, k);
+	El::Gemm(El::NORMAL, El::TRANSPOSE, 1.0, Al, H, 0.0, AHt);
+
+	if (!hals) {
+		El::Zeros(scratch, rows, k);
+		El::Gemm(El::NORMAL, El::NORMAL, 1.0, Wl, HHt, 0.0, scratch);
+
+		#pragma omp parallel for schedule(static)
+		for (El::Int c = 0; c < k; c++) {
+			double * w = Wl.Buffer(0, c);
+			const double * numerator = AHt.LockedBuffer(0, c);
+			const double * denominator = scratch.LockedBuffer(0, c);
+			#pragma omp simd
+			for (El::Int i = 0; i < rows; i++) w[i] = std::max(floor_value, w[i] * numerator[i] / (denominator[i] + floor_value));
+		}
+		return;
+	}
+
+	// Columns of W one after another, as for the rows of H; the rows are independent
+	#pragma omp parallel for schedule(static)
+	for (El::Int i = 0; i < rows; i++) {
+		for (El::Int c = 0; c < k; c++) {
+			double diagonal = HHt.Get(c, c);
+			if (diagonal <= 0.0) continue;
+			double gradient = AHt.Get(i, c);
+			for (El::Int l = 0; l < k; l++) gradient -= Wl.Get(i, l) * HHt.Get(l, c);
+			Wl.Set(i, c, std::max(floor_value, Wl.Get(i, c) + gradient / diagonal));
+		}
+	}
+}
+
+}
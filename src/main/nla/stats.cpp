@@ -0,0 +1,367 @@
+#include "nla.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace alchemist {
+
+// Per column: count, mean, m2, min, max
+static const int STATS_FIELDS = 5;
+
+// Merges the statistics b into a
+static inline void merge_stats(double * a, const double * b)
+{
+	double na = a[0], nb = b[0];
+	if (nb == 0.0) return;
+	if (na == 0.0) {
+		std::copy(b, b + STATS_FIELDS, a);
+		return;
+	}
+
+	double count = na + nb;
+	double delta = b[1] - a[1];
+	a[0] = count;
+	a[1] += delta * nb / count;
+	a[2] += b[2] + delta * delta * na * nb / count;
+	a[3] = std::min(a[3], b[3]);
+	a[4] = std::max(a[4], b[4]);
+}
+
+static void merge_stats_op(void * invec, void * inoutvec, int * len, MPI_Datatype * datatype)
+{
+	const double * in = reinterpret_cast<const double *>(invec);
+	double * inout = reinterpret_cast<double *>(inoutvec);
+	for (int j = 0; j < *len; j++) merge_stats(inout + j * STATS_FIELDS, in + j * STATS_FIELDS);
+}
+
+std::vector<double> empty_column_moments(El::Int n)
+{
+	std::vector<double> fields((size_t) n * STATS_FIELDS);
+	for (El::Int j = 0; j < n; j++) {
+		double * f = fields.data() + j * STATS_FIELDS;
+		f[0] = f[1] = f[2] = 0.0;
+		f[3] = std::numeric_limits<double>::infinity();
+		f[4] = -std::numeric_limits<double>::infinity();
+	}
+	return fields;
+}
+
+void add_column_moments(const double * a, El::Int rows, El::Int ldim, El::Int n, std::vector<double> & fields)
+{
+	if (rows == 0) return;
+	const LocalKernels & kernels = local_kernels();
+
+	#pragma omp parallel for schedule(static)
+	for (El::Int j = 0; j < n; j++) {
+		double b[STATS_FIELDS];
+		kernels.column_moments(a + j * ldim, rows, b);
+		merge_stats(fields.data() + j * STATS_FIELDS, b);
+	}
+}
+
+void reduce_column_moments(std::vector<double> & fields, El::Int n, MPI_Comm comm, ColumnStats & stats)
+{
+	MPI_Datatype column_type;
+	MPI_Type_contiguous(STATS_FIELDS, MPI_DOUBLE, &column_type);
+	MPI_Type_commit(&column_type);
+	MPI_Op merge;
+	MPI_Op_create(&merge_stats_op, 1, &merge);
+	MPI_Allreduce(MPI_IN_PLACE, fields.data(), (int) n, column_type, merge, comm);
+	MPI_Op_free(&merge);
+	MPI_Type_free(&column_type);
+
+	stats.count = (n > 0) ? (uint64_t) fields[0] : 0;
+	stats.mean.resize(n);
+	stats.m2.resize(n);
+	stats.min.resize(n);
+	stats.max.resize(n);
+	for (El::Int j = 0; j < n; j++) {
+		const double * f = fields.data() + j * STATS_FIELDS;
+		stats.mean[j] = f[1];
+		stats.m2[j] = f[2];
+		stats.min[j] = f[3];
+		stats.max[j] = f[4];
+	}
+}
+
+void gaussian_vector(uint64_t seed, uint64_t index, El::Int length, double scale, double * g)
+{
+	const double two_pi = 6.283185307179586;
+	uint64_t row_seed = hash_row(seed, index);
+
+	// Box-Muller on pairs of uniforms in (0, 1]
+	for (El::Int k = 0; k < length; k += 2) {
+		uint64_t h = hash_row(row_seed, (uint64_t) k);
+		double u1 = ((double) (h >> 11) + 1.0) * (1.0 / 9007199254740992.0);
+		double u2 = (double) (hash_row(h, 0) >> 11) * (1.0 / 9007199254740992.0);
+		double r = std::sqrt(-2.0 * std::log(u1)) * scale;
+		g[k] = r * std::cos(two_pi * u2);
+		if (k + 1 < length) g[k + 1] = r * std::sin(two_pi * u2);
+	}
+}
+
+// Scratch space of sketch_block, kept across the blocks of one pass
+struct SketchScratch {
+	std::vector<El::Int> bucket;
+	std::vector<double> sign;
+	El::Matrix<double> G, Ablock, Slocal;
+};
+
+// Adds the contribution of local rows [i0, i0 + rows) of A to the s x n sketch S
+static void sketch_block(const El::AbstractDistMatrix<double> & A, El::Int i0, El::Int rows, uint8_t sketch, El::Int s,
+		uint64_t seed, El::Matrix<double> & S, SketchScratch & scratch)
+{
+	El::Int local_width = A.LocalWidth();
+	const El::Matrix<double> & local = A.LockedMatrix();
+	const double * buffer = local.LockedBuffer();
+	El::Int ldim = local.LDim();
+
+	if (sketch == SKETCH_COUNT) {
+		scratch.bucket.resize(rows);
+		scratch.sign.resize(rows);
+		for (El::Int i = 0; i < rows; i++) {
+			uint64_t h = hash_row(seed, (uint64_t) A.GlobalRow(i0 + i));
+			scratch.bucket[i] = (El::Int) ((h >> 1) % (uint64_t) s);
+			scratch.sign[i] = (h & 1) ? -1.0 : 1.0;
+		}
+
+		const El::Int * bucket = scratch.bucket.data();
+		const double * sign = scratch.sign.data();
+		#pragma omp parallel for schedule(static)
+		for (El::Int jl = 0; jl < local_width; jl++) {
+			const double * a = buffer + i0 + jl * ldim;
+			double * t = S.Buffer(0, A.GlobalCol(jl));
+			for (El::Int i = 0; i < rows; i++) t[bucket[i]] += sign[i] * a[i];
+		}
+	}
+	else if (sketch == SKETCH_GAUSSIAN) {
+		scratch.G.Resize(s, rows);
+		for (El::Int i = 0; i < rows; i++)
+			gaussian_vector(seed, (uint64_t) A.GlobalRow(i0 + i), s, 1.0 / std::sqrt((double) s), scratch.G.Buffer(0, i));
+
+		El::LockedView(scratch.Ablock, local, i0, 0, rows, local_width);
+		El::Zeros(scratch.Slocal, s, local_width);
+		El::Gemm(El::NORMAL, El::NORMAL, 1.0, scratch.G, scratch.Ablock, 0.0, scratch.Slocal);
+		for (El::Int jl = 0; jl < local_width; jl++) {
+			const double * u = scratch.Slocal.LockedBuffer(0, jl);
+			double * t = S.Buffer(0, A.GlobalCol(jl));
+			for (El::Int k = 0; k < s; k++) t[k] += u[k];
+		}
+	}
+}
+
+// Subsampled randomized Hadamard transform of the local entries of A, in chunks of a power of two
+// rows: every chunk is multiplied by random signs, mixed by a Hadamard transform and sampled at s
+// rows. The signs of different chunks are independent, so the sum of the chunk sketches over all
+// processes is again an embedding of A.
+static void srht_local(const El::AbstractDistMatrix<double> & A, El::Int s, uint64_t seed, El::Matrix<double> & S)
+{
+	El::Int local_height = A.LocalHeight(), local_width = A.LocalWidth();
+	const El::Matrix<double> & local = A.LockedMatrix();
+	const double * buffer = local.LockedBuffer();
+	El::Int ldim = local.LDim();
+
+	El::Int chunk = 1;
+	while (chunk < std::max(2 * s, El::Int(16384))) chunk <<= 1;
+
+	// Same sampled rows in every chunk, scaled by sqrt(chunk / s) for the sampling and by
+	// 1 / sqrt(chunk) for the Hadamard transform
+	std::vector<El::Int> sample(s);
+	for (El::Int k = 0; k < s; k++) sample[k] = (El::Int) (hash_row(~seed, (uint64_t) k) % (uint64_t) chunk);
+	const double scale = 1.0 / std::sqrt((double) s);
+
+	std::vector<double> sign(std::min(chunk, std::max(local_height, El::Int(1))));
+	const LocalKernels & kernels = local_kernels();
+	for (El::Int i0 = 0; i0 < local_height; i0 += chunk) {
+		El::Int rows = std::min(chunk, local_height - i0);
+		for (El::Int i = 0; i < rows; i++)
+			sign[i] = (hash_row(seed, (uint64_t) A.GlobalRow(i0 + i)) & 1) ? -scale : scale;
+
+		#pragma omp parallel
+		{
+			std::vector<double> x(chunk);
+
+			#pragma omp for schedule(dynamic)
+			for (El::Int jl = 0; jl < local_width; jl++) {
+				const double * a = buffer + i0 + jl * ldim;
+				#pragma omp simd
+				for (El::Int i = 0; i < rows; i++) x[i] = sign[i] * a[i];
+				std::fill(x.begin() + rows, x.end(), 0.0);
+
+				kernels.fwht(x.data(), chunk);
+
+				double * t = S.Buffer(0, A.GlobalCol(jl));
+				for (El::Int k = 0; k < s; k++) t[k] += x[sample[k]];
+			}
+		}
+	}
+}
+
+void sketch_local(const El::AbstractDistMatrix<double> & A, uint8_t sketch, El::Int s, uint64_t seed, El::Matrix<double> & S)
+{
+	if (sketch == SKETCH_SRHT) {
+		srht_local(A, s, seed, S);
+		return;
+	}
+
+	SketchScratch scratch;
+	El::Int block = std::max(El::Int(16), El::Int(32768) / std::max(A.LocalWidth(), El::Int(1)));
+	for (El::Int i0 = 0; i0 < A.LocalHeight(); i0 += block)
+		sketch_block(A, i0, std::min(block, A.LocalHeight() - i0), sketch, s, seed, S, scratch);
+}
+
+void column_stats(const El::AbstractDistMatrix<double> & A, ColumnStats & stats, uint8_t sketch, El::Int sketch_rows, uint64_t seed)
+{
+	El::Int n = A.Width();
+	El::Int local_height = A.LocalHeight(), local_width = A.LocalWidth();
+	const El::Matrix<double> & local = A.LockedMatrix();
+	const double * buffer = local.LockedBuffer();
+	El::Int ldim = local.LDim();
+
+	if (sketch == SKETCH_NONE) sketch_rows = 0;
+
+	// Statistics of every column, those of columns owned elsewhere stay empty
+	std::vector<double> fields = empty_column_moments(n);
+
+	El::Matrix<double> S;
+	El::Zeros(S, sketch_rows, n);
+
+	// Blocks of about 32K entries, so that every block is still in cache when it is sketched
+	El::Int block = std::max(El::Int(16), El::Int(32768) / std::max(local_width, El::Int(1)));
+	SketchScratch scratch;
+	const LocalKernels & kernels = local_kernels();
+
+	for (El::Int i0 = 0; i0 < local_height; i0 += block) {
+		El::Int rows = std::min(block, local_height - i0);
+
+		#pragma omp parallel for schedule(static)
+		for (El::Int jl = 0; jl < local_width; jl++) {
+			double b[STATS_FIELDS];
+			kernels.column_moments(buffer + i0 + jl * ldim, rows, b);
+			merge_stats(fields.data() + A.GlobalCol(jl) * STATS_FIELDS, b);
+		}
+
+		if (sketch != SKETCH_SRHT)
+			sketch_block(A, i0, rows, sketch, sketch_rows, seed, S, scratch);
+	}
+
+	// The Hadamard transform mixes whole chunks of rows, which a second pass reads
+	if (sketch == SKETCH_SRHT) srht_local(A, sketch_rows, seed, S);
+
+	MPI_Comm comm = A.Grid().VRComm().comm;
+	reduce_column_moments(fields, n, comm, stats);
+
+	if (sketch_rows > 0)
+		allreduce_sum(S.Buffer(), sketch_rows * n, comm);
+
+	stats.sketch = sketch;
+	stats.sketch_rows = sketch_rows;
+	stats.seed = seed;
+	stats.sketch_matrix = S;
+}
+
+// Local entries of C from M, which every process holds in full
+static void fill_replicated(const El::Matrix<double> & M, El::AbstractDistMatrix<double> & C)
+{
+	El::Matrix<double> & local = C.Matrix();
+	const double * full = M.LockedBuffer();
+	El::Int ldim = M.LDim();
+	El::Int local_height = C.LocalHeight(), local_width = C.LocalWidth();
+	El::Int shift = C.ColShift(), stride = C.ColStride();
+
+	// With whole rows on every process, the local rows are every stride-th row of M
+	if (C.RowStride() == 1) {
+		local_kernels().scatter_rows(full, ldim, shift, stride, local_height, local_width, local.Buffer(), local.LDim());
+		return;
+	}
+
+	#pragma omp parallel for schedule(static)
+	for (El::Int jl = 0; jl < local_width; jl++) {
+		const double * column = full + C.GlobalCol(jl) * ldim;
+		double * c = local.Buffer(0, jl);
+		for (El::Int il = 0; il < local_height; il++) c[il] = column[shift + il * stride];
+	}
+}
+
+std::shared_ptr<El::DistMatrix<double, El::VR, El::STAR> > distribute_replicated(const BufferPool_ptr & pool,
+		const El::Matrix<double> & M, const El::Grid & grid)
+{
+	auto C = make_pooled_distmatrix<El::VR, El::STAR>(pool, M.Height(), M.Width(), grid);
+	fill_replicated(M, *C);
+	return C;
+}
+
+static std::shared_ptr<El::AbstractDistMatrix<double> > make_pooled_layout(const BufferPool_ptr & pool, El::Int m, El::Int n,
+		const El::Grid & grid, const std::string & layout)
+{
+	if (layout == "VR_STAR") return make_pooled_distmatrix<El::VR, El::STAR>(pool, m, n, grid);
+	if (layout == "VC_STAR") return make_pooled_distmatrix<El::VC, El::STAR>(pool, m, n, grid);
+	if (layout == "MC_MR") return make_pooled_distmatrix<El::MC, El::MR>(pool, m, n, grid);
+	if (layout == "STAR_STAR") return make_pooled_distmatrix<El::STAR, El::STAR>(pool, m, n, grid);
+	return nullptr;
+}
+
+std::shared_ptr<El::AbstractDistMatrix<double> > distribute_replicated(const BufferPool_ptr & pool,
+		const El::Matrix<double> & M, const El::Grid & grid, const std::string & layout)
+{
+	auto C = make_pooled_layout(pool, M.Height(), M.Width(), grid, layout);
+	if (C) fill_replicated(M, *C);
+	return C;
+}
+
+std::shared_ptr<El::AbstractDistMatrix<double> > redistribute_rows(const BufferPool_ptr & pool,
+		const std::shared_ptr<El::DistMatrix<double, El::VR, El::STAR> > & rows, const std::string & layout)
+{
+	if (layout == "VR_STAR") return rows;
+
+	auto C = make_pooled_layout(pool, rows->Height(), rows->Width(), rows->Grid(), layout);
+	if (C) El::Copy(*rows, *C);
+	return C;
+}
+
+void scatter_rows(MPI_Comm comm, const double * M, El::Int m, El::Int k, El::Int ldim, El::Int first)
+{
+	int size;
+	MPI_Comm_size(comm, &size);
+	std::vector<int> shifts(size);
+	int none = -1;
+	MPI_Gather(&none, 1, MPI_INT, shifts.data(), 1, MPI_INT, 0, comm);
+	int p = (int) std::count_if(shifts.begin(), shifts.end(), [](int r) { return r >= 0; });
+
+	// Rows first + i with (first + i) % p == shift, for each process, one block after the other
+	std::vector<int> counts(size, 0), displs(size, 0);
+	std::vector<double> packed((size_t) std::max(m * k, El::Int(1)));
+	El::Int offset = 0;
+	for (int q = 0; q < size; q++) {
+		displs[q] = (int) offset;
+		if (shifts[q] < 0) continue;
+		El::Int skip = (shifts[q] - first % p + p) % p;
+		El::Int rows = El::Length(m, skip, p);
+		for (El::Int j = 0; j < k; j++)
+			for (El::Int il = 0; il < rows; il++)
+				packed[offset + il + j * rows] = M[skip + il * p + j * ldim];
+		counts[q] = (int) (rows * k);
+		offset += rows * k;
+	}
+
+	MPI_Scatterv(packed.data(), counts.data(), displs.data(), MPI_DOUBLE, nullptr, 0, MPI_DOUBLE, 0, comm);
+}
+
+void receive_rows(MPI_Comm comm, El::AbstractDistMatrix<double> & C, El::Int first, El::Int m)
+{
+	// With no alignment, the shift is the rank of the process among the owners of rows
+	int shift = C.ColShift();
+	El::Int stride = C.ColStride();
+	MPI_Gather(&shift, 1, MPI_INT, nullptr, 1, MPI_INT, 0, comm);
+
+	// Local rows of C among global rows [first, first + m), received straight into place
+	El::Int begin = El::Length(first, shift, stride);
+	El::Int count = El::Length(first + m, shift, stride) - begin;
+	MPI_Datatype rows;
+	MPI_Type_vector((int) C.Width(), (int) count, (int) C.LDim(), MPI_DOUBLE, &rows);
+	MPI_Type_commit(&rows);
+	MPI_Scatterv(nullptr, nullptr, nullptr, MPI_DOUBLE, C.Buffer() + begin, (count > 0) ? 1 : 0, rows, 0, comm);
+	MPI_Type_free(&rows);
+}
+
+}
@@ -0,0 +1,74 @@
+#include "nla.hpp"
+
+#include <algorithm>
+
+namespace alchemist {
+
+RowStream::RowStream(const BufferPool_ptr & _pool, const El::Grid & _grid, El::Int _n, El::Int expected_rows, bool _keep_gram)
+	: pool(_pool), grid(_grid), m(0), n(_n), local_rows(0), capacity(0), keep_gram(_keep_gram)
+{
+	moments = empty_column_moments(n);
+	if (keep_gram) El::Zeros(gram, n, n);
+	reserve(std::max(El::Length(expected_rows, grid.VRRank(), grid.Size()), El::Int(1)));
+}
+
+void RowStream::reserve(El::Int rows)
+{
+	if (rows <= capacity) return;
+
+	// The old buffer stays with any matrix handed out on it
+	El::Int grown = std::max(rows, 2 * capacity);
+	std::shared_ptr<double> larger = pool->acquire((size_t) (grown * std::max(n, El::Int(1))));
+	for (El::Int j = 0; j < n; j++)
+		std::copy(buffer.get() + j * capacity, buffer.get() + j * capacity + local_rows, larger.get() + j * grown);
+	buffer = larger;
+	capacity = grown;
+}
+
+void RowStream::receive(MPI_Comm comm, El::Int b)
+{
+	El::Int first = local_rows;
+	El::Int rows = El::Length(m + b, grid.VRRank(), grid.Size()) - first;
+	reserve(first + rows);
+
+	// The new rows land straight in the buffer, through a view of the stream that includes them
+	El::DistMatrix<double, El::VR, El::STAR> grown(grid);
+	grown.Attach(m + b, n, grid, 0, 0, buffer.get(), capacity);
+	receive_rows(comm, grown, m, b);
+
+	double * local = buffer.get();
+	add_column_moments(local + first, rows, capacity, n, moments);
+	if (keep_gram && rows > 0) {
+		El::Matrix<double> added;
+		added.LockedAttach(rows, n, local + first, capacity);
+		El::Gemm(El::TRANSPOSE, El::NORMAL, 1.0, added, added, 1.0, gram);
+	}
+
+	m += b;
+	local_rows += rows;
+}
+
+std::shared_ptr<El::DistMatrix<double, El::VR, El::STAR> > RowStream::matrix() const
+{
+	typedef El::DistMatrix<double, El::VR, El::STAR> Matrix;
+
+	std::unique_ptr<Matrix> M{new Matrix(grid)};
+	M->LockedAttach(m, n, grid, 0, 0, buffer.get(), capacity);
+
+	std::shared_ptr<double> shared = buffer;
+	return std::shared_ptr<Matrix>(M.release(), [shared](Matrix * p) mutable { delete p; shared.reset(); });
+}
+
+void RowStream::stats(ColumnStats & stats) const
+{
+	std::vector<double> fields = moments;
+	reduce_column_moments(fields, n, grid.VRComm().comm, stats);
+}
+
+std::shared_ptr<El::Matrix<double> > RowStream::local_gram() const
+{
+	if (!keep_gram) return nullptr;
+	return std::make_shared<El::Matrix<double> >(gram);
+}
+
+}
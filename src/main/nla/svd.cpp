@@ -0,0 +1,232 @@
+#include "nla.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+namespace alchemist {
+
+LeftSingularVectors::LeftSingularVectors(const DistMatrixConst_ptr & _A, const El::Matrix<double> & V, const std::vector<double> & Sinv)
+	: A(_A), W(V)
+{
+	local_kernels().scale_columns(W.Buffer(), W.Height(), W.LDim(), W.Width(), Sinv.data());
+}
+
+std::shared_ptr<El::DistMatrix<double, El::VR, El::STAR> > LeftSingularVectors::apply(const BufferPool_ptr & pool,
+		const El::Matrix<double> & X) const
+{
+	El::Int n = A->Width(), c = X.Width();
+	const El::Matrix<double> & Al = A->LockedMatrix();
+
+	auto Y = make_pooled_distmatrix<El::VR, El::STAR>(pool, A->Height(), c, A->Grid());
+	if (Al.Height() == 0 || c == 0) return Y;
+
+	// (A*W)*X as A*(W*X), which is n x c instead of m x k
+	El::Matrix<double> WX;
+	El::Zeros(WX, n, c);
+	El::Gemm(El::NORMAL, El::NORMAL, 1.0, W, X, 0.0, WX);
+	El::Gemm(El::NORMAL, El::NORMAL, 1.0, Al, WX, 0.0, Y->Matrix());
+
+	return Y;
+}
+
+void LeftSingularVectors::rows(El::Int first, El::Int count, El::Matrix<double> & R) const
+{
+	El::Int n = A->Width(), k = W.Width();
+	El::Int shift = A->ColShift(), stride = A->ColStride();
+
+	// Local rows begin to end are those of A with global indices in [first, first + count)
+	El::Int begin = El::Length(first, shift, stride);
+	El::Int end = El::Length(first + count, shift, stride);
+
+	El::Zeros(R, count, k);
+	if (end > begin && k > 0) {
+		El::Matrix<double> Ablock, block;
+		El::LockedView(Ablock, A->LockedMatrix(), begin, 0, end - begin, n);
+		El::Zeros(block, end - begin, k);
+		El::Gemm(El::NORMAL, El::NORMAL, 1.0, Ablock, W, 0.0, block);
+		El::Int offset = shift + begin * stride - first;
+		for (El::Int c = 0; c < k; c++) {
+			const double * b = block.LockedBuffer(0, c);
+			double * r = R.Buffer(0, c);
+			for (El::Int q = 0; q < end - begin; q++) r[offset + q * stride] = b[q];
+		}
+	}
+
+	allreduce_sum(R.Buffer(), count * k, A->Grid().VRComm().comm);
+}
+
+// Eigenvalues of R'*R below this fraction of the largest squared singular value are directions of B
+// that rounding has left outside the span of V, not new ones
+static const double residual_cutoff = 1e-12;
+
+// Scales column c of M by d[c], or zeroes it if d[c] is zero
+static void scale_or_zero(El::Matrix<double> & M, const std::vector<double> & d)
+{
+	for (El::Int c = 0; c < M.Width(); c++) {
+		double * column = M.Buffer(0, c);
+		double factor = (d[c] > 0.0) ? 1.0 / d[c] : 0.0;
+		for (El::Int i = 0; i < M.Height(); i++) column[i] *= factor;
+	}
+}
+
+// Orthonormal basis of the span of the columns of basis*Z for the eigenvectors Z of G whose
+// eigenvalues are above the cutoff, relative to largest
+static void kept_directions(El::Matrix<double> & G, const El::Matrix<double> * basis, double largest, El::Matrix<double> & Q)
+{
+	El::Matrix<double> w, Z;
+	El::HermitianEig(El::LOWER, G, w, Z);
+	for (El::Int q = 0; q < w.Height(); q++) largest = std::max(largest, w.Get(q, 0));
+
+	std::vector<El::Int> kept;
+	for (El::Int q = 0; q < w.Height(); q++)
+		if (w.Get(q, 0) > residual_cutoff * largest) kept.push_back(q);
+
+	El::Matrix<double> Zk;
+	El::Zeros(Zk, Z.Height(), (El::Int) kept.size());
+	for (size_t c = 0; c < kept.size(); c++)
+		std::copy(Z.LockedBuffer(0, kept[c]), Z.LockedBuffer(0, kept[c]) + Z.Height(), Zk.Buffer(0, (El::Int) c));
+
+	if (basis == nullptr) {
+		Q = Zk;
+		return;
+	}
+	El::Zeros(Q, basis->Height(), Zk.Width());
+	if (Zk.Width() > 0) El::Gemm(El::NORMAL, El::NORMAL, 1.0, *basis, Zk, 0.0, Q);
+}
+
+void append_rows(const BufferPool_ptr & pool, const El::AbstractDistMatrix<double> & U, const std::vector<double> & S,
+		const El::Matrix<double> & V, const El::AbstractDistMatrix<double> & B, SVDUpdate & update)
+{
+	El::Int m = U.Height(), k = U.Width(), b = B.Height(), n = B.Width();
+	MPI_Comm comm = B.Grid().VRComm().comm;
+	int p = B.Grid().Size();
+
+	// The local rows of U become the leading local rows of the new U, which starts on process 0
+	std::unique_ptr<El::DistMatrix<double, El::VR, El::STAR> > Ualigned;
+	const El::AbstractDistMatrix<double> * Up = &U;
+	if (U.ColAlign() != 0) {
+		Ualigned.reset(new El::DistMatrix<double, El::VR, El::STAR>(U.Grid()));
+		Ualigned->AlignCols(0);
+		El::Copy(U, *Ualigned);
+		Up = Ualigned.get();
+	}
+	const El::Matrix<double> & Ul = Up->LockedMatrix();
+
+	// Row i of B becomes row m + i of U. Aligning B to start on the owner of row m puts every row of
+	// B on the process that holds the matching row of the result.
+	std::unique_ptr<El::DistMatrix<double, El::VR, El::STAR> > aligned;
+	const El::AbstractDistMatrix<double> * Bp = &B;
+	if (B.ColAlign() != (int) (m % p)) {
+		aligned.reset(new El::DistMatrix<double, El::VR, El::STAR>(B.Grid()));
+		aligned->AlignCols((int) (m % p));
+		El::Copy(B, *aligned);
+		Bp = aligned.get();
+	}
+	const El::Matrix<double> & Bl = Bp->LockedMatrix();
+	El::Int local_b = Bl.Height();
+
+	// R = B - (B*V)*V' on the local rows
+	El::Matrix<double> P, R;
+	El::Zeros(P, local_b, k);
+	El::Zeros(R, local_b, n);
+	if (local_b > 0) {
+		for (El::Int j = 0; j < n; j++) std::copy(Bl.LockedBuffer(0, j), Bl.LockedBuffer(0, j) + local_b, R.Buffer(0, j));
+		if (k > 0) {
+			El::Gemm(El::NORMAL, El::NORMAL, 1.0, Bl, V, 0.0, P);
+			El::Gemm(El::NORMAL, El::TRANSPOSE, -1.0, P, V, 1.0, R);
+		}
+	}
+
+	// Basis Q of the rows of R, of rank at most min(b, n). With fewer new rows than columns, the
+	// rows of R are gathered as the columns of R' on every process, and a thin QR R' = Q0*T leaves a
+	// b x b problem: the leading eigenvectors of T*T' give Q within Q0. Otherwise, or if R' has too
+	// many entries for the int displacements of one gather, the n x n R'*R is summed over the grid.
+	double largest = (k > 0) ? S[0] * S[0] : 0.0;
+	El::Matrix<double> Q;
+	if (b <= n && b * n <= (El::Int) std::numeric_limits<int>::max()) {
+		std::vector<int> counts(p), displs(p);
+		int count = (int) (local_b * n);
+		MPI_Allgather(&count, 1, MPI_INT, counts.data(), 1, MPI_INT, comm);
+		for (int q = 0, offset = 0; q < p; offset += counts[q], q++) displs[q] = offset;
+
+		El::Matrix<double> Rt, Rt_local, T, G;
+		El::Zeros(Rt_local, n, local_b);
+		if (local_b > 0) El::Transpose(R, Rt_local);
+		El::Zeros(Rt, n, b);
+		MPI_Allgatherv(Rt_local.LockedBuffer(), count, MPI_DOUBLE, Rt.Buffer(), counts.data(), displs.data(), MPI_DOUBLE, comm);
+
+		El::qr::Explicit(Rt, T);
+		El::Zeros(G, b, b);
+		El::Gemm(El::NORMAL, El::TRANSPOSE, 1.0, T, T, 0.0, G);
+		kept_directions(G, &Rt, largest, Q);
+	}
+	else {
+		El::Matrix<double> G;
+		El::Zeros(G, n, n);
+		if (local_b > 0) El::Gemm(El::TRANSPOSE, El::NORMAL, 1.0, R, R, 0.0, G);
+		allreduce_sum(G.Buffer(), n * n, comm);
+		kept_directions(G, nullptr, largest, Q);
+	}
+	El::Int r = Q.Width();
+	update.residual_rank = r;
+
+	// W = [V, Q], and the problem in that basis: diag(S)*V'*W stacked on B*W
+	El::Matrix<double> W, SC, BW, M, sigma2, Y;
+	El::Zeros(W, n, k + r);
+	for (El::Int c = 0; c < k; c++) std::copy(V.LockedBuffer(0, c), V.LockedBuffer(0, c) + n, W.Buffer(0, c));
+	for (El::Int q = 0; q < r; q++) std::copy(Q.LockedBuffer(0, q), Q.LockedBuffer(0, q) + n, W.Buffer(0, k + q));
+
+	El::Zeros(SC, k, k + r);
+	if (k > 0) El::Gemm(El::TRANSPOSE, El::NORMAL, 1.0, V, W, 0.0, SC);
+	for (El::Int j = 0; j < k + r; j++)
+		for (El::Int i = 0; i < k; i++) SC.Set(i, j, S[i] * SC.Get(i, j));
+
+	El::Zeros(BW, local_b, k + r);
+	El::Zeros(M, k + r, k + r);
+	if (local_b > 0) {
+		El::Gemm(El::NORMAL, El::NORMAL, 1.0, Bl, W, 0.0, BW);
+		El::Gemm(El::TRANSPOSE, El::NORMAL, 1.0, BW, BW, 0.0, M);
+	}
+	allreduce_sum(M.Buffer(), (k + r) * (k + r), comm);
+	if (k > 0) El::Gemm(El::TRANSPOSE, El::NORMAL, 1.0, SC, SC, 1.0, M);
+	El::HermitianEig(El::LOWER, M, sigma2, Y);
+
+	// The k largest, in descending order
+	std::vector<El::Int> order(k + r);
+	std::iota(order.begin(), order.end(), El::Int(0));
+	std::sort(order.begin(), order.end(), [&sigma2](El::Int a, El::Int b) { return sigma2.Get(a, 0) > sigma2.Get(b, 0); });
+	El::Matrix<double> Yk;
+	El::Zeros(Yk, k + r, k);
+	update.S.resize(k);
+	for (El::Int c = 0; c < k; c++) {
+		El::Int q = order[c];
+		update.S[c] = std::sqrt(std::max(sigma2.Get(q, 0), 0.0));
+		std::copy(Y.LockedBuffer(0, q), Y.LockedBuffer(0, q) + k + r, Yk.Buffer(0, c));
+	}
+
+	El::Zeros(update.V, n, k);
+	if (k > 0) El::Gemm(El::NORMAL, El::NORMAL, 1.0, W, Yk, 0.0, update.V);
+
+	// Rows of A: U*(diag(S)*V'*W*Yk*inv(S')); rows of B: B*W*Yk*inv(S')
+	El::Matrix<double> Uk, Unew;
+	El::Zeros(Uk, k, k);
+	if (k > 0) El::Gemm(El::NORMAL, El::NORMAL, 1.0, SC, Yk, 0.0, Uk);
+	scale_or_zero(Uk, update.S);
+	El::Zeros(Unew, local_b, k);
+	if (local_b > 0 && k > 0) El::Gemm(El::NORMAL, El::NORMAL, 1.0, BW, Yk, 0.0, Unew);
+	scale_or_zero(Unew, update.S);
+
+	update.U = make_pooled_distmatrix<El::VR, El::STAR>(pool, m + b, k, U.Grid());
+	El::Matrix<double> & Ul_new = update.U->Matrix();
+	El::Int shift = update.U->ColShift(), stride = update.U->ColStride();
+	El::Int old_rows = El::Length(m, shift, stride);
+	El::Matrix<double> top;
+	El::View(top, Ul_new, 0, 0, old_rows, k);
+	if (old_rows > 0 && k > 0) El::Gemm(El::NORMAL, El::NORMAL, 1.0, Ul, Uk, 0.0, top);
+
+	// With B aligned, the local rows of B are the remaining local rows of the result
+	for (El::Int c = 0; c < k; c++) std::copy(Unew.LockedBuffer(0, c), Unew.LockedBuffer(0, c) + local_b, Ul_new.Buffer(old_rows, c));
+}
+
+}
@@ -0,0 +1,183 @@
+#include "arena.hpp"
+
+#include <cstdlib>
+
+namespace alchemist {
+
+// =================================================================================================
+// ======================================== Task arena =============================================
+// =================================================================================================
+
+TaskArena::~TaskArena()
+{
+	reset();
+	for (auto it = blocks.begin(); it != blocks.end(); it++) std::free(it->data);
+}
+
+void * TaskArena::allocate(size_t bytes, size_t alignment)
+{
+	if (bytes == 0) bytes = 1;
+
+	for (auto it = blocks.begin(); it != blocks.end(); it++) {
+		uintptr_t base = reinterpret_cast<uintptr_t>(it->data);
+		uintptr_t start = (base + it->used + alignment - 1) & ~(uintptr_t) (alignment - 1);
+		if (start + bytes <= base + it->size) {
+			it->used = start + bytes - base;
+			return reinterpret_cast<void *>(start);
+		}
+	}
+
+	Block block;
+	block.size = std::max(block_size, bytes + alignment);
+	block.used = 0;
+	block.data = reinterpret_cast<char *>(std::malloc(block.size));
+	if (block.data == nullptr) throw std::bad_alloc();
+	blocks.push_back(block);
+
+	return allocate(bytes, alignment);
+}
+
+void TaskArena::reset()
+{
+	for (auto it = destructors.rbegin(); it != destructors.rend(); it++) (it->first)(it->second);
+	destructors.clear();
+
+	high_water = std::max(high_water, bytes_used());
+
+	// Replace a fragmented arena with a single block sized for the largest task seen so far
+	if (blocks.size() > 1) {
+		for (auto it = blocks.begin(); it != blocks.end(); it++) std::free(it->data);
+		blocks.clear();
+		block_size = std::max(block_size, high_water + 64 * 64);
+	}
+
+	for (auto it = blocks.begin(); it != blocks.end(); it++) it->used = 0;
+}
+
+size_t TaskArena::bytes_used() const
+{
+	size_t used = 0;
+	for (auto it = blocks.begin(); it != blocks.end(); it++) used += it->used;
+	return used;
+}
+
+size_t TaskArena::capacity() const
+{
+	size_t size = 0;
+	for (auto it = blocks.begin(); it != blocks.end(); it++) size += it->size;
+	return size;
+}
+
+std::shared_ptr<TaskArena> ArenaPool::acquire()
+{
+	TaskArena * arena = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!free_list.empty()) {
+			arena = free_list.back().release();
+			free_list.pop_back();
+		}
+	}
+	if (arena == nullptr) arena = new TaskArena();
+
+	std::weak_ptr<ArenaPool> owner = shared_from_this();
+	return std::shared_ptr<TaskArena>(arena, [owner](TaskArena * a) {
+		auto pool = owner.lock();
+		if (pool) pool->release(a);
+		else delete a;
+	});
+}
+
+void ArenaPool::release(TaskArena * arena)
+{
+	arena->reset();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if (free_list.size() < max_cached) free_list.emplace_back(arena);
+	else delete arena;
+}
+
+size_t ArenaPool::cached() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return free_list.size();
+}
+
+// =================================================================================================
+// ======================================== Buffer pool ============================================
+// =================================================================================================
+
+size_t BufferPool::class_size(size_t length)
+{
+	const size_t largest_power = (size_t(1) << 20) / sizeof(double);
+
+	size_t size = 4096 / sizeof(double);
+	while (size < length && size < largest_power) size <<= 1;
+	if (size >= length) return size;
+
+	// Steps of an eighth of the largest power of two not above length
+	size_t power = largest_power;
+	while (power <= length / 2) power <<= 1;
+	size_t step = power / 8;
+	return (length + step - 1) / step * step;
+}
+
+std::shared_ptr<double> BufferPool::acquire(size_t length)
+{
+	size_t size = class_size(length);
+	double * buffer = nullptr;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto & free_list = free_lists[size];
+		if (!free_list.empty()) {
+			buffer = free_list.back();
+			free_list.pop_back();
+			cached_bytes -= size * sizeof(double);
+		}
+	}
+
+	if (buffer == nullptr) {
+		void * p = nullptr;
+		if (posix_memalign(&p, 64, size * sizeof(double)) != 0) throw std::bad_alloc();
+		buffer = reinterpret_cast<double *>(p);
+	}
+
+	std::weak_ptr<BufferPool> owner = shared_from_this();
+	return std::shared_ptr<double>(buffer, [owner, size](double * p) {
+		auto pool = owner.lock();
+		if (pool) pool->release(p, size);
+		else std::free(p);
+	});
+}
+
+void BufferPool::release(double * buffer, size_t size)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (cached_bytes + size * sizeof(double) > max_cached_bytes) {
+		std::free(buffer);
+		return;
+	}
+
+	free_lists[size].push_back(buffer);
+	cached_bytes += size * sizeof(double);
+}
+
+void BufferPool::trim()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for (auto it = free_lists.begin(); it != free_lists.end(); it++)
+		for (auto buffer : it->second) std::free(buffer);
+	free_lists.clear();
+	cached_bytes = 0;
+}
+
+size_t BufferPool::cached() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return cached_bytes;
+}
+
+}
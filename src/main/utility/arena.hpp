@@ -0,0 +1,158 @@
+#ifndef TESTLIB_ARENA_HPP
+#define TESTLIB_ARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <El.hpp>
+
+namespace alchemist {
+
+// =================================================================================================
+// ======================================== Task arena =============================================
+// =================================================================================================
+
+// Bump allocator for the scalar and small array output parameters of a task, which live as long as
+// the outputs do; scratch that scales with the data belongs in the BufferPool instead. Nothing
+// allocated from the arena is freed individually; reset() destroys every object made with make()
+// and rewinds the arena in one go. After a reset the arena is compacted into a single block large enough for the
+// previous task, so a steady stream of similar tasks runs without touching the heap.
+class TaskArena {
+public:
+	explicit TaskArena(size_t _block_size = 1 << 20) : block_size(_block_size), high_water(0) { }
+
+	~TaskArena();
+
+	TaskArena(const TaskArena &) = delete;
+	TaskArena & operator=(const TaskArena &) = delete;
+
+	void * allocate(size_t bytes, size_t alignment = 64);
+
+	// Uninitialized storage for length trivially constructible elements
+	template <typename T>
+	T * allocate_array(size_t length) {
+		static_assert(std::is_trivially_destructible<T>::value, "arena arrays are never destructed");
+		return reinterpret_cast<T *>(allocate(length * sizeof(T), alignof(T) > 64 ? alignof(T) : 64));
+	}
+
+	// Constructs an object in the arena, its destructor runs on reset()
+	template <typename T, typename... Args>
+	T * make(Args &&... args) {
+		T * p = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+		if (!std::is_trivially_destructible<T>::value)
+			destructors.push_back(std::make_pair(&destroy<T>, reinterpret_cast<void *>(p)));
+		return p;
+	}
+
+	void reset();
+
+	size_t bytes_used() const;
+	size_t capacity() const;
+
+private:
+	struct Block {
+		char * data;
+		size_t size, used;
+	};
+
+	template <typename T>
+	static void destroy(void * p) { reinterpret_cast<T *>(p)->~T(); }
+
+	size_t block_size, high_water;
+	std::vector<Block> blocks;
+	std::vector<std::pair<void (*)(void *), void *> > destructors;
+};
+
+// Arenas of the tasks run through TestLib::run. The output parameters of a task share ownership of
+// its arena, so its scalar outputs stay valid for as long as the caller holds them, whatever runs in
+// the meantime. The arena is reset and reused by a later task once the last of them is dropped.
+class ArenaPool : public std::enable_shared_from_this<ArenaPool> {
+public:
+	explicit ArenaPool(size_t _max_cached = 4) : max_cached(_max_cached) { }
+
+	std::shared_ptr<TaskArena> acquire();
+
+	size_t cached() const;
+
+private:
+	void release(TaskArena * arena);
+
+	size_t max_cached;
+	mutable std::mutex mutex;
+	std::vector<std::unique_ptr<TaskArena> > free_list;
+};
+
+typedef std::shared_ptr<ArenaPool> ArenaPool_ptr;
+
+// =================================================================================================
+// ======================================== Buffer pool ============================================
+// =================================================================================================
+
+// Size-class pool for large, long-lived buffers such as the local Gramian and the backing stores of
+// distributed output matrices. Requests up to 1 MiB are rounded up to a power of two (at least one
+// page), larger ones to a multiple of an eighth of the power of two below them, so no buffer is more
+// than 12.5% larger than asked for. Released buffers are kept on a free list per class, up to
+// max_cached_bytes in all, so repeated tasks of similar size reuse the same memory instead of
+// fragmenting the heap; anything beyond that goes back to the system. Buffers are handed out as
+// shared pointers that return themselves to the pool; they remain valid if the pool is destroyed first.
+class BufferPool : public std::enable_shared_from_this<BufferPool> {
+public:
+	static const size_t default_max_cached_bytes = size_t(256) << 20;
+
+	explicit BufferPool(size_t _max_cached_bytes = default_max_cached_bytes) : max_cached_bytes(_max_cached_bytes), cached_bytes(0) { }
+
+	~BufferPool() { trim(); }
+
+	std::shared_ptr<double> acquire(size_t length);
+
+	// Frees every cached buffer
+	void trim();
+
+	size_t cached() const;
+
+private:
+	static size_t class_size(size_t length);
+
+	void release(double * buffer, size_t length);
+
+	size_t max_cached_bytes, cached_bytes;
+	mutable std::mutex mutex;
+	std::map<size_t, std::vector<double *> > free_lists;
+};
+
+typedef std::shared_ptr<BufferPool> BufferPool_ptr;
+
+// Local view of an El::Matrix onto pooled storage; the buffer must outlive the matrix
+inline void attach_pooled(El::Matrix<double> & M, const std::shared_ptr<double> & buffer, El::Int m, El::Int n)
+{
+	M.Attach(m, n, buffer.get(), std::max(m, El::Int(1)));
+}
+
+// Creates an m x n distributed matrix whose local panel lives in a pooled buffer. The returned
+// pointer owns both, and the buffer goes back to the pool when the matrix is destroyed.
+template <El::Dist U, El::Dist V>
+std::shared_ptr<El::DistMatrix<double, U, V> > make_pooled_distmatrix(const BufferPool_ptr & pool, El::Int m, El::Int n, const El::Grid & grid)
+{
+	typedef El::DistMatrix<double, U, V> Matrix;
+
+	std::unique_ptr<Matrix> M{new Matrix(grid)};
+	El::Int local_height = El::Length(m, M->ColShift(), M->ColStride());
+	El::Int local_width = El::Length(n, M->RowShift(), M->RowStride());
+	El::Int ldim = std::max(local_height, El::Int(1));
+
+	std::shared_ptr<double> buffer = pool->acquire((size_t) (ldim * local_width));
+	M->Attach(m, n, grid, 0, 0, buffer.get(), ldim);
+
+	return std::shared_ptr<Matrix>(M.release(), [buffer](Matrix * p) mutable { delete p; buffer.reset(); });
+}
+
+}
+
+#endif // TESTLIB_ARENA_HPP
@@ -0,0 +1,85 @@
+#ifndef TESTLIB_ARNOLDI_HPP
+#define TESTLIB_ARNOLDI_HPP
+
+// ARPACK++ defines some non-template symbols in its headers, so this header may only be included
+// from one translation unit (TestLib.cpp, through TestLib.hpp)
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include "arpackpp/arrssym.h"
+#include "checkpoint.hpp"
+
+namespace alchemist {
+
+// ARPACK++'s reverse-communication symmetric solver with read access to the Krylov basis and the
+// residual vector, which the base class keeps protected
+class CheckpointableSymStdEig : public ARrcSymStdEig<double> {
+public:
+	CheckpointableSymStdEig(int np, int nevp, const std::string & whichp = "LM", int ncvp = 0, double tolp = 0.0,
+			int maxitp = 0, double * residp = nullptr) :
+		ARrcSymStdEig<double>(np, nevp, whichp, ncvp, tolp, maxitp, residp) { }
+
+	ArnoldiCheckpoint snapshot(uint64_t matvecs) {
+		ArnoldiCheckpoint checkpoint;
+		checkpoint.n = (uint64_t) this->n;
+		checkpoint.nev = (uint64_t) this->nev;
+		checkpoint.ncv = (uint64_t) this->ncv;
+		checkpoint.matvecs = matvecs;
+		// ARPACK++ keeps its work arrays 1-based, V[0] is padding
+		checkpoint.basis.assign(this->V + 1, this->V + 1 + checkpoint.n * checkpoint.ncv);
+		checkpoint.resid.assign(this->resid, this->resid + checkpoint.n);
+		return checkpoint;
+	}
+
+	// Largest error bound of the wanted Ritz values relative to the value itself, as updated by
+	// ARPACK at every implicit restart; ARPACK stops once it drops below the tolerance. Returns a
+	// negative value before the first restart.
+	double residual_estimate() const {
+		if (this->ipntr == nullptr || this->workl == nullptr || this->ipntr[6] <= 0) return -1.0;
+
+		const double * ritz = this->workl + this->ipntr[6];
+		const double * bounds = this->workl + this->ipntr[7];
+		const double eps23 = std::pow(std::numeric_limits<double>::epsilon(), 2.0/3.0);
+
+		// The wanted values are the last nev of the ncv
+		double estimate = 0.0;
+		for (int i = this->ncv - this->nev; i < this->ncv; i++)
+			estimate = std::max(estimate, bounds[i] / std::max(eps23, std::abs(ritz[i])));
+		return (estimate > 0.0) ? estimate : -1.0;
+	}
+
+	// ARPACK's default tolerance is machine precision
+	double target_residual() const {
+		if (requested_tol > 0.0) return requested_tol;
+		return (this->tol > 0.0) ? this->tol : std::numeric_limits<double>::epsilon();
+	}
+
+	// The wanted Ritz values after the latest restart, smallest first; empty before the first restart
+	std::vector<double> wanted_ritz_values() const {
+		if (this->ipntr == nullptr || this->workl == nullptr || this->ipntr[6] <= 0) return std::vector<double>();
+
+		const double * ritz = this->workl + this->ipntr[6];
+		std::vector<double> wanted(ritz + this->ncv - this->nev, ritz + this->ncv);
+		for (auto it = wanted.begin(); it != wanted.end(); it++)
+			if (*it != 0.0) return wanted;
+		return std::vector<double>();
+	}
+
+	// Lets every wanted Ritz pair pass ARPACK's convergence test at the end of the current restart,
+	// so that the iterations stop there and FindEigenvectors returns the current approximations.
+	// ARPACK reads the tolerance afresh at every step and checks it again when extracting the
+	// eigenvectors, so it stays raised from here on.
+	void accept_at_next_restart() {
+		if (requested_tol == 0.0) requested_tol = target_residual();
+		this->tol = std::numeric_limits<double>::max();
+	}
+
+private:
+	double requested_tol = 0.0;				// Tolerance before accept_at_next_restart
+};
+
+}
+
+#endif // TESTLIB_ARNOLDI_HPP
@@ -0,0 +1,36 @@
+#ifndef TESTLIB_ARRAY_BLOCK_HPP
+#define TESTLIB_ARRAY_BLOCK_HPP
+
+#include <cstdint>
+#include <vector>
+
+namespace alchemist {
+
+// =================================================================================================
+// ======================================== Array blocks ===========================================
+// =================================================================================================
+
+// Small array held in full by every process that returns it, the value TestLib gives to and
+// expects of an ARRAY_BLOCK_FLOAT or ARRAY_BLOCK_DOUBLE parameter. Entries are column-major: for
+// dims {m, n}, (i, j) is data[i + j*m].
+template <typename T>
+struct ArrayBlock {
+	std::vector<uint64_t> dims;
+	std::vector<T> data;
+
+	ArrayBlock() { }
+	ArrayBlock(std::vector<uint64_t> _dims) : dims(_dims), data(size()) { }
+
+	uint64_t size() const {
+		uint64_t entries = (dims.empty()) ? 0 : 1;
+		for (auto d : dims) entries *= d;
+		return entries;
+	}
+};
+
+typedef ArrayBlock<float> ArrayBlockFloat;
+typedef ArrayBlock<double> ArrayBlockDouble;
+
+}
+
+#endif // TESTLIB_ARRAY_BLOCK_HPP
@@ -0,0 +1,83 @@
+#include "async.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+
+namespace alchemist {
+
+TaskHandle::TaskHandle(string _name) : name(_name), state(TASK_RUNNING), cancel_requested(false), result(0),
+		start_time(std::chrono::steady_clock::now()), first_iteration(0), first_residual(-1.0), target(0.0) { }
+
+void TaskHandle::start(std::function<int(TaskHandle &)> task)
+{
+	start_time = std::chrono::steady_clock::now();
+
+	worker = std::thread([this, task]() {
+		int code;
+		try {
+			code = task(*this);
+		}
+		catch (std::exception & e) {
+			error = e.what();
+			code = -1;
+		}
+		finish(code);
+	});
+}
+
+void TaskHandle::finish(int _result)
+{
+	result = _result;
+	if (result == 0) state = TASK_DONE;
+	else state = (cancelled()) ? TASK_CANCELLED : TASK_FAILED;
+}
+
+int TaskHandle::wait()
+{
+	std::lock_guard<std::mutex> lock(join_mutex);
+	if (worker.joinable()) worker.join();
+	return result;
+}
+
+TaskProgress TaskHandle::progress() const
+{
+	std::lock_guard<std::mutex> lock(progress_mutex);
+	TaskProgress p = current;
+	p.elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+	if (poll()) {
+		p.eta_seconds = 0.0;
+		return p;
+	}
+
+	double remaining = -1.0;				// Iterations still to go
+	if (target > 0.0 && first_residual > 0.0 && p.residual > 0.0 && p.residual < first_residual && p.iteration > first_iteration) {
+		// Geometric convergence: log(residual) falls by a constant amount per iteration
+		double rate = std::log(first_residual / p.residual) / (double) (p.iteration - first_iteration);
+		remaining = std::max(0.0, std::log(p.residual / target) / rate);
+	}
+	else if (p.max_iterations > 0)
+		remaining = (double) (p.max_iterations - std::min(p.iteration, p.max_iterations));
+
+	if (remaining >= 0.0 && p.iteration > 0)
+		p.eta_seconds = p.elapsed_seconds * remaining / (double) p.iteration;
+
+	return p;
+}
+
+void TaskHandle::report(uint64_t iteration, uint64_t max_iterations, double residual, double target_residual)
+{
+	std::lock_guard<std::mutex> lock(progress_mutex);
+	current.iteration = iteration;
+	current.max_iterations = max_iterations;
+	current.residual = residual;
+	target = target_residual;
+
+	if (first_residual <= 0.0 && residual > 0.0) {
+		first_iteration = iteration;
+		first_residual = residual;
+	}
+}
+
+}
@@ -0,0 +1,108 @@
+#ifndef TESTLIB_ASYNC_HPP
+#define TESTLIB_ASYNC_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "arena.hpp"
+
+namespace alchemist {
+
+using std::string;
+
+struct Parameter;
+
+// =================================================================================================
+// ===================================== Asynchronous tasks ========================================
+// =================================================================================================
+
+typedef enum _task_state : uint8_t {
+	TASK_RUNNING = 0,
+	TASK_DONE,
+	TASK_FAILED,
+	TASK_CANCELLED
+} task_state;
+
+struct TaskProgress {
+	uint64_t iteration;
+	uint64_t max_iterations;				// 0 if unknown
+	double residual;						// Negative if unknown
+	double elapsed_seconds;
+	double eta_seconds;						// Negative if unknown
+
+	TaskProgress() : iteration(0), max_iterations(0), residual(-1.0), elapsed_seconds(0.0), eta_seconds(-1.0) { }
+};
+
+// Handle of a task started with TestLib::run_async. The task runs on its own compute thread; the
+// handle can be polled and waited on from any thread without making MPI calls. Output parameters
+// point into the handle's arena, or at resident matrices, and stay valid while the handle lives.
+class TaskHandle {
+public:
+	explicit TaskHandle(string _name);
+
+	~TaskHandle() { wait(); }
+
+	TaskHandle(const TaskHandle &) = delete;
+	TaskHandle & operator=(const TaskHandle &) = delete;
+
+	const string & get_name() const { return name; }
+
+	// Runs task on the compute thread
+	void start(std::function<int(TaskHandle &)> task);
+	// Marks a task that was run, or rejected, on the calling thread as finished
+	void finish(int result);
+
+	// True once the task has finished, successfully or not
+	bool poll() const { return state.load() != TASK_RUNNING; }
+
+	// Blocks until the task has finished and returns its result, 0 on success
+	int wait();
+
+	task_state get_state() const { return state.load(); }
+	const string & get_error() const { return error; }
+
+	// Scalar outputs and scratch space of the task
+	TaskArena arena;
+	// Filled in by the task, read them only after wait()
+	std::vector<std::shared_ptr<Parameter> > outputs;
+
+	TaskProgress progress() const;
+	// Called by an iterative task as it goes. Given a target residual, the ETA is extrapolated from
+	// the rate at which the residual has been falling, otherwise from iteration/max_iterations.
+	void report(uint64_t iteration, uint64_t max_iterations, double residual = -1.0, double target_residual = 0.0);
+
+	// Asks the task to stop at its next cancellation point
+	void cancel() { cancel_requested = true; }
+	bool cancelled() const { return cancel_requested.load(); }
+
+private:
+	string name;
+	std::thread worker;
+	std::mutex join_mutex;
+
+	std::atomic<task_state> state;
+	std::atomic<bool> cancel_requested;
+	int result;
+	string error;
+
+	std::chrono::steady_clock::time_point start_time;
+	mutable std::mutex progress_mutex;
+	TaskProgress current;
+
+	// First residual reported, for the convergence rate
+	uint64_t first_iteration;
+	double first_residual;
+	double target;
+};
+
+typedef std::shared_ptr<TaskHandle> TaskHandle_ptr;
+
+}
+
+#endif // TESTLIB_ASYNC_HPP
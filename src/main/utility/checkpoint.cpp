@@ -0,0 +1,108 @@
+#include "checkpoint.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+
+namespace alchemist {
+
+static const char checkpoint_magic[8] = {'T', 'L', 'A', 'R', 'N', 'O', 'L', '1'};
+
+std::vector<double> ArnoldiCheckpoint::start_vector() const
+{
+	std::vector<double> start(resid);
+	uint64_t k = (nev < ncv) ? nev : ncv;
+
+	for (uint64_t col = 0; col < k; col++)
+		for (uint64_t row = 0; row < n; row++)
+			start[row] += basis[col*n + row];
+
+	return start;
+}
+
+bool write_checkpoint(const string & path, const ArnoldiCheckpoint & checkpoint)
+{
+	// Write to a temporary file and rename it, so a crash mid-write leaves the previous checkpoint intact
+	string tmp_path = path + ".tmp";
+
+	{
+		std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+		if (!file) return false;
+
+		uint64_t header[4] = {checkpoint.n, checkpoint.nev, checkpoint.ncv, checkpoint.matvecs};
+		file.write(checkpoint_magic, sizeof(checkpoint_magic));
+		file.write(reinterpret_cast<const char *>(header), sizeof(header));
+		file.write(reinterpret_cast<const char *>(checkpoint.basis.data()), checkpoint.basis.size()*sizeof(double));
+		file.write(reinterpret_cast<const char *>(checkpoint.resid.data()), checkpoint.resid.size()*sizeof(double));
+		file.flush();
+		if (!file) return false;
+	}
+
+	return std::rename(tmp_path.c_str(), path.c_str()) == 0;
+}
+
+bool read_checkpoint(const string & path, ArnoldiCheckpoint & checkpoint)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file) return false;
+
+	char magic[8];
+	uint64_t header[4];
+	file.read(magic, sizeof(magic));
+	file.read(reinterpret_cast<char *>(header), sizeof(header));
+	if (!file || std::memcmp(magic, checkpoint_magic, sizeof(magic)) != 0) return false;
+
+	checkpoint.n = header[0];
+	checkpoint.nev = header[1];
+	checkpoint.ncv = header[2];
+	checkpoint.matvecs = header[3];
+	checkpoint.basis.resize(checkpoint.n * checkpoint.ncv);
+	checkpoint.resid.resize(checkpoint.n);
+
+	file.read(reinterpret_cast<char *>(checkpoint.basis.data()), checkpoint.basis.size()*sizeof(double));
+	file.read(reinterpret_cast<char *>(checkpoint.resid.data()), checkpoint.resid.size()*sizeof(double));
+
+	return (bool) file;
+}
+
+AsyncCheckpointWriter::AsyncCheckpointWriter(string _path, uint32_t _every_matvecs, double _every_seconds) :
+		path(_path), every_matvecs(_every_matvecs), every_seconds(_every_seconds), last_matvecs(0),
+		last_time(std::chrono::steady_clock::now()), busy(false), written(0) { }
+
+bool AsyncCheckpointWriter::due(uint64_t matvecs) const
+{
+	if (!enabled()) return false;
+	if (every_matvecs > 0 && matvecs - last_matvecs >= every_matvecs) return true;
+	if (every_seconds > 0.0) {
+		std::chrono::duration<double> elapsed(std::chrono::steady_clock::now() - last_time);
+		if (elapsed.count() >= every_seconds) return true;
+	}
+	return false;
+}
+
+bool AsyncCheckpointWriter::write(ArnoldiCheckpoint && checkpoint)
+{
+	if (busy) return false;
+	if (writer.joinable()) writer.join();
+
+	last_matvecs = checkpoint.matvecs;
+	last_time = std::chrono::steady_clock::now();
+	busy = true;
+
+	// The snapshot is moved into the writer thread, so the solver's buffers can change immediately
+	std::shared_ptr<ArnoldiCheckpoint> data = std::make_shared<ArnoldiCheckpoint>(std::move(checkpoint));
+	writer = std::thread([this, data]() {
+		if (write_checkpoint(path, *data)) written++;
+		busy = false;
+	});
+
+	return true;
+}
+
+void AsyncCheckpointWriter::wait()
+{
+	if (writer.joinable()) writer.join();
+}
+
+}
@@ -0,0 +1,78 @@
+#ifndef TESTLIB_CHECKPOINT_HPP
+#define TESTLIB_CHECKPOINT_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace alchemist {
+
+using std::string;
+
+// =================================================================================================
+// ===================================== Arnoldi checkpoints =======================================
+// =================================================================================================
+
+// Snapshot of the driver's Arnoldi state: the Krylov basis (n x ncv, column-major) and the
+// residual vector of the current Lanczos factorization
+struct ArnoldiCheckpoint {
+	uint64_t n, nev, ncv;
+	uint64_t matvecs;						// Products with A'*A computed before the snapshot was taken
+
+	std::vector<double> basis;
+	std::vector<double> resid;
+
+	ArnoldiCheckpoint() : n(0), nev(0), ncv(0), matvecs(0) { }
+
+	// ARPACK keeps part of its reverse-communication state in Fortran SAVE variables, so a run
+	// cannot be continued where it stopped. A checkpoint only warm-starts a new run, from the
+	// residual plus the leading nev basis vectors, which after the first implicit restart
+	// approximate the wanted Ritz vectors; the new run builds its Krylov basis from scratch.
+	std::vector<double> start_vector() const;
+};
+
+bool write_checkpoint(const string & path, const ArnoldiCheckpoint & checkpoint);
+bool read_checkpoint(const string & path, ArnoldiCheckpoint & checkpoint);
+
+// Writes checkpoints on a background thread so the Arnoldi loop is not stalled by the disk.
+// At most one write is in flight; a checkpoint that falls due while the previous one is still
+// being written is skipped.
+class AsyncCheckpointWriter {
+public:
+	// A checkpoint is due every every_matvecs products or every_seconds seconds (0 disables either)
+	AsyncCheckpointWriter(string _path, uint32_t _every_matvecs, double _every_seconds);
+
+	~AsyncCheckpointWriter() { wait(); }
+
+	bool enabled() const { return !path.empty() && (every_matvecs > 0 || every_seconds > 0.0); }
+
+	bool due(uint64_t matvecs) const;
+
+	// Returns false if the previous checkpoint is still being written
+	bool write(ArnoldiCheckpoint && checkpoint);
+
+	void wait();
+
+	const string & get_path() const { return path; }
+
+	uint32_t num_written() const { return written; }
+
+private:
+	string path;
+	uint32_t every_matvecs;
+	double every_seconds;
+
+	uint64_t last_matvecs;
+	std::chrono::steady_clock::time_point last_time;
+
+	std::thread writer;
+	std::atomic<bool> busy;
+	std::atomic<uint32_t> written;
+};
+
+}
+
+#endif // TESTLIB_CHECKPOINT_HPP
@@ -0,0 +1,270 @@
+#include "matrix_io.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+namespace alchemist {
+
+static const char matrix_file_magic[8] = {'A', 'L', 'M', 'A', 'T', 'R', 'I', 'X'};
+
+MatrixFileHeader::MatrixFileHeader() : version(0), header_bytes(0), num_rows(0), num_cols(0), panel_rows(0),
+		panel_alignment(0), sparse(0), layout(0), file_layout(0), panel_count(0)
+{
+	std::memset(magic, 0, sizeof(magic));
+	std::memset(reserved, 0, sizeof(reserved));
+	std::memset(name, 0, sizeof(name));
+}
+
+MatrixFileHeader::MatrixFileHeader(const string & _name, uint64_t _num_rows, uint64_t _num_cols, uint64_t _panel_rows,
+		uint8_t _layout, uint64_t _panels) :
+		version(matrix_file_version), header_bytes(matrix_file_alignment), num_rows(_num_rows), num_cols(_num_cols),
+		panel_rows(_panel_rows), panel_alignment(matrix_file_alignment), sparse(0), layout(0), file_layout(_layout),
+		panel_count(_panels)
+{
+	std::memcpy(magic, matrix_file_magic, sizeof(magic));
+	std::memset(reserved, 0, sizeof(reserved));
+	std::memset(name, 0, sizeof(name));
+	std::strncpy(name, _name.c_str(), sizeof(name) - 1);
+
+	if (file_layout == MATRIX_FILE_CYCLIC) {
+		panel_count = std::max(panel_count, uint64_t(1));
+		panel_rows = std::max(uint64_t(1), (num_rows + panel_count - 1) / panel_count);
+		return;
+	}
+
+	// Default to panels of about 64 MB
+	if (panel_rows == 0) panel_rows = std::max(uint64_t(1), (uint64_t(64) << 20) / (std::max(num_cols, uint64_t(1)) * sizeof(double)));
+	panel_rows = std::min(panel_rows, std::max(num_rows, uint64_t(1)));
+	panel_count = (num_rows + panel_rows - 1) / panel_rows;
+}
+
+bool MatrixFileHeader::valid() const
+{
+	return std::memcmp(magic, matrix_file_magic, sizeof(magic)) == 0 && version == matrix_file_version &&
+			sparse == 0 && file_layout <= MATRIX_FILE_CYCLIC && panel_rows > 0 && panel_alignment > 0 &&
+			header_bytes >= sizeof(MatrixFileHeader);
+}
+
+bool MatrixFileHeader::byte_swapped() const
+{
+	uint32_t swapped = ((version & 0xffu) << 24) | ((version & 0xff00u) << 8) | ((version >> 8) & 0xff00u) | (version >> 24);
+	return std::memcmp(magic, matrix_file_magic, sizeof(magic)) == 0 && swapped == matrix_file_version;
+}
+
+uint64_t MatrixFileHeader::panel_bytes() const
+{
+	uint64_t bytes = panel_rows * num_cols * sizeof(double);
+	return ((bytes + panel_alignment - 1) / panel_alignment) * panel_alignment;
+}
+
+bool read_matrix_header(const string & path, MatrixFileHeader & header)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file) return false;
+
+	file.read(reinterpret_cast<char *>(&header), sizeof(header));
+	return file && header.valid();
+}
+
+// The same error on every process of comm, so that either all or none of them go on to the next
+// collective call
+static int agree(int error, MPI_Comm comm)
+{
+	MPI_Allreduce(MPI_IN_PLACE, &error, 1, MPI_INT, MPI_MAX, comm);
+	return error;
+}
+
+// Reads or writes the locally owned rows of every panel. Global row i is stored in local row
+// (i - shift)/stride, as for any [VR,STAR] or [VC,STAR] matrix.
+static int transfer_panels(MPI_File fh, MPI_Comm comm, const MatrixFileHeader & header, El::Matrix<double> & local, int shift,
+		int stride, bool write)
+{
+	const uint64_t m = header.num_rows;
+	const int n = (int) header.num_cols;
+	int error = MPI_SUCCESS;
+
+	for (uint64_t panel = 0; panel < header.num_panels() && error == MPI_SUCCESS; panel++) {
+		uint64_t first_row = panel * header.panel_rows;
+		uint64_t end_row = std::min(m, first_row + header.panel_rows);
+		uint64_t height = end_row - first_row;
+
+		// First row of this panel that we own, and how many we own
+		uint64_t first = first_row + (uint64_t) ((shift - (int64_t) (first_row % stride) + stride) % stride);
+		int count = (first < end_row) ? (int) ((end_row - 1 - first) / stride + 1) : 0;
+		El::Int local_first = (count > 0) ? (El::Int) ((first - shift) / stride) : 0;
+
+		// In the file: count rows spaced stride apart, in each of the n columns of the panel.
+		// In memory: count consecutive rows of each local column.
+		MPI_Datatype column, filetype, memtype;
+		MPI_Type_vector(count, 1, stride, MPI_DOUBLE, &column);
+		MPI_Type_create_hvector(n, 1, (MPI_Aint) (height * sizeof(double)), column, &filetype);
+		MPI_Type_vector(n, count, (int) local.LDim(), MPI_DOUBLE, &memtype);
+		MPI_Type_commit(&filetype);
+		MPI_Type_commit(&memtype);
+
+		MPI_Offset displacement = (MPI_Offset) (header.header_bytes + panel * header.panel_bytes() + (first - first_row) * sizeof(double));
+		if (count == 0) displacement = (MPI_Offset) header.header_bytes;
+		error = agree(MPI_File_set_view(fh, displacement, MPI_DOUBLE, filetype, "native", MPI_INFO_NULL), comm);
+
+		MPI_Status status;
+		double * buffer = (count > 0) ? local.Buffer() + local_first : local.Buffer();
+		if (error == MPI_SUCCESS) {
+			if (write) error = MPI_File_write_all(fh, buffer, (count > 0) ? 1 : 0, memtype, &status);
+			else error = MPI_File_read_all(fh, buffer, (count > 0) ? 1 : 0, memtype, &status);
+			error = agree(error, comm);
+		}
+
+		MPI_Type_free(&column);
+		MPI_Type_free(&filetype);
+		MPI_Type_free(&memtype);
+	}
+
+	return error;
+}
+
+// Reads or writes the local panel of a MATRIX_FILE_CYCLIC file laid out for stride processes, which
+// is panel shift of the file
+static int transfer_cyclic(MPI_File fh, MPI_Comm comm, const MatrixFileHeader & header, El::Matrix<double> & local, int shift,
+		int stride, bool write)
+{
+	if (header.num_panels() != (uint64_t) stride) return MPI_ERR_ARG;
+
+	const int n = (int) header.num_cols;
+	int count = (int) local.Height();
+
+	MPI_Datatype filetype, memtype;
+	MPI_Type_vector(n, count, (int) header.panel_rows, MPI_DOUBLE, &filetype);
+	MPI_Type_vector(n, count, (int) local.LDim(), MPI_DOUBLE, &memtype);
+	MPI_Type_commit(&filetype);
+	MPI_Type_commit(&memtype);
+
+	MPI_Offset displacement = (MPI_Offset) (header.header_bytes + shift * header.panel_bytes());
+	int error = agree(MPI_File_set_view(fh, displacement, MPI_DOUBLE, filetype, "native", MPI_INFO_NULL), comm);
+
+	MPI_Status status;
+	if (error == MPI_SUCCESS) {
+		if (write) error = MPI_File_write_all(fh, local.Buffer(), (count > 0) ? 1 : 0, memtype, &status);
+		else error = MPI_File_read_all(fh, local.Buffer(), (count > 0) ? 1 : 0, memtype, &status);
+		error = agree(error, comm);
+	}
+
+	MPI_Type_free(&filetype);
+	MPI_Type_free(&memtype);
+
+	return error;
+}
+
+int load_matrix(const string & path, const El::Grid & grid, const BufferPool_ptr & pool,
+		std::shared_ptr<El::DistMatrix<double, El::VR, El::STAR> > & A, MatrixFileHeader & header)
+{
+	MPI_Comm comm = grid.Comm().comm;
+	MPI_File fh;
+
+	int error = agree(MPI_File_open(comm, path.c_str(), MPI_MODE_RDONLY, MPI_INFO_NULL, &fh), comm);
+	if (error != MPI_SUCCESS) return error;
+
+	MPI_Status status;
+	error = MPI_File_read_at_all(fh, 0, &header, (int) sizeof(header), MPI_BYTE, &status);
+	if (error == MPI_SUCCESS && header.byte_swapped()) error = MPI_ERR_CONVERSION;
+	else if (error == MPI_SUCCESS && !header.valid()) error = MPI_ERR_FILE;
+	error = agree(error, comm);
+
+	if (error == MPI_SUCCESS) {
+		A = make_pooled_distmatrix<El::VR, El::STAR>(pool, (El::Int) header.num_rows, (El::Int) header.num_cols, grid);
+		if (header.file_layout == MATRIX_FILE_CYCLIC)
+			error = transfer_cyclic(fh, comm, header, A->Matrix(), A->ColShift(), A->ColStride(), false);
+		else
+			error = transfer_panels(fh, comm, header, A->Matrix(), A->ColShift(), A->ColStride(), false);
+		if (error != MPI_SUCCESS) A.reset();
+	}
+
+	MPI_File_close(&fh);
+	return error;
+}
+
+int save_matrix(const string & path, const El::DistMatrix<double, El::VR, El::STAR> & A, const string & name,
+		uint64_t panel_rows, uint8_t layout)
+{
+	MPI_Comm comm = A.Grid().Comm().comm;
+	MPI_File fh;
+	int rank;
+	MPI_Comm_rank(comm, &rank);
+
+	MatrixFileHeader header(name, (uint64_t) A.Height(), (uint64_t) A.Width(), panel_rows, layout, (uint64_t) A.ColStride());
+
+	int error = agree(MPI_File_open(comm, path.c_str(), MPI_MODE_WRONLY | MPI_MODE_CREATE, MPI_INFO_NULL, &fh), comm);
+	if (error != MPI_SUCCESS) return error;
+
+	error = agree(MPI_File_set_size(fh, (MPI_Offset) header.file_bytes()), comm);
+
+	// Only rank 0 writes the header, the others learn whether it succeeded before the collective writes
+	if (error == MPI_SUCCESS) {
+		if (rank == 0) {
+			MPI_Status status;
+			std::vector<char> block(header.header_bytes, 0);
+			std::memcpy(block.data(), &header, sizeof(header));
+			error = MPI_File_write_at(fh, 0, block.data(), (int) block.size(), MPI_BYTE, &status);
+		}
+		error = agree(error, comm);
+	}
+
+	// The local panel is only read, but MPI-IO wants a non-const buffer
+	El::Matrix<double> local;
+	local.Attach(A.LocalHeight(), A.LocalWidth(), const_cast<double *>(A.LockedBuffer()), A.LDim());
+	if (error == MPI_SUCCESS) {
+		if (layout == MATRIX_FILE_CYCLIC)
+			error = transfer_cyclic(fh, comm, header, local, A.ColShift(), A.ColStride(), true);
+		else
+			error = transfer_panels(fh, comm, header, local, A.ColShift(), A.ColStride(), true);
+	}
+
+	MPI_File_close(&fh);
+	return error;
+}
+
+int map_matrix(const string & path, const El::Grid & grid, std::shared_ptr<El::DistMatrix<double, El::VR, El::STAR> > & A,
+		MatrixFileHeader & header)
+{
+	typedef El::DistMatrix<double, El::VR, El::STAR> Matrix;
+
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) return MPI_ERR_NO_SUCH_FILE;
+
+	bool complete = pread(fd, &header, sizeof(header), 0) == (ssize_t) sizeof(header);
+	if (!complete || !header.valid()) {
+		close(fd);
+		return (header.byte_swapped()) ? MPI_ERR_CONVERSION : MPI_ERR_FILE;
+	}
+
+	std::unique_ptr<Matrix> M{new Matrix(grid)};
+	if (header.file_layout != MATRIX_FILE_CYCLIC || header.num_panels() != (uint64_t) M->ColStride()) {
+		close(fd);
+		return MPI_ERR_ARG;
+	}
+
+	// Map the whole file: the kernel shares its pages between all processes on the node, and
+	// processes only ever touch the pages of their own panel
+	size_t length = (size_t) header.file_bytes();
+	void * base = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED) return MPI_ERR_NO_MEM;
+
+	const double * panel = reinterpret_cast<const double *>(reinterpret_cast<const char *>(base) + header.header_bytes +
+			M->ColShift() * header.panel_bytes());
+	madvise(const_cast<double *>(panel), (size_t) header.panel_bytes(), MADV_WILLNEED);
+
+	M->LockedAttach((El::Int) header.num_rows, (El::Int) header.num_cols, grid, 0, 0, panel, (El::Int) header.panel_rows);
+
+	A = std::shared_ptr<Matrix>(M.release(), [base, length](Matrix * p) {
+		delete p;
+		munmap(base, length);
+	});
+
+	return MPI_SUCCESS;
+}
+
+}
@@ -0,0 +1,97 @@
+#ifndef TESTLIB_MATRIX_IO_HPP
+#define TESTLIB_MATRIX_IO_HPP
+
+#include <cstdint>
+#include <string>
+#include <El.hpp>
+#include "arena.hpp"
+
+namespace alchemist {
+
+using std::string;
+
+// =================================================================================================
+// ===================================== Binary matrix files =======================================
+// =================================================================================================
+
+// On-disk layout of a dense matrix:
+//
+//   [ header, padded to header_bytes ][ panel 0 ][ panel 1 ] ... [ panel P-1 ]
+//
+// Each panel is stored column by column, so within a panel each column is contiguous. Every panel
+// starts at a multiple of panel_alignment and occupies the same (padded) number of bytes, so the
+// offset of any row can be computed without reading the file. Which rows a panel holds depends on
+// the layout:
+//
+//   MATRIX_FILE_ROW_PANELS: panel p holds rows [p*panel_rows, min((p+1)*panel_rows, num_rows))
+//   MATRIX_FILE_CYCLIC:     panel p holds rows p, p+P, p+2P, ..., which is exactly the local panel
+//                           of process p in a [VR,STAR] matrix on a grid of P processes, with
+//                           leading dimension panel_rows
+//
+// Numbers are stored in the byte order of the machine that wrote the file, values are IEEE doubles.
+// The version number doubles as a byte-order mark: files written on a machine of the other byte
+// order are recognized and rejected.
+
+const uint32_t matrix_file_version = 1;
+const uint64_t matrix_file_alignment = 4096;
+
+typedef enum _matrix_file_layout : uint8_t {
+	MATRIX_FILE_ROW_PANELS = 0,
+	MATRIX_FILE_CYCLIC
+} matrix_file_layout;
+
+struct MatrixFileHeader {
+	char magic[8];							// "ALMATRIX"
+	uint32_t version;
+	uint32_t header_bytes;					// Offset of the first panel
+	uint64_t num_rows, num_cols;
+	uint64_t panel_rows;
+	uint64_t panel_alignment;
+	uint8_t sparse, layout;					// As in MatrixInfo
+	uint8_t file_layout;					// A matrix_file_layout
+	uint8_t reserved[5];
+	uint64_t panel_count;
+	char name[184];
+
+	MatrixFileHeader();
+	// For MATRIX_FILE_CYCLIC, _panels is the number of processes the file is laid out for
+	MatrixFileHeader(const string & _name, uint64_t _num_rows, uint64_t _num_cols, uint64_t _panel_rows = 0,
+			uint8_t _layout = MATRIX_FILE_ROW_PANELS, uint64_t _panels = 1);
+
+	bool valid() const;
+	// A valid header, but written on a machine of the other byte order
+	bool byte_swapped() const;
+
+	uint64_t num_panels() const { return panel_count; }
+
+	// Bytes reserved for each panel, including padding
+	uint64_t panel_bytes() const;
+
+	uint64_t file_bytes() const { return header_bytes + num_panels() * panel_bytes(); }
+};
+
+// Reads the header with plain POSIX I/O, e.g. on the driver
+bool read_matrix_header(const string & path, MatrixFileHeader & header);
+
+// Collectively reads the matrix at path into a new row-distributed matrix on grid. Each process
+// reads only the rows it owns, straight into the local buffer of the result. Returns an MPI error
+// code, the same on every process (MPI_ERR_CONVERSION for a file of the other byte order), and
+// leaves A empty on failure.
+int load_matrix(const string & path, const El::Grid & grid, const BufferPool_ptr & pool,
+		std::shared_ptr<El::DistMatrix<double, El::VR, El::STAR> > & A, MatrixFileHeader & header);
+
+// Collectively writes a row-distributed matrix to path; MATRIX_FILE_CYCLIC lays the file out for
+// the grid of A. Returns an MPI error code, the same on every process.
+int save_matrix(const string & path, const El::DistMatrix<double, El::VR, El::STAR> & A, const string & name,
+		uint64_t panel_rows = 0, uint8_t layout = MATRIX_FILE_ROW_PANELS);
+
+// Maps a MATRIX_FILE_CYCLIC file laid out for the size of grid and attaches each process's local
+// panel to the mapped pages without copying, so processes on one node share a single page-cache
+// copy of the matrix. The mapping is private and read-only and lives as long as A. Not collective.
+// Returns an MPI error code.
+int map_matrix(const string & path, const El::Grid & grid, std::shared_ptr<El::DistMatrix<double, El::VR, El::STAR> > & A,
+		MatrixFileHeader & header);
+
+}
+
+#endif // TESTLIB_MATRIX_IO_HPP
@@ -0,0 +1,100 @@
+#include "node_collectives.hpp"
+
+#include <cstdint>
+#include <cstring>
+
+namespace alchemist {
+
+NodeCollectives::NodeCollectives(MPI_Comm comm, int _n, int root) : n(_n), node(MPI_COMM_NULL), leaders(MPI_COMM_NULL),
+		node_rank(0), node_size(1), nodes(1), root_leader(0), is_root(false), window(MPI_WIN_NULL),
+		shared_vector(nullptr), node_sum(nullptr), own(nullptr)
+{
+	int rank;
+	MPI_Comm_rank(comm, &rank);
+	is_root = rank == root;
+
+	// Order processes so that the root leads its node and comes first among the leaders
+	int key = (is_root) ? 0 : rank + 1;
+	MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, key, MPI_INFO_NULL, &node);
+	MPI_Comm_rank(node, &node_rank);
+	MPI_Comm_size(node, &node_size);
+
+	MPI_Comm_split(comm, (node_rank == 0) ? 0 : MPI_UNDEFINED, key, &leaders);
+	if (leaders != MPI_COMM_NULL) MPI_Comm_size(leaders, &nodes);
+	MPI_Bcast(&nodes, 1, MPI_INT, 0, node);
+
+	// The leader's segment holds the broadcast vector and the node sum ahead of its own contribution
+	MPI_Aint bytes = (MPI_Aint) ((node_rank == 0) ? 3 : 1) * n * sizeof(double);
+	double * base;
+	MPI_Win_allocate_shared(bytes, sizeof(double), MPI_INFO_NULL, node, &base, &window);
+	MPI_Win_lock_all(MPI_MODE_NOCHECK, window);
+
+	MPI_Aint leader_bytes;
+	int disp_unit;
+	double * leader_base;
+	MPI_Win_shared_query(window, 0, &leader_bytes, &disp_unit, &leader_base);
+	shared_vector = leader_base;
+	node_sum = leader_base + n;
+	own = (node_rank == 0) ? base + 2 * n : base;
+
+	contributions.resize(node_size);
+	for (int r = 0; r < node_size; r++) {
+		MPI_Aint segment_bytes;
+		MPI_Win_shared_query(window, r, &segment_bytes, &disp_unit, &contributions[r]);
+		if (r == 0) contributions[r] += 2 * n;
+	}
+
+	std::memset(own, 0, n * sizeof(double));
+	if (node_rank == 0) std::memset(base, 0, 2 * n * sizeof(double));
+	sync();
+}
+
+NodeCollectives::~NodeCollectives()
+{
+	if (window != MPI_WIN_NULL) {
+		MPI_Win_unlock_all(window);
+		MPI_Win_free(&window);
+	}
+	if (leaders != MPI_COMM_NULL) MPI_Comm_free(&leaders);
+	if (node != MPI_COMM_NULL) MPI_Comm_free(&node);
+}
+
+// Makes the stores of every process of the node visible to the others
+void NodeCollectives::sync()
+{
+	MPI_Win_sync(window);
+	MPI_Barrier(node);
+	MPI_Win_sync(window);
+}
+
+void NodeCollectives::broadcast()
+{
+	if (leaders != MPI_COMM_NULL && nodes > 1)
+		MPI_Bcast(shared_vector, n, MPI_DOUBLE, root_leader, leaders);
+	sync();
+}
+
+void NodeCollectives::reduce(double * result)
+{
+	sync();
+
+	// Every process of the node sums its own slice of the contributions
+	int first = (int) (((int64_t) n * node_rank) / node_size);
+	int last = (int) (((int64_t) n * (node_rank + 1)) / node_size);
+
+	for (int i = first; i < last; i++) {
+		double sum = 0.0;
+		for (int r = 0; r < node_size; r++) sum += contributions[r][i];
+		node_sum[i] = sum;
+	}
+	sync();
+
+	if (leaders != MPI_COMM_NULL) {
+		if (nodes == 1) {
+			if (is_root) std::memcpy(result, node_sum, n * sizeof(double));
+		}
+		else MPI_Reduce(node_sum, (is_root) ? result : nullptr, n, MPI_DOUBLE, MPI_SUM, root_leader, leaders);
+	}
+}
+
+}
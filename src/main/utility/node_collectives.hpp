@@ -0,0 +1,61 @@
+#ifndef TESTLIB_NODE_COLLECTIVES_HPP
+#define TESTLIB_NODE_COLLECTIVES_HPP
+
+#include <vector>
+#include <mpi.h>
+
+namespace alchemist {
+
+// =================================================================================================
+// ============================ Hierarchical broadcast and reduction ===============================
+// =================================================================================================
+
+// Broadcast and sum of length-n vectors between a root and every other process of a communicator,
+// staged through an MPI-3 shared-memory window on each node. One leader per node takes part in the
+// inter-node exchange; the other processes of the node read the broadcast vector in place and
+// write their contributions straight into shared memory, so network traffic no longer grows with
+// the number of processes per node and nobody keeps a private copy of the vector.
+//
+// Usage per round: the root fills vector() and calls broadcast(), every other process calls
+// broadcast() and then reads vector(). Every process then writes its contribution() and calls
+// reduce(); the root receives the sum in the buffer it passes.
+class NodeCollectives {
+public:
+	// Collective over comm
+	NodeCollectives(MPI_Comm comm, int _n, int root = 0);
+
+	~NodeCollectives();
+
+	NodeCollectives(const NodeCollectives &) = delete;
+	NodeCollectives & operator=(const NodeCollectives &) = delete;
+
+	double * vector() { return shared_vector; }
+	double * contribution() { return own; }
+
+	// Collective over comm
+	void broadcast();
+	// Collective over comm; result is only written on the root
+	void reduce(double * result);
+
+	int num_nodes() const { return nodes; }
+	int ranks_per_node() const { return node_size; }
+
+private:
+	int n;
+	MPI_Comm node, leaders;
+	int node_rank, node_size, nodes;
+	int root_leader;
+	bool is_root;
+
+	MPI_Win window;
+	double * shared_vector;					// Broadcast vector, in the leader's segment
+	double * node_sum;						// Sum of the node's contributions, in the leader's segment
+	double * own;							// This process's contribution
+	std::vector<double *> contributions;	// Of every process of the node
+
+	void sync();
+};
+
+}
+
+#endif // TESTLIB_NODE_COLLECTIVES_HPP
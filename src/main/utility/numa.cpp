@@ -0,0 +1,217 @@
+#include "numa.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <fstream>
+#include <thread>
+#include <algorithm>
+#ifdef __linux__
+#include <sched.h>
+#include <pthread.h>
+#include <dirent.h>
+#endif
+
+namespace alchemist {
+
+// Parses a Linux cpulist such as "0-15,32-47"
+static std::vector<int> parse_cpulist(const string & list)
+{
+	std::vector<int> cpus;
+	stringstream ss(list);
+	string range;
+
+	while (std::getline(ss, range, ',')) {
+		if (range.empty() || range[0] == '\n') continue;
+		auto dash = range.find('-');
+		int first = std::atoi(range.substr(0, dash).c_str());
+		int last = (dash == string::npos) ? first : std::atoi(range.substr(dash+1).c_str());
+		for (int cpu = first; cpu <= last; cpu++) cpus.push_back(cpu);
+	}
+
+	return cpus;
+}
+
+affinity_policy affinity_policy_from_env()
+{
+	const char * env = std::getenv("TESTLIB_AFFINITY");
+
+	if (env == nullptr) return AFFINITY_NONE;
+	if (std::strcmp(env, "close") == 0) return AFFINITY_CLOSE;
+	if (std::strcmp(env, "spread") == 0) return AFFINITY_SPREAD;
+	return AFFINITY_NONE;
+}
+
+NumaTopology discover_numa_topology()
+{
+	NumaTopology topology;
+
+#ifdef __linux__
+	cpu_set_t allowed;
+	CPU_ZERO(&allowed);
+	sched_getaffinity(0, sizeof(allowed), &allowed);
+
+	DIR * dir = opendir("/sys/devices/system/node");
+	if (dir != nullptr) {
+		std::vector<int> node_ids;
+		struct dirent * entry;
+		while ((entry = readdir(dir)) != nullptr) {
+			if (std::strncmp(entry->d_name, "node", 4) == 0 && std::isdigit(entry->d_name[4]))
+				node_ids.push_back(std::atoi(entry->d_name + 4));
+		}
+		closedir(dir);
+		std::sort(node_ids.begin(), node_ids.end());
+
+		for (auto it = node_ids.begin(); it != node_ids.end(); it++) {
+			std::ifstream cpulist("/sys/devices/system/node/node" + std::to_string(*it) + "/cpulist");
+			string list;
+			std::getline(cpulist, list);
+
+			std::vector<int> cpus;
+			for (int cpu : parse_cpulist(list))
+				if (CPU_ISSET(cpu, &allowed)) cpus.push_back(cpu);
+
+			// Nodes outside our cpuset (e.g. the other socket when there are two ranks per node) are skipped
+			if (!cpus.empty()) topology.node_cpus.push_back(cpus);
+		}
+	}
+
+	if (topology.node_cpus.empty()) {
+		std::vector<int> cpus;
+		for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+			if (CPU_ISSET(cpu, &allowed)) cpus.push_back(cpu);
+		topology.node_cpus.push_back(cpus);
+	}
+#else
+	std::vector<int> cpus;
+	for (int cpu = 0; cpu < (int) std::thread::hardware_concurrency(); cpu++) cpus.push_back(cpu);
+	topology.node_cpus.push_back(cpus);
+#endif
+
+	topology.num_threads = omp_get_max_threads();
+
+	return topology;
+}
+
+void share_cpus(NumaTopology & topology, MPI_Comm comm)
+{
+#ifdef __linux__
+	MPI_Comm node;
+	MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &node);
+	int node_rank, node_size;
+	MPI_Comm_rank(node, &node_rank);
+	MPI_Comm_size(node, &node_size);
+
+	cpu_set_t allowed;
+	CPU_ZERO(&allowed);
+	sched_getaffinity(0, sizeof(allowed), &allowed);
+	std::vector<cpu_set_t> masks(node_size);
+	MPI_Allgather(&allowed, (int) sizeof(allowed), MPI_BYTE, masks.data(), (int) sizeof(allowed), MPI_BYTE, node);
+	MPI_Comm_free(&node);
+
+	int share = 0, shares = 0;
+	for (int q = 0; q < node_size; q++) {
+		if (!CPU_EQUAL(&masks[q], &allowed)) continue;
+		if (q < node_rank) share++;
+		shares++;
+	}
+	if (shares == 1) return;
+
+	// Contiguous shares of the CPUs in node order keep each process on as few NUMA nodes as possible
+	int total = topology.num_cpus();
+	// With more processes than CPUs each still gets one
+	int first = (int) ((int64_t) total * share / shares), last = (int) ((int64_t) total * (share + 1) / shares);
+	last = std::max(last, first + 1);
+	std::vector<std::vector<int> > node_cpus;
+	int index = 0;
+	for (auto it = topology.node_cpus.begin(); it != topology.node_cpus.end(); it++) {
+		std::vector<int> cpus;
+		for (int cpu : *it) {
+			if (index >= first && index < last) cpus.push_back(cpu);
+			index++;
+		}
+		if (!cpus.empty()) node_cpus.push_back(cpus);
+	}
+	if (!node_cpus.empty()) topology.node_cpus = node_cpus;
+#endif
+}
+
+int pin_threads(NumaTopology & topology, affinity_policy policy)
+{
+	topology.policy = policy;
+	topology.thread_cpus.clear();
+	topology.num_threads = omp_get_max_threads();
+
+	if (policy == AFFINITY_NONE) return 0;
+
+#ifdef __linux__
+	const int num_nodes = topology.num_nodes();
+	std::vector<int> order;
+
+	if (policy == AFFINITY_CLOSE) {
+		for (auto it = topology.node_cpus.begin(); it != topology.node_cpus.end(); it++)
+			order.insert(order.end(), it->begin(), it->end());
+	}
+	else {
+		size_t max_cpus = 0;
+		for (auto it = topology.node_cpus.begin(); it != topology.node_cpus.end(); it++)
+			max_cpus = std::max(max_cpus, it->size());
+		for (size_t idx = 0; idx < max_cpus; idx++)
+			for (int node = 0; node < num_nodes; node++)
+				if (idx < topology.node_cpus[node].size()) order.push_back(topology.node_cpus[node][idx]);
+	}
+
+	topology.thread_cpus.assign(topology.num_threads, -1);
+	int failures = 0;
+
+	// Thread 0 is the thread that loaded the library, and every thread the host creates later would
+	// inherit its mask
+	#pragma omp parallel reduction(+:failures)
+	{
+		int thread = omp_get_thread_num();
+		if (thread > 0) {
+			int cpu = order[thread % order.size()];
+
+			cpu_set_t mask;
+			CPU_ZERO(&mask);
+			CPU_SET(cpu, &mask);
+			if (pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask) != 0) failures++;
+			else topology.thread_cpus[thread] = cpu;
+		}
+	}
+
+	return failures;
+#else
+	return 0;
+#endif
+}
+
+string NumaTopology::to_string() const
+{
+	stringstream ss;
+
+	ss << num_nodes() << " NUMA node(s), " << num_cpus() << " CPU(s), " << num_threads << " OpenMP thread(s), affinity ";
+	switch (policy) {
+	case AFFINITY_NONE:
+		ss << "none";
+		break;
+	case AFFINITY_CLOSE:
+		ss << "close";
+		break;
+	case AFFINITY_SPREAD:
+		ss << "spread";
+		break;
+	}
+
+	for (int node = 0; node < num_nodes(); node++)
+		ss << std::endl << "    node " << node << ": " << node_cpus[node].size() << " CPU(s), first " << node_cpus[node].front();
+
+	if (!thread_cpus.empty()) {
+		ss << std::endl << "    thread -> CPU:";
+		for (size_t thread = 0; thread < thread_cpus.size(); thread++) ss << " " << thread << "->" << thread_cpus[thread];
+	}
+
+	return ss.str();
+}
+
+}
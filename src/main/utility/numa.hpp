@@ -0,0 +1,83 @@
+#ifndef TESTLIB_NUMA_HPP
+#define TESTLIB_NUMA_HPP
+
+#include <omp.h>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <El.hpp>
+
+namespace alchemist {
+
+using std::string;
+using std::stringstream;
+
+// =================================================================================================
+// ================================== NUMA topology and affinity ===================================
+// =================================================================================================
+
+typedef enum _affinity_policy : uint8_t {
+	AFFINITY_NONE = 0,				// Leave thread placement to the OS and the OpenMP runtime
+	AFFINITY_CLOSE,					// Fill the CPUs of one NUMA node before moving on to the next
+	AFFINITY_SPREAD					// Round-robin threads over the NUMA nodes
+} affinity_policy;
+
+struct NumaTopology {
+	// CPUs this process is allowed to run on, grouped by NUMA node
+	std::vector<std::vector<int> > node_cpus;
+	// CPU that OpenMP thread i is pinned to, -1 if it is not (empty if threads are not pinned)
+	std::vector<int> thread_cpus;
+
+	int num_threads;
+	affinity_policy policy;
+
+	NumaTopology() : num_threads(1), policy(AFFINITY_NONE) { }
+
+	int num_nodes() const { return (int) node_cpus.size(); }
+
+	int num_cpus() const {
+		int count = 0;
+		for (auto it = node_cpus.begin(); it != node_cpus.end(); it++) count += (int) it->size();
+		return count;
+	}
+
+	string to_string() const;
+};
+
+// Reads the policy from TESTLIB_AFFINITY ("none", "close" or "spread"), defaults to none
+affinity_policy affinity_policy_from_env();
+
+// Groups the CPUs in this process's affinity mask by NUMA node using /sys/devices/system/node
+NumaTopology discover_numa_topology();
+
+// Processes of comm on one node whose affinity masks are the same split their CPUs into disjoint,
+// contiguous shares, and the topology is narrowed to this process's share. Collective over comm.
+void share_cpus(NumaTopology & topology, MPI_Comm comm);
+
+// Pins the OpenMP threads other than the calling one to the CPUs of the topology according to the
+// given policy. The number of threads is left to the OpenMP runtime, and the calling thread, which
+// belongs to the host, keeps its affinity mask. Returns the number of threads that could not be pinned.
+int pin_threads(NumaTopology & topology, affinity_policy policy);
+
+// Initializes a buffer from an OpenMP static schedule so that each page is placed on the NUMA node
+// of the thread that will later work on it. Kernels that want local memory should traverse the
+// buffer with the same static schedule.
+template <typename T>
+void first_touch(T * buffer, size_t length, T value = T())
+{
+	const long long len = (long long) length;
+	#pragma omp parallel for schedule(static)
+	for (long long i = 0; i < len; i++)
+		buffer[i] = value;
+}
+
+template <typename T>
+void first_touch(El::Matrix<T> & M, T value = T())
+{
+	// Columns are contiguous, so an LDim-strided buffer is touched column by column
+	first_touch(M.Buffer(), (size_t) M.LDim() * M.Width(), value);
+}
+
+}
+
+#endif // TESTLIB_NUMA_HPP
@@ -0,0 +1,58 @@
+// Task arenas that live as long as the outputs pointing into them, and the buffer pool's size
+// classes and cache limit
+
+#include <string>
+#include "test.hpp"
+#include "arena.hpp"
+
+using namespace alchemist;
+
+int main(int argc, char ** argv)
+{
+	MPI_Init(&argc, &argv);
+
+	// A value made in a task's arena survives later tasks for as long as something holds the arena
+	auto arenas = std::make_shared<ArenaPool>(2);
+	std::shared_ptr<TaskArena> first = arenas->acquire();
+	uint64_t * kept = first->make<uint64_t>(42);
+	std::string * name = first->make<std::string>("first task");
+	std::shared_ptr<TaskArena> held = first;
+	first.reset();
+	for (int task = 0; task < 3; task++) {
+		auto arena = arenas->acquire();
+		CHECK(arena != held);
+		for (int i = 0; i < 1000; i++) *arena->make<uint64_t>() = 7;
+	}
+	CHECK(*kept == 42);
+	CHECK(*name == "first task");
+	CHECK(arenas->cached() == 1);
+	held.reset();
+	CHECK(arenas->cached() == 2);
+
+	// No size class wastes more than an eighth of a large request
+	auto pool = std::make_shared<BufferPool>(size_t(1) << 30);
+	size_t lengths[] = {1, 511, 512, 513, 100000, 131072, 131073, 1000000, 3 * 131072 + 1, 50000000};
+	for (size_t length : lengths) {
+		pool->trim();
+		pool->acquire(length);
+		size_t bytes = pool->cached();
+		CHECK(bytes >= length * sizeof(double));
+		if (length > 131072) CHECK(bytes <= length * sizeof(double) + length * sizeof(double) / 8 + sizeof(double));
+	}
+
+	// A released buffer of the same class is reused
+	pool->trim();
+	double * address = pool->acquire(1000000).get();
+	CHECK(pool->acquire(999999).get() == address);
+
+	// Buffers beyond the cache limit go back to the system
+	auto small = std::make_shared<BufferPool>(size_t(1) << 20);
+	small->acquire(1 << 18);
+	CHECK(small->cached() == 0);
+	small->acquire(1 << 10);
+	CHECK(small->cached() == 8192);
+
+	int status = testlib_test::finish("arena_test");
+	MPI_Finalize();
+	return status;
+}
@@ -0,0 +1,75 @@
+// Task handles: progress and ETA while a task runs, cancellation, failures, and tasks finished on
+// the calling thread
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include "test.hpp"
+#include "async.hpp"
+
+using namespace alchemist;
+
+int main(int argc, char ** argv)
+{
+	MPI_Init(&argc, &argv);
+
+	// Progress is visible while the task runs, and the ETA follows the iteration count
+	{
+		std::atomic<int> reported(0);
+		std::atomic<bool> release(false);
+		TaskHandle handle("progress");
+		handle.start([&](TaskHandle & h) {
+			h.report(5, 10);
+			reported = 1;
+			while (!release) std::this_thread::yield();
+			return 0;
+		});
+		while (reported == 0) std::this_thread::yield();
+		CHECK(!handle.poll());
+		TaskProgress p = handle.progress();
+		CHECK(p.iteration == 5 && p.max_iterations == 10);
+		CHECK(p.eta_seconds >= 0.0);
+		release = true;
+		CHECK(handle.wait() == 0);
+		CHECK(handle.get_state() == TASK_DONE);
+		CHECK(handle.progress().eta_seconds == 0.0);
+	}
+
+	// A task that stops at a cancellation point ends up cancelled rather than failed
+	{
+		std::atomic<bool> started(false);
+		TaskHandle handle("cancel");
+		handle.start([&](TaskHandle & h) {
+			started = true;
+			uint64_t iteration = 0;
+			while (!h.cancelled()) h.report(++iteration, 0);
+			return -1;
+		});
+		while (!started) std::this_thread::yield();
+		handle.cancel();
+		CHECK(handle.wait() == -1);
+		CHECK(handle.get_state() == TASK_CANCELLED);
+	}
+
+	// An exception fails the task with its message
+	{
+		TaskHandle handle("throw");
+		handle.start([](TaskHandle &) -> int { throw std::runtime_error("no convergence"); });
+		CHECK(handle.wait() == -1);
+		CHECK(handle.get_state() == TASK_FAILED);
+		CHECK(handle.get_error() == "no convergence");
+	}
+
+	// Without MPI_THREAD_MULTIPLE run_async finishes the task on the calling thread
+	{
+		TaskHandle handle("synchronous");
+		handle.finish(0);
+		CHECK(handle.poll());
+		CHECK(handle.wait() == 0);
+		CHECK(handle.get_state() == TASK_DONE);
+	}
+
+	int status = testlib_test::finish("async_test");
+	MPI_Finalize();
+	return status;
+}
@@ -0,0 +1,121 @@
+// Cancelling truncated_svd and nmf while they run, through the C entry points: the driver reports
+// progress, a cancel on the driver makes every process leave the task's loop and end up cancelled,
+// and the processes are still in step for the next task. Needs MPI_THREAD_MULTIPLE, without which
+// run_async finishes a task before returning and there is nothing to cancel.
+
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "test.hpp"
+#include "TestLib.hpp"
+
+using namespace alchemist;
+
+typedef El::DistMatrix<double, El::VR, El::STAR> RowMatrix;
+
+static const uint64_t rows = 4000, cols = 200;
+
+// Nonnegative, for nmf, and of full rank, so that neither task converges in a few iterations
+static double entry(El::Int i, El::Int j)
+{
+	double s = std::sin(0.37 * (double) (i * 7 + j * 3 + 1) + 0.01 * (double) (i * j));
+	return 1.0 + s * s;
+}
+
+// Starts the task on every process, cancels it on the driver once it has reported an iteration, and
+// waits for it everywhere
+static void cancel_running(void * library, const char * task_name, const std::vector<alchemist_parameter> & in, int rank)
+{
+	alchemist_task * task = alchemist_run_async(library, task_name, in.data(), (uint32_t) in.size());
+	alchemist_progress progress;
+	if (rank == 0) {
+		do {
+			std::this_thread::yield();
+			alchemist_task_progress(task, &progress);
+		} while (progress.iteration == 0 && alchemist_task_poll(task) == 0);
+		CHECK(progress.iteration >= 1 && progress.max_iterations > progress.iteration);
+		CHECK(progress.elapsed_seconds >= 0.0);
+		alchemist_task_cancel(task);
+	}
+
+	CHECK(alchemist_task_wait(task) == -1);
+	CHECK(alchemist_task_state(task) == ALCHEMIST_TASK_CANCELLED);
+	CHECK(alchemist_task_outputs(task, nullptr, 0) == 0);
+	alchemist_task_progress(task, &progress);
+	CHECK(progress.eta_seconds == 0.0);
+	alchemist_task_free(task);
+}
+
+int main(int argc, char ** argv)
+{
+	int provided;
+	MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+	El::Initialize(argc, argv);
+	int rank, size;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &size);
+	CHECK(size >= 2);
+
+	if (provided < MPI_THREAD_MULTIPLE) {
+		if (rank == 0) std::printf("cancel_test: MPI_THREAD_MULTIPLE is not available, nothing to cancel\n");
+	}
+	else if (size >= 2) {
+		MPI_Comm world = MPI_COMM_WORLD;
+		void * library = alchemist_create_library(&world, ALCHEMIST_LIBRARY_ABI_VERSION);
+		TestLib * lib = reinterpret_cast<TestLib *>(library);
+		CHECK(lib->load() == 0);
+
+		// Workers pass their rows of A, the driver a description of it
+		MPI_Comm workers;
+		MPI_Comm_split(MPI_COMM_WORLD, (rank == 0) ? MPI_UNDEFINED : 1, rank, &workers);
+		std::unique_ptr<El::Grid> grid;
+		std::unique_ptr<RowMatrix> A;
+		MatrixInfo info(0, "A", rows, cols);
+		alchemist_parameter a = {"A", MATRIX_INFO, &info};
+		if (rank != 0) {
+			grid.reset(new El::Grid(El::mpi::Comm(workers)));
+			A.reset(new RowMatrix((El::Int) rows, (El::Int) cols, *grid));
+			for (El::Int j = 0; j < (El::Int) cols; j++)
+				for (El::Int il = 0; il < A->LocalHeight(); il++) A->Matrix().Set(il, j, entry(A->GlobalRow(il), j));
+			a.dt = DISTMATRIX_VR_STAR;
+			a.p = A.get();
+		}
+
+		// truncated_svd stops at the command the driver broadcasts before each product
+		uint32_t svd_rank = 10;
+		cancel_running(library, "truncated_svd", {a, {"rank", UINT32, &svd_rank}}, rank);
+
+		// nmf stops at the reduction that ends each iteration
+		uint32_t nmf_rank = 5, max_iterations = 100000;
+		double tol = 0.0;
+		cancel_running(library, "nmf", {a, {"rank", UINT32, &nmf_rank}, {"max_iterations", UINT32, &max_iterations},
+				{"tol", DOUBLE, &tol}}, rank);
+
+		// Every process left both loops at the same point, so the next task runs normally
+		uint32_t few = 3;
+		std::vector<alchemist_parameter> in = {a, {"rank", UINT32, &nmf_rank}, {"max_iterations", UINT32, &few}, {"tol", DOUBLE, &tol}};
+		alchemist_task * task = alchemist_run_async(library, "nmf", in.data(), (uint32_t) in.size());
+		CHECK(alchemist_task_wait(task) == 0 && alchemist_task_state(task) == ALCHEMIST_TASK_DONE);
+		std::vector<alchemist_parameter> out(alchemist_task_outputs(task, nullptr, 0));
+		alchemist_task_outputs(task, out.data(), (uint32_t) out.size());
+		bool found = false;
+		for (size_t i = 0; i < out.size(); i++)
+			if (string(out[i].name) == "iterations") found = * reinterpret_cast<uint32_t *>(out[i].p) == few;
+		CHECK(found == (rank == 0));
+		alchemist_task_free(task);
+
+		CHECK(lib->unload() == 0);
+		alchemist_destroy_library(library);
+		A.reset();
+		grid.reset();
+		if (workers != MPI_COMM_NULL) MPI_Comm_free(&workers);
+	}
+
+	int status = testlib_test::finish("cancel_test");
+	El::Finalize();
+	MPI_Finalize();
+	return status;
+}
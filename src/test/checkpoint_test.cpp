@@ -0,0 +1,78 @@
+// Arnoldi checkpoints: write/read round trip, rejection of foreign or truncated files, the warm-start
+// vector, and the background writer's schedule
+
+#include <cstdio>
+#include <fstream>
+#include <unistd.h>
+#include "test.hpp"
+#include "checkpoint.hpp"
+
+using namespace alchemist;
+
+int main(int argc, char ** argv)
+{
+	MPI_Init(&argc, &argv);
+	int rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	string path = "/tmp/testlib_checkpoint_test_" + std::to_string(getpid()) + "_" + std::to_string(rank) + ".ckpt";
+
+	ArnoldiCheckpoint saved;
+	saved.n = 5;
+	saved.nev = 2;
+	saved.ncv = 4;
+	saved.matvecs = 37;
+	for (uint64_t i = 0; i < saved.n * saved.ncv; i++) saved.basis.push_back(0.5 * (double) i - 3.0);
+	for (uint64_t i = 0; i < saved.n; i++) saved.resid.push_back(1.0 / (double) (i + 1));
+
+	CHECK(write_checkpoint(path, saved));
+	ArnoldiCheckpoint loaded;
+	CHECK(read_checkpoint(path, loaded));
+	CHECK(loaded.n == saved.n && loaded.nev == saved.nev && loaded.ncv == saved.ncv && loaded.matvecs == saved.matvecs);
+	CHECK(loaded.basis == saved.basis);
+	CHECK(loaded.resid == saved.resid);
+
+	// Residual plus the leading nev basis vectors
+	std::vector<double> start = loaded.start_vector();
+	CHECK(start.size() == saved.n);
+	for (uint64_t i = 0; i < saved.n; i++)
+		CHECK_CLOSE(start[i], saved.resid[i] + saved.basis[i] + saved.basis[saved.n + i], 1e-15);
+
+	// A truncated file, or one that is not a checkpoint, is rejected
+	{
+		std::ifstream in(path, std::ios::binary);
+		std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+		std::ofstream out(path, std::ios::binary | std::ios::trunc);
+		out.write(bytes.data(), (std::streamsize) (bytes.size() - 8));
+	}
+	CHECK(!read_checkpoint(path, loaded));
+	{
+		std::ofstream out(path, std::ios::binary | std::ios::trunc);
+		out << "not a checkpoint, but long enough to hold a header";
+	}
+	CHECK(!read_checkpoint(path, loaded));
+	CHECK(!read_checkpoint(path + ".missing", loaded));
+
+	// Due every 10 products; the write replaces the file through a temporary one
+	{
+		AsyncCheckpointWriter writer(path, 10, 0.0);
+		CHECK(writer.enabled());
+		CHECK(!writer.due(9));
+		CHECK(writer.due(10));
+		ArnoldiCheckpoint copy = saved;
+		CHECK(writer.write(std::move(copy)));
+		writer.wait();
+		CHECK(writer.num_written() == 1);
+		CHECK(!writer.due(saved.matvecs + 9));
+		CHECK(writer.due(saved.matvecs + 10));
+	}
+	CHECK(read_checkpoint(path, loaded));
+	CHECK(loaded.basis == saved.basis);
+	CHECK(!std::ifstream(path + ".tmp"));
+	CHECK(!AsyncCheckpointWriter("", 10, 0.0).enabled());
+
+	std::remove(path.c_str());
+
+	int status = testlib_test::finish("checkpoint_test");
+	MPI_Finalize();
+	return status;
+}
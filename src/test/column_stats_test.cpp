@@ -0,0 +1,89 @@
+// Column statistics against those of the entries themselves, merged without cancellation, and
+// sketches that do not depend on how the rows are distributed
+
+#include <cmath>
+#include <limits>
+#include "test.hpp"
+#include "nla.hpp"
+
+using namespace alchemist;
+
+typedef El::DistMatrix<double, El::VR, El::STAR> RowMatrix;
+
+// A large offset in the last column, where sum and sum of squares would cancel to no correct digits
+static double entry(El::Int i, El::Int j)
+{
+	double a = std::sin(0.3 * (double) (i * 7 + j * 11)) + 0.01 * (double) i;
+	return (j == 4) ? 1e8 + a : a;
+}
+
+static void fill(RowMatrix & A)
+{
+	for (El::Int j = 0; j < A.Width(); j++)
+		for (El::Int il = 0; il < A.LocalHeight(); il++) A.Matrix().Set(il, j, entry(A.GlobalRow(il), j));
+}
+
+static double largest_difference(const El::Matrix<double> & X, const El::Matrix<double> & Y)
+{
+	if (X.Height() != Y.Height() || X.Width() != Y.Width()) return std::numeric_limits<double>::infinity();
+	double error = 0.0;
+	for (El::Int j = 0; j < X.Width(); j++)
+		for (El::Int i = 0; i < X.Height(); i++) error = std::max(error, std::abs(X.Get(i, j) - Y.Get(i, j)));
+	return error;
+}
+
+int main(int argc, char ** argv)
+{
+	El::Initialize(argc, argv);
+	{
+		const El::Int m = 41, n = 5, s = 8;
+		El::Grid grid(MPI_COMM_WORLD), alone(MPI_COMM_SELF);
+		RowMatrix A(m, n, grid), A1(m, n, alone);
+		fill(A);
+		fill(A1);
+
+		ColumnStats stats;
+		column_stats(A, stats);
+		CHECK(stats.count == (uint64_t) m && stats.sketch_rows == 0);
+		double error = 0.0;
+		for (El::Int j = 0; j < n; j++) {
+			double mean = 0.0, m2 = 0.0, lo = entry(0, j), hi = entry(0, j), squares = 0.0;
+			for (El::Int i = 0; i < m; i++) mean += entry(i, j) / (double) m;
+			for (El::Int i = 0; i < m; i++) {
+				double a = entry(i, j);
+				m2 += (a - mean) * (a - mean);
+				squares += a * a;
+				lo = std::min(lo, a);
+				hi = std::max(hi, a);
+			}
+			CHECK(stats.min[j] == lo && stats.max[j] == hi);
+			error = std::max(error, std::abs(stats.mean[j] - mean) / std::max(1.0, std::abs(mean)));
+			error = std::max(error, std::abs(stats.variance(j) - m2 / (double) (m - 1)) / (m2 / (double) (m - 1)));
+			error = std::max(error, std::abs(stats.norm(j) - std::sqrt(squares)) / std::sqrt(squares));
+		}
+		CHECK_CLOSE(error, 0.0, 1e-6);
+
+		// Count and Gaussian sketches are the same on one process as on all of them, and every sketch is
+		// the sum of the shares of the processes
+		for (uint8_t sketch : {SKETCH_COUNT, SKETCH_GAUSSIAN, SKETCH_SRHT}) {
+			ColumnStats sketched, single;
+			column_stats(A, sketched, sketch, s, 17);
+			CHECK(sketched.sketch == sketch && sketched.sketch_rows == s);
+			CHECK(sketched.sketch_matrix.Height() == s && sketched.sketch_matrix.Width() == n);
+
+			El::Matrix<double> shares;
+			El::Zeros(shares, s, n);
+			sketch_local(A, sketch, s, 17, shares);
+			MPI_Allreduce(MPI_IN_PLACE, shares.Buffer(), (int) (s * n), MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+			CHECK_CLOSE(largest_difference(shares, sketched.sketch_matrix), 0.0, 1e-6);
+
+			if (sketch != SKETCH_SRHT) {
+				column_stats(A1, single, sketch, s, 17);
+				CHECK_CLOSE(largest_difference(single.sketch_matrix, sketched.sketch_matrix), 0.0, 1e-6);
+			}
+		}
+	}
+	int status = testlib_test::finish("column_stats_test");
+	El::Finalize();
+	return status;
+}
@@ -0,0 +1,105 @@
+// CUR of an exactly low-rank matrix: leverage scores and column choices, actual columns and rows
+// of A, C*U*R equal to A, and the same rows whatever the number of processes
+
+#include <cmath>
+#include <numeric>
+#include "test.hpp"
+#include "nla.hpp"
+
+using namespace alchemist;
+
+typedef El::DistMatrix<double, El::VR, El::STAR> RowMatrix;
+
+static const El::Int m = 30, n = 10, k = 3;
+
+// Rank k, with column 7 zero so that it has no leverage
+static double entry(El::Int i, El::Int j)
+{
+	if (j == 7) return 0.0;
+	double a = 0.0;
+	for (El::Int c = 0; c < k; c++) a += std::cos((double) (i * (c + 2) + c)) * std::sin((double) (j * j + 3 * c + 1));
+	return a;
+}
+
+static void fill(RowMatrix & A)
+{
+	for (El::Int j = 0; j < n; j++)
+		for (El::Int il = 0; il < A.LocalHeight(); il++) A.Matrix().Set(il, j, entry(A.GlobalRow(il), j));
+}
+
+int main(int argc, char ** argv)
+{
+	El::Initialize(argc, argv);
+	{
+		El::Grid grid(MPI_COMM_WORLD), alone(MPI_COMM_SELF);
+		auto pool = std::make_shared<BufferPool>();
+		RowMatrix A(m, n, grid), A1(m, n, alone);
+		fill(A);
+		fill(A1);
+
+		// Leading right singular vectors from the eigenvectors of A'*A
+		El::Matrix<double> G(n, n), w, Z;
+		for (El::Int a = 0; a < n; a++)
+			for (El::Int b = 0; b < n; b++) {
+				double g = 0.0;
+				for (El::Int i = 0; i < m; i++) g += entry(i, a) * entry(i, b);
+				G.Set(a, b, g);
+			}
+		El::HermitianEig(El::LOWER, G, w, Z);
+		std::vector<El::Int> order(n);
+		std::iota(order.begin(), order.end(), El::Int(0));
+		std::sort(order.begin(), order.end(), [&w](El::Int a, El::Int b) { return w.Get(a, 0) > w.Get(b, 0); });
+		RowMatrix V(n, k, grid);
+		for (El::Int il = 0; il < V.LocalHeight(); il++)
+			for (El::Int c = 0; c < k; c++) V.Matrix().Set(il, c, Z.Get(V.GlobalRow(il), order[c]));
+
+		// The scores of V with k orthonormal columns sum to k
+		std::vector<double> scores = leverage_scores(V);
+		CHECK((El::Int) scores.size() == n);
+		CHECK_CLOSE(std::accumulate(scores.begin(), scores.end(), 0.0), (double) k, 1e-10);
+		CHECK(std::abs(scores[7]) < 1e-12);
+
+		// Deterministic and sampled choices are sorted, distinct, and never the zero column
+		std::vector<El::Int> largest = select_columns(scores, 5, false, 0), sampled = select_columns(scores, 5, true, 3);
+		CHECK(largest.size() == 5 && sampled.size() == 5);
+		CHECK(std::adjacent_find(sampled.begin(), sampled.end(), [](El::Int a, El::Int b) { return a >= b; }) == sampled.end());
+		CHECK(std::find(largest.begin(), largest.end(), 7) == largest.end());
+		CHECK(std::find(sampled.begin(), sampled.end(), 7) == sampled.end());
+		CHECK(select_columns(scores, 5, true, 3) == sampled);
+		CHECK(select_columns(scores, 2 * n, false, 0).size() == (size_t) n);
+
+		CURFactors factors, single;
+		cur(pool, A, largest, 8, 5, factors);
+		cur(pool, A1, largest, 8, 5, single);
+		CHECK(factors.rows == single.rows);
+		CHECK(factors.rows.size() >= (size_t) k);
+		CHECK(factors.U.Height() == 5 && factors.U.Width() == (El::Int) factors.rows.size());
+
+		bool actual = true;
+		for (size_t s = 0; s < factors.rows.size(); s++)
+			for (El::Int j = 0; j < n; j++) actual = actual && factors.R.Get((El::Int) s, j) == entry(factors.rows[s], j);
+		const El::Matrix<double> & Cl = factors.C->LockedMatrix();
+		for (El::Int q = 0; q < 5; q++)
+			for (El::Int il = 0; il < Cl.Height(); il++) actual = actual && Cl.Get(il, q) == entry(factors.C->GlobalRow(il), largest[q]);
+		CHECK(actual);
+
+		// C*U*R reproduces A, whose rank the chosen columns and rows both capture
+		El::Matrix<double> UR;
+		El::Zeros(UR, 5, n);
+		El::Gemm(El::NORMAL, El::NORMAL, 1.0, factors.U, factors.R, 0.0, UR);
+		double error = 0.0, scale = 0.0;
+		for (El::Int il = 0; il < Cl.Height(); il++)
+			for (El::Int j = 0; j < n; j++) {
+				double a = 0.0;
+				for (El::Int q = 0; q < 5; q++) a += Cl.Get(il, q) * UR.Get(q, j);
+				error = std::max(error, std::abs(a - entry(factors.C->GlobalRow(il), j)));
+				scale = std::max(scale, std::abs(entry(factors.C->GlobalRow(il), j)));
+			}
+		MPI_Allreduce(MPI_IN_PLACE, &error, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+		MPI_Allreduce(MPI_IN_PLACE, &scale, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+		CHECK_CLOSE(error / scale, 0.0, 1e-8);
+	}
+	int status = testlib_test::finish("cur_test");
+	El::Finalize();
+	return status;
+}
@@ -0,0 +1,45 @@
+// The static library descriptor: every task it lists is one that run() dispatches, and the
+// parameter lists are well formed
+
+#include <set>
+#include <string>
+#include "test.hpp"
+#include "TestLib.hpp"
+
+using namespace alchemist;
+
+static bool well_formed(const alchemist_parameter_descriptor * params, uint32_t count)
+{
+	if (count > 0 && params == nullptr) return false;
+	std::set<std::string> names;
+	for (uint32_t i = 0; i < count; i++)
+		if (params[i].name == nullptr || !names.insert(params[i].name).second) return false;
+	return true;
+}
+
+int main(int argc, char ** argv)
+{
+	MPI_Init(&argc, &argv);
+
+	const alchemist_library_descriptor * library = alchemist_describe_library();
+	CHECK(library != nullptr && library->num_tasks > 0);
+
+	std::set<std::string> names;
+	for (uint32_t i = 0; i < library->num_tasks; i++) {
+		const alchemist_task_descriptor & task = library->tasks[i];
+		CHECK(names.insert(task.name).second);
+		CHECK(TestLib::has_task(task.name));
+		CHECK(alchemist_find_task(library, task.name) == &task);
+		CHECK(well_formed(task.inputs, task.num_inputs));
+		CHECK(well_formed(task.outputs, task.num_outputs));
+		CHECK(task.num_layouts == 0 || task.preferred_layouts != nullptr);
+	}
+
+	// Tasks that are not described are not run either
+	CHECK(!TestLib::has_task("kmeans"));
+	CHECK(alchemist_find_task(library, "kmeans") == nullptr);
+
+	int status = testlib_test::finish("descriptor_test");
+	MPI_Finalize();
+	return status;
+}
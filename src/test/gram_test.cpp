@@ -0,0 +1,61 @@
+// Gramians of row-distributed matrices, summed onto their owners panel by panel, against the
+// Gramian of the whole matrix
+
+#include <cmath>
+#include "test.hpp"
+#include "nla.hpp"
+
+using namespace alchemist;
+
+typedef El::DistMatrix<double, El::VR, El::STAR> RowMatrix;
+
+static double entry(El::Int i, El::Int j) { return std::sin(0.7 * (double) i + 1.3 * (double) j) + 0.01 * (double) j; }
+
+int main(int argc, char ** argv)
+{
+	El::Initialize(argc, argv);
+	{
+		El::Grid grid(MPI_COMM_WORLD);
+		auto pool = std::make_shared<BufferPool>();
+		int p = grid.Size();
+
+		// n is not a multiple of the number of processes, and some processes may own no rows
+		for (El::Int m : {El::Int(2), El::Int(40)}) {
+			const El::Int n = 7;
+			RowMatrix A(m, n, grid);
+			for (El::Int j = 0; j < n; j++)
+				for (El::Int il = 0; il < A.LocalHeight(); il++) A.Matrix().Set(il, j, entry(A.GlobalRow(il), j));
+
+			auto G = gram(pool, A, true);
+			CHECK(G->Height() == n && G->Width() == n);
+			const El::Matrix<double> & local = G->LockedMatrix();
+			double error = 0.0;
+			for (El::Int il = 0; il < local.Height(); il++)
+				for (El::Int j = 0; j < n; j++) {
+					El::Int i = G->GlobalRow(il);
+					double expected = 0.0;
+					for (El::Int r = 0; r < m; r++) expected += entry(r, i) * entry(r, j);
+					error = std::max(error, std::abs(local.Get(il, j) - expected));
+				}
+			CHECK_CLOSE(error, 0.0, 1e-10);
+
+			// Columns j = 1, 3, 5 onto the last process
+			El::Matrix<double> block(n, 3);
+			El::Zeros(block, n, 3);
+			reduce_gram_columns(pool, A.LockedMatrix(), 1, 2, 3, p - 1, MPI_COMM_WORLD, block.Buffer());
+			if (grid.Rank() == p - 1) {
+				error = 0.0;
+				for (El::Int c = 0; c < 3; c++)
+					for (El::Int i = 0; i < n; i++) {
+						double expected = 0.0;
+						for (El::Int r = 0; r < m; r++) expected += entry(r, i) * entry(r, 1 + 2 * c);
+						error = std::max(error, std::abs(block.Get(i, c) - expected));
+					}
+				CHECK_CLOSE(error, 0.0, 1e-10);
+			}
+		}
+	}
+	int status = testlib_test::finish("gram_test");
+	El::Finalize();
+	return status;
+}
@@ -0,0 +1,160 @@
+// Worker groups: a task on each group of a split, with the dimensions of its inputs passed on by
+// the group's first worker, tasks of both groups in flight at once, and a new split that waits for
+// them and releases the matrices left on the old groups. Meant for 5 processes, which split into two
+// groups of a driver and one worker; with 3 or 4 the split into two groups is refused and one group
+// is tested instead.
+
+#include <string>
+#include <vector>
+#include "test.hpp"
+#include "TestLib.hpp"
+
+using namespace alchemist;
+
+typedef El::AbstractDistMatrix<double> AbstractMatrix;
+
+static Parameter_ptr param(const string & name, datatype dt, void * p) { return std::make_shared<Parameter>(name, dt, p); }
+
+static void * output(const vector<Parameter_ptr> & out, const string & name)
+{
+	for (auto it = out.begin(); it != out.end(); it++)
+		if ((*it)->name == name) return (*it)->p;
+	return nullptr;
+}
+
+static int split(TestLib & lib, uint32_t num_groups, vector<Parameter_ptr> & out)
+{
+	string task = "create_groups";
+	vector<Parameter_ptr> in = {param("num_groups", UINT32, &num_groups)};
+	return lib.run(task, in, out);
+}
+
+// A rows x cols matrix on group g, returned on the processes of the group's grid
+static AbstractMatrix * generate(TestLib & lib, uint32_t g, uint64_t rows, uint64_t cols, vector<Parameter_ptr> & out)
+{
+	string task = "generate_matrix";
+	uint64_t seed = g;
+	vector<Parameter_ptr> in = {param("group", UINT32, &g), param("rows", UINT64, &rows), param("cols", UINT64, &cols),
+			param("seed", UINT64, &seed)};
+	CHECK(lib.run(task, in, out) == 0);
+	return reinterpret_cast<AbstractMatrix *>(output(out, "A"));
+}
+
+// Whether G is A'*A; collective over the grid of A
+static bool is_gram(const AbstractMatrix & A, const AbstractMatrix & G)
+{
+	if (G.Height() != A.Width() || G.Width() != A.Width()) return false;
+	El::DistMatrix<double, El::STAR, El::STAR> As(A), Gs(G);
+	double error = 0.0;
+	for (El::Int a = 0; a < A.Width(); a++)
+		for (El::Int b = 0; b < A.Width(); b++) {
+			double g = 0.0;
+			for (El::Int i = 0; i < A.Height(); i++) g += As.LockedMatrix().Get(i, a) * As.LockedMatrix().Get(i, b);
+			error = std::max(error, std::abs(Gs.LockedMatrix().Get(a, b) - g) / std::max(1.0, std::abs(g)));
+		}
+	return error < 1e-10;
+}
+
+int main(int argc, char ** argv)
+{
+	El::Initialize(argc, argv);
+	int rank, size;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &size);
+	CHECK(size >= 3);
+
+	if (size >= 3) {
+		MPI_Comm world = MPI_COMM_WORLD;
+		TestLib lib(world);
+		CHECK(lib.load() == 0);
+
+		const uint32_t num_groups = (size >= 5) ? 2 : 1;
+		const uint64_t cols = 4;
+		vector<Parameter_ptr> out;
+
+		// Every group needs a driver and a worker; all processes refuse too many groups alike
+		CHECK(split(lib, (uint32_t) size, out) == -1);
+		CHECK(out.empty());
+		if (size < 5) CHECK(split(lib, 2, out) == -1);
+
+		CHECK(split(lib, num_groups, out) == 0);
+		uint32_t expected = (rank == 0) ? 0 : (uint32_t) (1 + ((rank - 1) * (int) num_groups) / (size - 1));
+		if (rank == 0) CHECK(* reinterpret_cast<uint32_t *>(output(out, "num_groups")) == num_groups);
+		else CHECK(* reinterpret_cast<uint32_t *>(output(out, "group")) == expected);
+
+		// The first process of each group drives it, and holds no part of its matrices
+		bool group_driver = rank != 0 && (rank == 1 || expected != (uint32_t) (1 + ((rank - 2) * (int) num_groups) / (size - 1)));
+		bool group_worker = rank != 0 && !group_driver;
+
+		// A matrix and its Gramian on each group, one group after the other. gram learns the dimensions
+		// of A on the group's driver from the group's first worker.
+		vector<AbstractMatrix *> A(num_groups + 1, nullptr);
+		for (uint32_t g = 1; g <= num_groups; g++) {
+			A[g] = generate(lib, g, 10 + g, cols, out);
+			CHECK((A[g] != nullptr) == (group_worker && expected == g));
+
+			string task = "gram";
+			vector<Parameter_ptr> in = {param("group", UINT32, &g), param("A", DISTMATRIX, A[g])}, gram_out;
+			CHECK(lib.run(task, in, gram_out) == 0);
+			AbstractMatrix * G = reinterpret_cast<AbstractMatrix *>(output(gram_out, "G"));
+			CHECK((G != nullptr) == (A[g] != nullptr));
+			if (G != nullptr) {
+				CHECK(A[g]->Height() == (El::Int) (10 + g) && &G->Grid() == &A[g]->Grid());
+				CHECK(is_gram(*A[g], *G));
+			}
+		}
+
+		// Gramians on both groups at once; a task on group 1 waits only for the one in flight there
+		vector<uint32_t> ids(num_groups + 1);
+		vector<vector<Parameter_ptr> > async_in(num_groups + 1);
+		vector<TaskHandle_ptr> handles(num_groups + 1);
+		for (uint32_t g = 1; g <= num_groups; g++) {
+			ids[g] = g;
+			async_in[g] = {param("group", UINT32, &ids[g]), param("A", DISTMATRIX, A[g])};
+			string task = "gram";
+			handles[g] = lib.run_async(task, async_in[g]);
+		}
+		AbstractMatrix * B = generate(lib, 1, 9, cols, out);
+		CHECK((B != nullptr) == (group_worker && expected == 1));
+		if (expected == 1) CHECK(handles[1]->poll() && handles[1]->wait() == 0);
+		if (expected == 1 && group_worker) CHECK(is_gram(*A[1], * reinterpret_cast<AbstractMatrix *>(output(handles[1]->outputs, "G"))));
+
+		// A, its Gramian twice and B on the worker of group 1, nothing on the drivers. Group 2 may
+		// still be adding to its resident set.
+		if (rank == 0 || expected == 1) CHECK(lib.resident.size() == ((group_worker) ? 4 : 0));
+
+		// A new split waits for every task in flight and drops what lived on the old groups
+		out.clear();
+		CHECK(split(lib, 1, out) == 0);
+		for (uint32_t g = 1; g <= num_groups; g++) CHECK(handles[g]->poll() && handles[g]->wait() == 0);
+		CHECK(lib.in_flight.empty());
+		CHECK(lib.resident.empty() && lib.stats_cache.empty());
+		if (rank != 0) CHECK(* reinterpret_cast<uint32_t *>(output(out, "group")) == 1);
+
+		// One group of every worker, whose grid leaves out its driver
+		AbstractMatrix * C = generate(lib, 1, 12, cols, out);
+		CHECK((C != nullptr) == (rank > 1));
+		if (C != nullptr) CHECK(C->Grid().Size() == size - 2 && C->Height() == 12);
+
+		// A group that no longer exists is refused everywhere, before any collective call
+		{
+			string task = "gram";
+			uint32_t g = 2;
+			vector<Parameter_ptr> in = {param("group", UINT32, &g), param("A", DISTMATRIX, C)}, gram_out;
+			CHECK(lib.run(task, in, gram_out) == -1);
+		}
+
+		// Without groups, tasks run on world again
+		CHECK(split(lib, 0, out) == 0);
+		CHECK(lib.resident.empty());
+		AbstractMatrix * D = generate(lib, 0, 12, cols, out);
+		CHECK((D != nullptr) == (rank != 0));
+		if (D != nullptr) CHECK(D->Grid().Size() == size - 1);
+
+		CHECK(lib.unload() == 0);
+	}
+
+	int status = testlib_test::finish("groups_test");
+	El::Finalize();
+	return status;
+}
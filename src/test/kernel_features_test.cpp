@@ -0,0 +1,97 @@
+// Gaussian kernel features: random Fourier features approximate the kernel, Nystrom features
+// reproduce it on their landmarks, through both the direct and the Gemm distance paths, and
+// neither depends on the number of processes
+
+#include <cmath>
+#include "test.hpp"
+#include "nla.hpp"
+
+using namespace alchemist;
+
+typedef El::DistMatrix<double, El::VR, El::STAR> RowMatrix;
+
+static const El::Int m = 40, d = 3;
+static const double gamma_ = 0.5;
+
+static double entry(El::Int i, El::Int j) { return std::sin(0.77 * (double) (i * (j + 1)) + (double) j); }
+
+static double kernel(El::Int x, El::Int y)
+{
+	double distance = 0.0;
+	for (El::Int j = 0; j < d; j++) distance += (entry(x, j) - entry(y, j)) * (entry(x, j) - entry(y, j));
+	return std::exp(-gamma_ * distance);
+}
+
+static void fill(RowMatrix & A)
+{
+	for (El::Int j = 0; j < d; j++)
+		for (El::Int il = 0; il < A.LocalHeight(); il++) A.Matrix().Set(il, j, entry(A.GlobalRow(il), j));
+}
+
+// z(x)*z(y)' for Z on a single process
+static double product(const RowMatrix & Z, El::Int x, El::Int y)
+{
+	double dot = 0.0;
+	for (El::Int f = 0; f < Z.Width(); f++) dot += Z.LockedMatrix().Get(x, f) * Z.LockedMatrix().Get(y, f);
+	return dot;
+}
+
+// Largest difference between the local rows of Z and the same rows of Z1, which is on one process
+static double local_difference(const RowMatrix & Z, const RowMatrix & Z1)
+{
+	if (Z.Height() != Z1.Height() || Z.Width() != Z1.Width()) return 1e300;
+	double difference = 0.0;
+	for (El::Int il = 0; il < Z.LocalHeight(); il++)
+		for (El::Int f = 0; f < Z.Width(); f++)
+			difference = std::max(difference, std::abs(Z.LockedMatrix().Get(il, f) - Z1.LockedMatrix().Get(Z.GlobalRow(il), f)));
+	return difference;
+}
+
+int main(int argc, char ** argv)
+{
+	El::Initialize(argc, argv);
+	{
+		El::Grid grid(MPI_COMM_WORLD), alone(MPI_COMM_SELF);
+		auto pool = std::make_shared<BufferPool>();
+		RowMatrix A(m, d, grid), A1(m, d, alone);
+		fill(A);
+		fill(A1);
+
+		// Random Fourier features: an unbiased estimate with error of order 1/sqrt(D)
+		{
+			const El::Int D = 4000;
+			auto Z = random_fourier_features(pool, A, D, gamma_, 3);
+			auto Z1 = random_fourier_features(pool, A1, D, gamma_, 3);
+			CHECK(Z->Height() == m && Z->Width() == D);
+			CHECK_CLOSE(local_difference(*Z, *Z1), 0.0, 1e-12);
+
+			double error = 0.0;
+			for (El::Int x = 0; x < m; x++)
+				for (El::Int y = 0; y <= x; y++) error = std::max(error, std::abs(product(*Z1, x, y) - kernel(x, y)));
+			CHECK(error < 0.1);
+		}
+
+		// Nystrom features: with fewer landmarks than max_small_k distances are taken directly, with
+		// every row as a landmark through Gemm, and the kernel is exact between landmarks
+		for (El::Int L : {El::Int(10), m}) {
+			auto Z = nystrom_features(pool, A, L, gamma_, 5);
+			auto Z1 = nystrom_features(pool, A1, L, gamma_, 5);
+			CHECK(Z->Height() == m && Z->Width() > 0 && Z->Width() <= L);
+			CHECK_CLOSE(local_difference(*Z, *Z1), 0.0, 1e-9);
+
+			// Rows whose features reproduce their own kernel value are the landmarks
+			std::vector<El::Int> landmarks;
+			for (El::Int x = 0; x < m; x++)
+				if (std::abs(product(*Z1, x, x) - 1.0) < 1e-8) landmarks.push_back(x);
+			CHECK((El::Int) landmarks.size() >= std::min(L, Z1->Width()));
+
+			double error = 0.0;
+			for (El::Int x : landmarks)
+				for (El::Int y : landmarks) error = std::max(error, std::abs(product(*Z1, x, y) - kernel(x, y)));
+			CHECK_CLOSE(error, 0.0, 1e-6);
+		}
+	}
+	int status = testlib_test::finish("kernel_features_test");
+	El::Finalize();
+	return status;
+}
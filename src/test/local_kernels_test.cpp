@@ -0,0 +1,117 @@
+// The local kernels of every instruction set the processor supports against plain loops, for
+// widths on both sides of the panel width and row counts past the distance block
+
+#include <cmath>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "test.hpp"
+#include "nla.hpp"
+
+using namespace alchemist;
+
+static double value(El::Int i, El::Int j) { return std::sin(0.37 * (double) (i * 5 + j * 3 + 1)); }
+
+static void check_kernels(const LocalKernels & kernels)
+{
+	const El::Int rows = 131, ld = 137, d = 7;
+	const El::Int widths[] = {1, 3, 8, 9, 19};
+
+	for (El::Int k : widths) {
+		// scale_columns
+		std::vector<double> u((size_t) (ld * k)), scale(k);
+		for (El::Int c = 0; c < k; c++) {
+			scale[c] = 1.0 + 0.5 * (double) c;
+			for (El::Int i = 0; i < ld; i++) u[i + c * ld] = value(i, c);
+		}
+		kernels.scale_columns(u.data(), rows, ld, k, scale.data());
+		bool exact = true;
+		for (El::Int c = 0; c < k; c++)
+			for (El::Int i = 0; i < ld; i++) exact = exact && u[i + c * ld] == ((i < rows) ? value(i, c) * scale[c] : value(i, c));
+		CHECK(exact);
+
+		// scatter_rows, every third row from row 2
+		std::vector<double> full((size_t) (3 * rows + 2) * k), v((size_t) (ld * k), 0.0);
+		El::Int ldf = 3 * rows + 2;
+		for (El::Int c = 0; c < k; c++)
+			for (El::Int i = 0; i < ldf; i++) full[i + c * ldf] = value(i, c);
+		kernels.scatter_rows(full.data(), ldf, 2, 3, rows, k, v.data(), ld);
+		exact = true;
+		for (El::Int c = 0; c < k; c++)
+			for (El::Int i = 0; i < rows; i++) exact = exact && v[i + c * ld] == value(2 + 3 * i, c);
+		CHECK(exact);
+
+		// squared_distances of rows rows of x from k centers, stored as the rows of a k x d matrix
+		std::vector<double> x((size_t) (ld * d)), centers((size_t) (k * d)), norms(k, 0.0), out((size_t) (ld * k));
+		for (El::Int j = 0; j < d; j++) {
+			for (El::Int i = 0; i < ld; i++) x[i + j * ld] = value(i, j);
+			for (El::Int c = 0; c < k; c++) {
+				centers[c + j * k] = value(c + 500, j);
+				norms[c] += centers[c + j * k] * centers[c + j * k];
+			}
+		}
+		kernels.squared_distances(x.data(), rows, ld, d, centers.data(), k, norms.data(), k, out.data(), ld);
+		double error = 0.0;
+		for (El::Int c = 0; c < k; c++)
+			for (El::Int i = 0; i < rows; i++) {
+				double distance = 0.0;
+				for (El::Int j = 0; j < d; j++) distance += (value(i, j) - centers[c + j * k]) * (value(i, j) - centers[c + j * k]);
+				error = std::max(error, std::abs(out[i + c * ld] - distance));
+			}
+		CHECK_CLOSE(error, 0.0, 1e-12);
+	}
+
+	// column_moments
+	std::vector<double> a(rows);
+	for (El::Int i = 0; i < rows; i++) a[i] = 1e6 + value(i, 0);
+	double moments[5], mean = 0.0, m2 = 0.0;
+	kernels.column_moments(a.data(), rows, moments);
+	for (El::Int i = 0; i < rows; i++) mean += a[i] / (double) rows;
+	for (El::Int i = 0; i < rows; i++) m2 += (a[i] - mean) * (a[i] - mean);
+	CHECK(moments[0] == (double) rows);
+	CHECK_CLOSE(moments[1], mean, 1e-14);
+	CHECK_CLOSE(moments[2], m2, 1e-8);
+	CHECK(moments[3] == *std::min_element(a.begin(), a.end()) && moments[4] == *std::max_element(a.begin(), a.end()));
+
+	// fwht against the Hadamard matrix, H(i, j) = (-1)^popcount(i & j)
+	const El::Int length = 64;
+	std::vector<double> y(length), transformed(length);
+	for (El::Int i = 0; i < length; i++) y[i] = transformed[i] = value(i, 1);
+	kernels.fwht(transformed.data(), length);
+	double error = 0.0;
+	for (El::Int i = 0; i < length; i++) {
+		double sum = 0.0;
+		for (El::Int j = 0; j < length; j++) sum += (__builtin_popcountll((unsigned long long) (i & j)) % 2 == 0) ? y[j] : -y[j];
+		error = std::max(error, std::abs(transformed[i] - sum));
+	}
+	CHECK_CLOSE(error, 0.0, 1e-12);
+}
+
+int main(int argc, char ** argv)
+{
+	MPI_Init(&argc, &argv);
+
+	string previous = local_kernels().isa;
+	std::istringstream isas(supported_isas());
+	string isa;
+	int tested = 0;
+	while (std::getline(isas, isa, ',')) {
+		isa.erase(0, isa.find_first_not_of(' '));
+		CHECK(select_local_kernels(isa));
+		CHECK(string(local_kernels().isa) == isa);
+		check_kernels(local_kernels());
+		tested++;
+	}
+	CHECK(tested >= 1);
+
+	// The generic kernels are always there; an unknown name leaves the choice alone
+	CHECK(select_local_kernels("generic"));
+	CHECK(!select_local_kernels("sse9"));
+	CHECK(string(local_kernels().isa) == "generic");
+	CHECK(select_local_kernels("auto"));
+	CHECK(string(local_kernels().isa) == previous);
+
+	int status = testlib_test::finish("local_kernels_test");
+	MPI_Finalize();
+	return status;
+}
@@ -0,0 +1,87 @@
+// Sketched least squares against a direct solve of the full problem: the sketched solution alone is
+// close in residual, LSQR refines it to the solution itself, and dependent columns are reported
+
+#include <cmath>
+#include "test.hpp"
+#include "nla.hpp"
+
+using namespace alchemist;
+
+typedef El::DistMatrix<double, El::VR, El::STAR> RowMatrix;
+
+static const El::Int m = 300, n = 5, k = 2;
+
+static double a_entry(El::Int i, El::Int j) { return std::cos(0.91 * (double) (i * (j + 2)) + 0.3 * (double) j) + ((i % n == j) ? 1.0 : 0.0); }
+
+// A*X for X(j, c) = j - c, plus a residual outside the span of A
+static double b_entry(El::Int i, El::Int c)
+{
+	double b = 0.1 * std::sin(2.3 * (double) (i * i + c));
+	for (El::Int j = 0; j < n; j++) b += a_entry(i, j) * (double) (j - c);
+	return b;
+}
+
+// Largest |A*x - b| over the columns, from the entries
+static double residual(const El::Matrix<double> & X)
+{
+	double largest = 0.0;
+	for (El::Int c = 0; c < k; c++) {
+		double sum = 0.0;
+		for (El::Int i = 0; i < m; i++) {
+			double r = -b_entry(i, c);
+			for (El::Int j = 0; j < n; j++) r += a_entry(i, j) * X.Get(j, c);
+			sum += r * r;
+		}
+		largest = std::max(largest, std::sqrt(sum));
+	}
+	return largest;
+}
+
+int main(int argc, char ** argv)
+{
+	El::Initialize(argc, argv);
+	{
+		El::Grid grid(MPI_COMM_WORLD);
+		RowMatrix A(m, n, grid), B(m, k, grid);
+		for (El::Int il = 0; il < A.LocalHeight(); il++) {
+			for (El::Int j = 0; j < n; j++) A.Matrix().Set(il, j, a_entry(A.GlobalRow(il), j));
+			for (El::Int c = 0; c < k; c++) B.Matrix().Set(il, c, b_entry(B.GlobalRow(il), c));
+		}
+
+		// Direct solve on every process, through a QR factorization of all of A
+		El::Matrix<double> Q(m, n), R, Bfull(m, k), X0(n, k);
+		for (El::Int i = 0; i < m; i++) {
+			for (El::Int j = 0; j < n; j++) Q.Set(i, j, a_entry(i, j));
+			for (El::Int c = 0; c < k; c++) Bfull.Set(i, c, b_entry(i, c));
+		}
+		El::qr::Explicit(Q, R);
+		El::Gemm(El::TRANSPOSE, El::NORMAL, 1.0, Q, Bfull, 0.0, X0);
+		El::Trsm(El::LEFT, El::UPPER, El::NORMAL, El::NON_UNIT, 1.0, R, X0);
+		double best = residual(X0);
+
+		// The solution of the sketched problem has a residual within a small factor of the best
+		El::Matrix<double> X;
+		LstsqInfo info;
+		CHECK(sketched_lstsq(A, B, SKETCH_GAUSSIAN, 12 * n, 7, 0, 0.0, X, info));
+		CHECK(info.iterations == 0 && !info.rank_deficient);
+		CHECK(X.Height() == n && X.Width() == k);
+		CHECK(residual(X) >= best * (1.0 - 1e-12) && residual(X) <= 2.0 * best);
+
+		// LSQR on the preconditioned problem converges to the solution in few iterations
+		CHECK(sketched_lstsq(A, B, SKETCH_GAUSSIAN, 12 * n, 7, 100, 1e-13, X, info));
+		CHECK(info.iterations > 0 && info.iterations <= 25);
+		double error = 0.0;
+		for (El::Int c = 0; c < k; c++)
+			for (El::Int j = 0; j < n; j++) error = std::max(error, std::abs(X.Get(j, c) - X0.Get(j, c)));
+		CHECK_CLOSE(error, 0.0, 1e-9);
+		CHECK_CLOSE(info.residual / best, 1.0, 1e-6);
+
+		// A repeated column is reported rather than solved
+		for (El::Int il = 0; il < A.LocalHeight(); il++) A.Matrix().Set(il, n - 1, A.Matrix().Get(il, 0));
+		CHECK(!sketched_lstsq(A, B, SKETCH_COUNT, 12 * n, 7, 100, 1e-13, X, info));
+		CHECK(info.rank_deficient);
+	}
+	int status = testlib_test::finish("lstsq_test");
+	El::Finalize();
+	return status;
+}
@@ -0,0 +1,81 @@
+// Distributed products with every SUMMA variant that matmul can be forced to, in every orientation
+// of A and B, against the product of the replicated factors; and the variant chosen from the shapes
+
+#include <cmath>
+#include <string>
+#include "test.hpp"
+#include "nla.hpp"
+
+using namespace alchemist;
+
+static double a_entry(El::Int i, El::Int j) { return std::sin(0.7 * (double) i + 1.3 * (double) j); }
+static double b_entry(El::Int i, El::Int j) { return std::cos(0.4 * (double) i - 0.9 * (double) j) + 0.1 * (double) j; }
+
+// height x width matrix with entries f(i, j), or f(j, i) if transposed
+static void fill(El::DistMatrix<double> & M, El::Int height, El::Int width, double (*f)(El::Int, El::Int), bool transposed)
+{
+	M.Resize(height, width);
+	for (El::Int jl = 0; jl < M.LocalWidth(); jl++)
+		for (El::Int il = 0; il < M.LocalHeight(); il++) {
+			El::Int i = M.GlobalRow(il), j = M.GlobalCol(jl);
+			M.SetLocal(il, jl, (transposed) ? f(j, i) : f(i, j));
+		}
+}
+
+int main(int argc, char ** argv)
+{
+	El::Initialize(argc, argv);
+	{
+		El::Grid grid(MPI_COMM_WORLD);
+		auto pool = std::make_shared<BufferPool>();
+
+		// op(A) is m x k and op(B) is k x n; the second shape has k far larger than m and n, where
+		// the dot-product variant is chosen
+		const El::Int shapes[][3] = {{9, 7, 5}, {4, 3, 40}};
+		const char * algorithms[] = {"auto", "default", "summa_a", "summa_b", "summa_c", "summa_dot"};
+
+		for (auto shape : shapes) {
+			El::Int m = shape[0], n = shape[1], k = shape[2];
+			for (bool transpose_a : {false, true})
+				for (bool transpose_b : {false, true}) {
+					El::DistMatrix<double> A(grid), B(grid);
+					fill(A, (transpose_a) ? k : m, (transpose_a) ? m : k, a_entry, transpose_a);
+					fill(B, (transpose_b) ? n : k, (transpose_b) ? k : n, b_entry, transpose_b);
+
+					for (const char * name : algorithms) {
+						El::GemmAlgorithm alg;
+						CHECK(parse_gemm_algorithm(name, m, n, k, alg));
+						auto C = multiply(pool, (transpose_a) ? El::TRANSPOSE : El::NORMAL, (transpose_b) ? El::TRANSPOSE : El::NORMAL,
+								A, B, alg);
+						CHECK(C->Height() == m && C->Width() == n);
+
+						El::DistMatrix<double, El::STAR, El::STAR> Cs(*C);
+						double error = 0.0;
+						for (El::Int i = 0; i < m; i++)
+							for (El::Int j = 0; j < n; j++) {
+								double c = 0.0;
+								for (El::Int l = 0; l < k; l++) c += a_entry(i, l) * b_entry(l, j);
+								error = std::max(error, std::abs(Cs.LockedMatrix().Get(i, j) - c));
+							}
+						if (error > 1e-10)
+							std::fprintf(stderr, "%s, %lldx%lldx%lld, transpose_a %d, transpose_b %d\n", name, (long long) m,
+									(long long) n, (long long) k, (int) transpose_a, (int) transpose_b);
+						CHECK_CLOSE(error, 0.0, 1e-10);
+					}
+				}
+		}
+
+		// The variant that keeps the largest operand in place
+		CHECK(choose_gemm_algorithm(100, 100, 10) == El::GEMM_SUMMA_C);
+		CHECK(choose_gemm_algorithm(100, 10, 50) == El::GEMM_SUMMA_A);
+		CHECK(choose_gemm_algorithm(10, 100, 50) == El::GEMM_SUMMA_B);
+		CHECK(choose_gemm_algorithm(10, 10, 1000) == El::GEMM_SUMMA_DOT);
+
+		El::GemmAlgorithm alg;
+		CHECK(!parse_gemm_algorithm("summa_e", 1, 1, 1, alg));
+		CHECK(parse_gemm_algorithm("summa_dot", 1, 1, 1, alg) && std::string(gemm_algorithm_name(alg)) == "SUMMA dot-product");
+	}
+	int status = testlib_test::finish("matmul_test");
+	El::Finalize();
+	return status;
+}
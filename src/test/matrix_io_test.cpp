@@ -0,0 +1,102 @@
+// Binary matrix files: save/load round trips in both layouts, mapping, and errors that every
+// process must see alike
+
+#include <cstdio>
+#include <fstream>
+#include <unistd.h>
+#include "test.hpp"
+#include "matrix_io.hpp"
+
+using namespace alchemist;
+
+typedef El::DistMatrix<double, El::VR, El::STAR> RowMatrix;
+
+static double entry(El::Int i, El::Int j) { return 1000.0 * (double) i + (double) j + 0.25; }
+
+static bool matches(const RowMatrix & A, El::Int m, El::Int n)
+{
+	if (A.Height() != m || A.Width() != n) return false;
+	const El::Matrix<double> & local = A.LockedMatrix();
+	for (El::Int j = 0; j < n; j++)
+		for (El::Int il = 0; il < local.Height(); il++)
+			if (local.Get(il, j) != entry(A.GlobalRow(il), j)) return false;
+	return true;
+}
+
+int main(int argc, char ** argv)
+{
+	El::Initialize(argc, argv);
+	{
+		El::Grid grid(MPI_COMM_WORLD);
+		auto pool = std::make_shared<BufferPool>();
+		int rank;
+		MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+		char name[64];
+		std::snprintf(name, sizeof(name), "/tmp/testlib_matrix_io_test_%d", (int) getpid());
+		MPI_Bcast(name, (int) sizeof(name), MPI_CHAR, 0, MPI_COMM_WORLD);
+		string path = name;
+
+		const El::Int m = 37, n = 5;
+		RowMatrix A(m, n, grid);
+		for (El::Int j = 0; j < n; j++)
+			for (El::Int il = 0; il < A.LocalHeight(); il++) A.Matrix().Set(il, j, entry(A.GlobalRow(il), j));
+
+		// Row panels of 4 rows, so that a process owns rows in some panels and none in others
+		CHECK(save_matrix(path, A, "A", 4, MATRIX_FILE_ROW_PANELS) == MPI_SUCCESS);
+		MatrixFileHeader header;
+		CHECK(read_matrix_header(path, header));
+		CHECK(header.num_rows == (uint64_t) m && header.num_cols == (uint64_t) n && header.num_panels() == 10);
+		std::shared_ptr<RowMatrix> B;
+		CHECK(load_matrix(path, grid, pool, B, header) == MPI_SUCCESS);
+		CHECK(B && matches(*B, m, n));
+
+		// One panel per process, which can also be mapped
+		CHECK(save_matrix(path, A, "A", 0, MATRIX_FILE_CYCLIC) == MPI_SUCCESS);
+		B.reset();
+		CHECK(load_matrix(path, grid, pool, B, header) == MPI_SUCCESS);
+		CHECK(B && matches(*B, m, n));
+		B.reset();
+		CHECK(map_matrix(path, grid, B, header) == MPI_SUCCESS);
+		CHECK(B && matches(*B, m, n));
+		B.reset();
+
+		// A file of the other byte order is recognized
+		MPI_Barrier(MPI_COMM_WORLD);
+		if (rank == 0) {
+			std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+			uint32_t version;
+			file.seekg(8);
+			file.read(reinterpret_cast<char *>(&version), sizeof(version));
+			version = ((version & 0xffu) << 24) | ((version & 0xff00u) << 8) | ((version >> 8) & 0xff00u) | (version >> 24);
+			file.seekp(8);
+			file.write(reinterpret_cast<const char *>(&version), sizeof(version));
+		}
+		MPI_Barrier(MPI_COMM_WORLD);
+		CHECK(!read_matrix_header(path, header));
+		CHECK(header.byte_swapped());
+		CHECK(load_matrix(path, grid, pool, B, header) == MPI_ERR_CONVERSION);
+		CHECK(!B);
+		CHECK(map_matrix(path, grid, B, header) == MPI_ERR_CONVERSION);
+
+		// A missing file fails alike everywhere, rather than leaving some processes in a collective
+		int error = load_matrix(path + ".missing", grid, pool, B, header);
+		int min_error, max_error;
+		MPI_Allreduce(&error, &min_error, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+		MPI_Allreduce(&error, &max_error, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+		CHECK(error != MPI_SUCCESS);
+		CHECK(min_error == max_error);
+
+		// Saving into a directory that does not exist fails alike everywhere
+		error = save_matrix(path + ".missing/A", A, "A");
+		MPI_Allreduce(&error, &min_error, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+		MPI_Allreduce(&error, &max_error, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+		CHECK(error != MPI_SUCCESS);
+		CHECK(min_error == max_error);
+
+		MPI_Barrier(MPI_COMM_WORLD);
+		if (rank == 0) std::remove(path.c_str());
+	}
+	int status = testlib_test::finish("matrix_io_test");
+	El::Finalize();
+	return status;
+}
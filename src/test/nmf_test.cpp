@@ -0,0 +1,88 @@
+// Nonnegative factorization of an exactly factorable matrix: the reported error is that of the
+// factors, it does not grow, the factors stay nonnegative, and they do not depend on the number of
+// processes
+
+#include <cmath>
+#include "test.hpp"
+#include "nla.hpp"
+
+using namespace alchemist;
+
+typedef El::DistMatrix<double, El::VR, El::STAR> RowMatrix;
+
+static const El::Int m = 40, n = 12, k = 3;
+
+// W0*H0 with nonnegative W0 (m x k) and H0 (k x n)
+static double entry(El::Int i, El::Int j)
+{
+	double a = 0.0;
+	for (El::Int c = 0; c < k; c++) a += (1.0 + std::sin((double) (i * (c + 1)))) * (1.0 + std::cos((double) (j * j + c)));
+	return a;
+}
+
+// |A - W*H|_F^2, summed over the grid
+static double error2(const RowMatrix & W, const El::Matrix<double> & H)
+{
+	double sum = 0.0;
+	for (El::Int il = 0; il < W.LocalHeight(); il++)
+		for (El::Int j = 0; j < n; j++) {
+			double r = entry(W.GlobalRow(il), j);
+			for (El::Int c = 0; c < k; c++) r -= W.LockedMatrix().Get(il, c) * H.Get(c, j);
+			sum += r * r;
+		}
+	MPI_Allreduce(MPI_IN_PLACE, &sum, 1, MPI_DOUBLE, MPI_SUM, W.Grid().VRComm().comm);
+	return sum;
+}
+
+static bool nonnegative(const RowMatrix & W, const El::Matrix<double> & H)
+{
+	bool ok = true;
+	for (El::Int c = 0; c < k; c++) {
+		for (El::Int il = 0; il < W.LocalHeight(); il++) ok = ok && W.LockedMatrix().Get(il, c) >= 0.0;
+		for (El::Int j = 0; j < n; j++) ok = ok && H.Get(c, j) >= 0.0;
+	}
+	return ok;
+}
+
+int main(int argc, char ** argv)
+{
+	El::Initialize(argc, argv);
+	{
+		El::Grid grid(MPI_COMM_WORLD), alone(MPI_COMM_SELF);
+		auto pool = std::make_shared<BufferPool>();
+		RowMatrix A(m, n, grid), A1(m, n, alone);
+		for (El::Int j = 0; j < n; j++) {
+			for (El::Int il = 0; il < A.LocalHeight(); il++) A.Matrix().Set(il, j, entry(A.GlobalRow(il), j));
+			for (El::Int i = 0; i < m; i++) A1.Matrix().Set(i, j, entry(i, j));
+		}
+		double norm2 = 0.0;
+		for (El::Int i = 0; i < m; i++)
+			for (El::Int j = 0; j < n; j++) norm2 += entry(i, j) * entry(i, j);
+
+		for (bool hals : {true, false}) {
+			NMF nmf(pool, A, k, hals, 11, 1.0, norm2), single(pool, A1, k, hals, 11, 1.0, norm2);
+			double previous = 1e300, last = 0.0, worst = 0.0, growth = 0.0;
+			for (int iteration = 0; iteration < 200; iteration++) {
+				// The error returned is that of the new H with the W it was computed from
+				RowMatrix W(*nmf.W);
+				last = nmf.iterate();
+				single.iterate();
+				worst = std::max(worst, std::abs(last - std::sqrt(error2(W, nmf.H) / norm2)));
+				growth = std::max(growth, last - previous);
+				previous = last;
+			}
+			CHECK_CLOSE(worst, 0.0, 1e-7);
+			CHECK(growth <= 1e-12);
+			CHECK(last < ((hals) ? 0.01 : 0.05));
+			CHECK(nonnegative(*nmf.W, nmf.H));
+
+			double difference = 0.0;
+			for (El::Int j = 0; j < n; j++)
+				for (El::Int c = 0; c < k; c++) difference = std::max(difference, std::abs(nmf.H.Get(c, j) - single.H.Get(c, j)));
+			CHECK_CLOSE(difference, 0.0, 1e-8);
+		}
+	}
+	int status = testlib_test::finish("nmf_test");
+	El::Finalize();
+	return status;
+}
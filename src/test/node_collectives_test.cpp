@@ -0,0 +1,52 @@
+// Hierarchical broadcast and reduction: several rounds through the same window, from the first
+// process and from the last, with a length that does not split evenly over the processes of a node
+
+#include <vector>
+#include "test.hpp"
+#include "node_collectives.hpp"
+
+using namespace alchemist;
+
+int main(int argc, char ** argv)
+{
+	MPI_Init(&argc, &argv);
+	int rank, size;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+	const int n = 7;
+	for (int root : {0, size - 1}) {
+		NodeCollectives collectives(MPI_COMM_WORLD, n, root);
+		CHECK(collectives.num_nodes() >= 1 && collectives.ranks_per_node() >= 1);
+		CHECK(collectives.num_nodes() * collectives.ranks_per_node() >= size);
+
+		for (int round = 0; round < 3; round++) {
+			if (rank == root)
+				for (int i = 0; i < n; i++) collectives.vector()[i] = (double) (100 * round + i);
+			collectives.broadcast();
+			bool received = true;
+			for (int i = 0; i < n; i++) received = received && collectives.vector()[i] == (double) (100 * round + i);
+			CHECK(received);
+
+			// Integer contributions, so that the sum is exact in any order
+			for (int i = 0; i < n; i++) collectives.contribution()[i] = collectives.vector()[i] + (double) rank;
+			std::vector<double> sum(n, -1.0);
+			collectives.reduce(sum.data());
+			if (rank == root) {
+				bool exact = true;
+				for (int i = 0; i < n; i++)
+					exact = exact && sum[i] == (double) size * (double) (100 * round + i) + (double) (size * (size - 1) / 2);
+				CHECK(exact);
+			}
+			else {
+				bool untouched = true;
+				for (int i = 0; i < n; i++) untouched = untouched && sum[i] == -1.0;
+				CHECK(untouched);
+			}
+		}
+	}
+
+	int status = testlib_test::finish("node_collectives_test");
+	MPI_Finalize();
+	return status;
+}
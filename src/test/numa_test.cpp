@@ -0,0 +1,75 @@
+// Affinity: the default policy, disjoint CPU shares on a node, and the host thread's mask after pinning
+
+#include <cstdlib>
+#include <set>
+#include <sched.h>
+#include "test.hpp"
+#include "numa.hpp"
+
+using namespace alchemist;
+
+static std::set<int> cpus_of(const NumaTopology & topology)
+{
+	std::set<int> cpus;
+	for (auto it = topology.node_cpus.begin(); it != topology.node_cpus.end(); it++) cpus.insert(it->begin(), it->end());
+	return cpus;
+}
+
+int main(int argc, char ** argv)
+{
+	MPI_Init(&argc, &argv);
+
+	unsetenv("TESTLIB_AFFINITY");
+	CHECK(affinity_policy_from_env() == AFFINITY_NONE);
+	setenv("TESTLIB_AFFINITY", "close", 1);
+	CHECK(affinity_policy_from_env() == AFFINITY_CLOSE);
+
+	NumaTopology topology = discover_numa_topology();
+	std::set<int> allowed = cpus_of(topology);
+	share_cpus(topology, MPI_COMM_WORLD);
+	std::set<int> share = cpus_of(topology);
+	CHECK(!share.empty());
+	for (int cpu : share) CHECK(allowed.count(cpu) == 1);
+
+	// Processes on this node with the same CPUs own disjoint shares that cover them all
+	MPI_Comm node;
+	MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &node);
+	int node_size;
+	MPI_Comm_size(node, &node_size);
+	const int width = 4096;
+	std::vector<char> mine(width, 0), sharing(width, 0), owners(width, 0);
+	for (int cpu : allowed) if (cpu < width) mine[cpu] = 1;
+	for (int cpu : share) if (cpu < width) owners[cpu] = 1;
+	std::vector<char> all_allowed((size_t) width * node_size), all_shares((size_t) width * node_size);
+	MPI_Allgather(mine.data(), width, MPI_CHAR, all_allowed.data(), width, MPI_CHAR, node);
+	MPI_Allgather(owners.data(), width, MPI_CHAR, all_shares.data(), width, MPI_CHAR, node);
+	std::vector<int> count(width, 0);
+	int shares = 0;
+	for (int q = 0; q < node_size; q++) {
+		if (!std::equal(mine.begin(), mine.end(), all_allowed.begin() + (size_t) q * width)) continue;
+		for (int cpu = 0; cpu < width; cpu++) count[cpu] += all_shares[(size_t) q * width + cpu];
+		shares++;
+	}
+	for (int cpu : allowed)
+		if (cpu < width) CHECK((shares <= (int) allowed.size()) ? count[cpu] == 1 : count[cpu] >= 1);
+	if (shares > (int) allowed.size()) CHECK(share.size() == 1);
+	MPI_Comm_free(&node);
+
+	cpu_set_t before, after;
+	CPU_ZERO(&before);
+	CPU_ZERO(&after);
+	sched_getaffinity(0, sizeof(before), &before);
+	int threads = omp_get_max_threads();
+	int unpinned = pin_threads(topology, AFFINITY_CLOSE);
+	sched_getaffinity(0, sizeof(after), &after);
+	CHECK(unpinned == 0);
+	CHECK(CPU_EQUAL(&before, &after));
+	CHECK(omp_get_max_threads() == threads);
+	CHECK(topology.thread_cpus.size() == (size_t) threads);
+	CHECK(topology.thread_cpus[0] == -1);
+	for (size_t t = 1; t < topology.thread_cpus.size(); t++) CHECK(share.count(topology.thread_cpus[t]) == 1);
+
+	int status = testlib_test::finish("numa_test");
+	MPI_Finalize();
+	return status;
+}
@@ -0,0 +1,89 @@
+// truncated_svd with ritz_tol: once the singular values settle from one implicit restart to the next,
+// ARPACK is told to accept them at the following restart, which takes fewer products than reaching
+// tol alone, and the singular values still agree with the tight run to within ritz_tol
+
+#include <string>
+#include <vector>
+#include "test.hpp"
+#include "TestLib.hpp"
+
+using namespace alchemist;
+
+static const uint64_t rows = 800, cols = 100;
+static const uint32_t k = 5;
+
+template <typename T>
+static T * output(const std::vector<Parameter_ptr> & out, const string & name)
+{
+	for (auto it = out.begin(); it != out.end(); it++)
+		if ((*it)->name == name) return reinterpret_cast<T * >((*it)->p);
+	return nullptr;
+}
+
+// Singular values, then the converged count, the restarts and the products, on every process
+static int svd(TestLib & lib, const Parameter_ptr & A, double ritz_tol, std::vector<double> & S, std::vector<double> & convergence)
+{
+	string task = "truncated_svd", outputs = "S", small_outputs = "array";
+	uint32_t rank = k;
+	double tol = 1e-13;
+	std::vector<Parameter_ptr> in = {A, std::make_shared<Parameter>("rank", UINT32, &rank), std::make_shared<Parameter>("tol", DOUBLE, &tol),
+			std::make_shared<Parameter>("outputs", STRING, &outputs), std::make_shared<Parameter>("small_outputs", STRING, &small_outputs)}, out;
+	if (ritz_tol > 0.0) in.push_back(std::make_shared<Parameter>("ritz_tol", DOUBLE, &ritz_tol));
+
+	int status = lib.run(task, in, out);
+	const ArrayBlockDouble * s = output<ArrayBlockDouble>(out, "S"), * c = output<ArrayBlockDouble>(out, "convergence");
+	if (s != nullptr) S = s->data;
+	if (c != nullptr) convergence = c->data;
+	return status;
+}
+
+int main(int argc, char ** argv)
+{
+	El::Initialize(argc, argv);
+	int rank, size;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &size);
+	CHECK(size >= 2);
+
+	if (size >= 2) {
+		MPI_Comm world = MPI_COMM_WORLD;
+		TestLib lib(world);
+		CHECK(lib.load() == 0);
+
+		// Singular values decaying by 0.9, so that the wanted ones are poorly separated from the rest
+		// and the tight run needs many restarts
+		string task = "generate_matrix";
+		uint64_t m = rows, n = cols, seed = 3;
+		uint32_t true_rank = 10;
+		std::vector<Parameter_ptr> in = {std::make_shared<Parameter>("rows", UINT64, &m), std::make_shared<Parameter>("cols", UINT64, &n),
+				std::make_shared<Parameter>("rank", UINT32, &true_rank), std::make_shared<Parameter>("seed", UINT64, &seed)}, out;
+		CHECK(lib.run(task, in, out) == 0);
+
+		// Workers pass their part of A, the driver a description of it
+		MatrixInfo info(0, "A", rows, cols);
+		Parameter_ptr A = (rank == 0) ? std::make_shared<Parameter>("A", MATRIX_INFO, &info) : out.front();
+
+		const double ritz_tol = 1e-4;
+		std::vector<double> S_tight, S_early, tight, early;
+		CHECK(svd(lib, A, 0.0, S_tight, tight) == 0);
+		CHECK(svd(lib, A, ritz_tol, S_early, early) == 0);
+
+		CHECK(tight.size() == 3 && early.size() == 3);
+		CHECK(S_tight.size() == k && S_early.size() == k);
+		if (tight.size() == 3 && early.size() == 3) {
+			CHECK(tight[0] == k && early[0] == k);
+			CHECK(early[2] < tight[2]);
+		}
+		if (S_tight.size() == k && S_early.size() == k) {
+			double error = 0.0;
+			for (uint32_t i = 0; i < k; i++) error = std::max(error, std::abs(S_early[i] - S_tight[i]) / S_tight[i]);
+			CHECK(error <= ritz_tol);
+		}
+
+		CHECK(lib.unload() == 0);
+	}
+
+	int status = testlib_test::finish("ritz_tol_test");
+	El::Finalize();
+	return status;
+}
@@ -0,0 +1,63 @@
+// Rows of a block held by the driver, handed to the owners of the rows they land on, with the
+// driver outside the grid
+
+#include "test.hpp"
+#include "nla.hpp"
+
+using namespace alchemist;
+
+typedef El::DistMatrix<double, El::VR, El::STAR> RowMatrix;
+
+static double entry(El::Int i, El::Int j) { return 100.0 * (double) i + (double) j; }
+
+int main(int argc, char ** argv)
+{
+	El::Initialize(argc, argv);
+	{
+		int rank, size;
+		MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+		MPI_Comm_size(MPI_COMM_WORLD, &size);
+		MPI_Comm workers;
+		MPI_Comm_split(MPI_COMM_WORLD, (rank == 0) ? MPI_UNDEFINED : 0, rank, &workers);
+
+		// Blocks of 5 rows written at offsets 0, 5 and 10 of a 15 x 3 matrix, then all of it at once
+		const El::Int m = 15, n = 3, b = 5;
+		std::unique_ptr<El::Grid> grid;
+		std::unique_ptr<RowMatrix> C, D;
+		if (rank != 0) {
+			grid.reset(new El::Grid(El::mpi::Comm(workers)));
+			C.reset(new RowMatrix(m, n, *grid));
+			D.reset(new RowMatrix(m, n, *grid));
+			El::Zeros(*C, m, n);
+		}
+
+		std::vector<double> full(m * n);
+		for (El::Int j = 0; j < n; j++)
+			for (El::Int i = 0; i < m; i++) full[i + j * m] = entry(i, j);
+
+		for (El::Int first = 0; first < m; first += b) {
+			if (rank == 0) scatter_rows(MPI_COMM_WORLD, full.data() + first, b, n, m, first);
+			else receive_rows(MPI_COMM_WORLD, *C, first, b);
+		}
+		if (rank == 0) scatter_rows(MPI_COMM_WORLD, full.data(), m, n, m, 0);
+		else receive_rows(MPI_COMM_WORLD, *D, 0, m);
+
+		if (rank != 0) {
+			bool exact = true;
+			for (El::Int j = 0; j < n; j++)
+				for (El::Int il = 0; il < C->LocalHeight(); il++) {
+					exact = exact && C->LockedMatrix().Get(il, j) == entry(C->GlobalRow(il), j);
+					exact = exact && D->LockedMatrix().Get(il, j) == entry(D->GlobalRow(il), j);
+				}
+			CHECK(exact);
+		}
+
+		C.reset();
+		D.reset();
+		grid.reset();
+		if (workers != MPI_COMM_NULL) MPI_Comm_free(&workers);
+	}
+	int status = testlib_test::finish("scatter_rows_test");
+	El::Finalize();
+	return status;
+}
@@ -0,0 +1,99 @@
+// Row streams: blocks of rows sent by a driver outside the grid, the buffer growing under them,
+// and the statistics and Gramian against those of the rows themselves
+
+#include <cmath>
+#include "test.hpp"
+#include "nla.hpp"
+
+using namespace alchemist;
+
+typedef El::DistMatrix<double, El::VR, El::STAR> RowMatrix;
+
+static double entry(El::Int i, El::Int j) { return std::cos(0.7 * (double) (i * 3 + j * j)) + 0.1 * (double) j; }
+
+static bool matches(const RowMatrix & A, El::Int m, El::Int n)
+{
+	if (A.Height() != m || A.Width() != n) return false;
+	const El::Matrix<double> & local = A.LockedMatrix();
+	for (El::Int j = 0; j < n; j++)
+		for (El::Int il = 0; il < local.Height(); il++)
+			if (local.Get(il, j) != entry(A.GlobalRow(il), j)) return false;
+	return true;
+}
+
+int main(int argc, char ** argv)
+{
+	El::Initialize(argc, argv);
+	{
+		int rank;
+		MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+		MPI_Comm workers;
+		MPI_Comm_split(MPI_COMM_WORLD, (rank == 0) ? MPI_UNDEFINED : 0, rank, &workers);
+
+		// Blocks of uneven sizes, an empty one among them, into a stream expecting 4 rows
+		const El::Int n = 4;
+		const El::Int sizes[] = {3, 0, 7, 1, 12};
+		auto pool = std::make_shared<BufferPool>();
+		std::unique_ptr<El::Grid> grid;
+		std::unique_ptr<RowStream> S;
+		if (rank != 0) {
+			grid.reset(new El::Grid(El::mpi::Comm(workers)));
+			S.reset(new RowStream(pool, *grid, n, 4, true));
+		}
+
+		El::Int m = 0;
+		std::shared_ptr<RowMatrix> early;
+		for (El::Int b : sizes) {
+			if (rank == 0) {
+				std::vector<double> block((size_t) std::max(b * n, El::Int(1)));
+				for (El::Int j = 0; j < n; j++)
+					for (El::Int i = 0; i < b; i++) block[i + j * b] = entry(m + i, j);
+				scatter_rows(MPI_COMM_WORLD, block.data(), b, n, std::max(b, El::Int(1)), m);
+			}
+			else {
+				S->receive(MPI_COMM_WORLD, b);
+				if (m + b == 10) early = S->matrix();
+			}
+			m += b;
+		}
+
+		if (rank != 0) {
+			CHECK(S->Height() == m);
+			CHECK(matches(*S->matrix(), m, n));
+
+			// Appending after matrix() leaves the matrix it returned as it was
+			CHECK(early && matches(*early, 10, n));
+
+			double error = 0.0;
+			ColumnStats stats;
+			S->stats(stats);
+			CHECK(stats.count == (uint64_t) m);
+			for (El::Int j = 0; j < n; j++) {
+				double sum = 0.0;
+				for (El::Int i = 0; i < m; i++) sum += entry(i, j);
+				error = std::max(error, std::abs(stats.mean[j] - sum / (double) m));
+			}
+			CHECK_CLOSE(error, 0.0, 1e-12);
+
+			auto G = S->local_gram();
+			CHECK(G && G->Height() == n && G->Width() == n);
+			MPI_Allreduce(MPI_IN_PLACE, G->Buffer(), (int) (n * n), MPI_DOUBLE, MPI_SUM, workers);
+			error = 0.0;
+			for (El::Int a = 0; a < n; a++)
+				for (El::Int c = 0; c < n; c++) {
+					double g = 0.0;
+					for (El::Int i = 0; i < m; i++) g += entry(i, a) * entry(i, c);
+					error = std::max(error, std::abs(G->Get(a, c) - g));
+				}
+			CHECK_CLOSE(error, 0.0, 1e-10);
+		}
+
+		early.reset();
+		S.reset();
+		grid.reset();
+		if (workers != MPI_COMM_NULL) MPI_Comm_free(&workers);
+	}
+	int status = testlib_test::finish("stream_test");
+	El::Finalize();
+	return status;
+}
@@ -0,0 +1,157 @@
+// Lazy left singular vectors against U formed explicitly, and Brand's update of a rank-k SVD
+// against the SVD of the stacked matrix, recomputed from scratch
+
+#include <algorithm>
+#include <cmath>
+#include "test.hpp"
+#include "nla.hpp"
+
+using namespace alchemist;
+
+typedef El::DistMatrix<double, El::VR, El::STAR> RowMatrix;
+
+static double entry(El::Int i, El::Int j) { return std::cos(0.37 * (double) (i * 7 + j * 3)) + ((i == j) ? 2.0 : 0.0); }
+
+// Rows of an exactly rank-k matrix, then new rows of full rank
+static double stacked(El::Int i, El::Int j, El::Int m, El::Int k)
+{
+	if (i >= m) return std::sin(1.1 * (double) (i * i + 3 * j * j + i * j + 1));
+	double a = 0.0;
+	for (El::Int l = 0; l < k; l++) a += entry(i, l) * entry(j + 13, l);
+	return a;
+}
+
+// The Gramian of rows [0, rows) of stacked, and its eigenpairs, largest first
+static void stacked_eig(El::Int rows, El::Int n, El::Int m, El::Int k, El::Matrix<double> & w, El::Matrix<double> & Z)
+{
+	El::Matrix<double> G(n, n), wu, Zu;
+	for (El::Int a = 0; a < n; a++)
+		for (El::Int c = 0; c < n; c++) {
+			double g = 0.0;
+			for (El::Int i = 0; i < rows; i++) g += stacked(i, a, m, k) * stacked(i, c, m, k);
+			G.Set(a, c, g);
+		}
+	El::HermitianEig(El::LOWER, G, wu, Zu);
+	std::vector<El::Int> order(n);
+	for (El::Int q = 0; q < n; q++) order[q] = q;
+	std::sort(order.begin(), order.end(), [&wu](El::Int a, El::Int c) { return wu.Get(a, 0) > wu.Get(c, 0); });
+	El::Zeros(w, n, 1);
+	El::Zeros(Z, n, n);
+	for (El::Int q = 0; q < n; q++) {
+		w.Set(q, 0, wu.Get(order[q], 0));
+		for (El::Int i = 0; i < n; i++) Z.Set(i, q, Zu.Get(i, order[q]));
+	}
+}
+
+// Appends b rows to the rank-k SVD of the first m rows and compares with the SVD of all m + b
+static void check_update(const El::Grid & grid, const BufferPool_ptr & pool, El::Int m, El::Int n, El::Int k, El::Int b,
+		int u_align = 0)
+{
+	El::Matrix<double> w, Z;
+	stacked_eig(m, n, m, k, w, Z);
+	std::vector<double> S(k), Sinv(k);
+	El::Matrix<double> V(n, k);
+	for (El::Int c = 0; c < k; c++) {
+		S[c] = std::sqrt(w.Get(c, 0));
+		Sinv[c] = 1.0 / S[c];
+		for (El::Int i = 0; i < n; i++) V.Set(i, c, Z.Get(i, c));
+	}
+
+	// U in any alignment, its rows starting on process u_align
+	RowMatrix U(grid), B(b, n, grid);
+	U.AlignCols(u_align % grid.Size());
+	U.Resize(m, k);
+	for (El::Int il = 0; il < U.LocalHeight(); il++)
+		for (El::Int c = 0; c < k; c++) {
+			double u = 0.0;
+			for (El::Int j = 0; j < n; j++) u += stacked(U.GlobalRow(il), j, m, k) * V.Get(j, c);
+			U.Matrix().Set(il, c, u * Sinv[c]);
+		}
+	for (El::Int il = 0; il < B.LocalHeight(); il++)
+		for (El::Int j = 0; j < n; j++) B.Matrix().Set(il, j, stacked(m + B.GlobalRow(il), j, m, k));
+
+	SVDUpdate update;
+	append_rows(pool, U, S, V, B, update);
+	CHECK(update.U->Height() == m + b && update.U->Width() == k);
+	CHECK(update.residual_rank == std::min(b, n - k));
+
+	// The singular values are those of [A; B], since A has rank k
+	stacked_eig(m + b, n, m, k, w, Z);
+	double error = 0.0;
+	for (El::Int c = 0; c < k; c++) error = std::max(error, std::abs(update.S[c] - std::sqrt(w.Get(c, 0))) / update.S[0]);
+	CHECK_CLOSE(error, 0.0, 1e-9);
+
+	// U*diag(S) = [A; B]*V, row by row wherever the rows ended up
+	error = 0.0;
+	const El::Matrix<double> & Ul = update.U->LockedMatrix();
+	for (El::Int il = 0; il < Ul.Height(); il++)
+		for (El::Int c = 0; c < k; c++) {
+			double av = 0.0;
+			for (El::Int j = 0; j < n; j++) av += stacked(update.U->GlobalRow(il), j, m, k) * update.V.Get(j, c);
+			error = std::max(error, std::abs(Ul.Get(il, c) * update.S[c] - av) / update.S[0]);
+		}
+	CHECK_CLOSE(error, 0.0, 1e-9);
+}
+
+int main(int argc, char ** argv)
+{
+	El::Initialize(argc, argv);
+	{
+		El::Grid grid(MPI_COMM_WORLD);
+		auto pool = std::make_shared<BufferPool>();
+		const El::Int m = 23, n = 6, k = 3, c = 2;
+
+		auto A = std::make_shared<RowMatrix>(m, n, grid);
+		for (El::Int j = 0; j < n; j++)
+			for (El::Int il = 0; il < A->LocalHeight(); il++) A->Matrix().Set(il, j, entry(A->GlobalRow(il), j));
+
+		// Any orthonormal V and positive inverses of S will do for comparing the operator with A*V*inv(S)
+		El::Matrix<double> V(n, k), R;
+		for (El::Int j = 0; j < k; j++)
+			for (El::Int i = 0; i < n; i++) V.Set(i, j, entry(i + 11, j));
+		El::qr::Explicit(V, R);
+		std::vector<double> Sinv = {0.5, 0.25, 2.0};
+		El::Matrix<double> X(k, c);
+		for (El::Int j = 0; j < c; j++)
+			for (El::Int i = 0; i < k; i++) X.Set(i, j, 1.0 + (double) (i - j));
+
+		// U(i, j) computed from the definition
+		auto U = [&](El::Int i, El::Int j) {
+			double u = 0.0;
+			for (El::Int l = 0; l < n; l++) u += entry(i, l) * V.Get(l, j);
+			return u * Sinv[j];
+		};
+
+		LeftSingularVectors Uop(A, V, Sinv);
+		CHECK(Uop.Height() == m && Uop.Width() == k);
+
+		auto Y = Uop.apply(pool, X);
+		double error = 0.0;
+		for (El::Int il = 0; il < Y->LocalHeight(); il++)
+			for (El::Int j = 0; j < c; j++) {
+				double y = 0.0;
+				for (El::Int l = 0; l < k; l++) y += U(Y->GlobalRow(il), l) * X.Get(l, j);
+				error = std::max(error, std::abs(Y->LockedMatrix().Get(il, j) - y));
+			}
+		CHECK_CLOSE(error, 0.0, 1e-10);
+
+		// A block that starts and ends on different processes
+		El::Matrix<double> rows;
+		Uop.rows(5, 9, rows);
+		error = 0.0;
+		for (El::Int i = 0; i < 9; i++)
+			for (El::Int j = 0; j < k; j++) error = std::max(error, std::abs(rows.Get(i, j) - U(5 + i, j)));
+		CHECK_CLOSE(error, 0.0, 1e-10);
+
+		// Fewer new rows than columns, through a thin QR of the residual, and more, through R'*R;
+		// m both a multiple of the number of processes and not; and a U that does not start on process 0
+		for (El::Int rows : {El::Int(12), El::Int(13)}) {
+			check_update(grid, pool, rows, 6, 2, 3);
+			check_update(grid, pool, rows, 6, 2, 9);
+			check_update(grid, pool, rows, 6, 2, 3, 1);
+		}
+	}
+	int status = testlib_test::finish("svd_test");
+	El::Finalize();
+	return status;
+}
@@ -0,0 +1,69 @@
+// C entry points of asynchronous tasks, as a server holding only the library pointer uses them:
+// outputs read back after a wait, unknown tasks failing on every process, and bad calls refused
+
+#include <string>
+#include <vector>
+#include "test.hpp"
+#include "TestLib.hpp"
+
+using namespace alchemist;
+
+static const alchemist_parameter * find(const std::vector<alchemist_parameter> & out, const string & name)
+{
+	for (size_t i = 0; i < out.size(); i++)
+		if (name == out[i].name) return &out[i];
+	return nullptr;
+}
+
+int main(int argc, char ** argv)
+{
+	El::Initialize(argc, argv);
+	int rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	{
+		MPI_Comm world = MPI_COMM_WORLD;
+		CHECK(alchemist_create_library(&world, ALCHEMIST_LIBRARY_ABI_VERSION + 1) == nullptr);
+		void * library = alchemist_create_library(&world, ALCHEMIST_LIBRARY_ABI_VERSION);
+		CHECK(library != nullptr);
+		TestLib * lib = reinterpret_cast<TestLib *>(library);
+		CHECK(lib->load() == 0);
+
+		// greet echoes its inputs as outputs on the driver
+		int32_t in_int = -7;
+		string in_string = "async";
+		alchemist_parameter in[] = {{"in_int", INT32, &in_int}, {"in_string", STRING, &in_string}};
+		alchemist_task * task = alchemist_run_async(library, "greet", in, 2);
+		CHECK(task != nullptr);
+		CHECK(alchemist_task_wait(task) == 0);
+		CHECK(alchemist_task_poll(task) == 1 && alchemist_task_state(task) == ALCHEMIST_TASK_DONE);
+		CHECK(string(alchemist_task_error(task)).empty());
+
+		uint32_t count = alchemist_task_outputs(task, nullptr, 0);
+		CHECK(count == ((rank == 0) ? 8u : 0u));
+		std::vector<alchemist_parameter> out(count);
+		CHECK(alchemist_task_outputs(task, out.data(), count) == count);
+		if (rank == 0) {
+			const alchemist_parameter * out_int = find(out, "out_int"), * out_string = find(out, "out_string");
+			CHECK(out_int != nullptr && out_int->dt == UINT32 && * reinterpret_cast<uint32_t *>(out_int->p) == (uint32_t) in_int);
+			CHECK(out_string != nullptr && out_string->dt == STRING && * reinterpret_cast<string *>(out_string->p) == in_string);
+		}
+		alchemist_task_free(task);
+
+		// A task the library does not have fails everywhere without outputs
+		task = alchemist_run_async(library, "kmeans", nullptr, 0);
+		CHECK(task != nullptr);
+		CHECK(alchemist_task_wait(task) == -1 && alchemist_task_state(task) == ALCHEMIST_TASK_FAILED);
+		CHECK(alchemist_task_outputs(task, nullptr, 0) == 0);
+		alchemist_task_free(task);
+
+		CHECK(alchemist_run_async(nullptr, "greet", in, 2) == nullptr);
+		CHECK(alchemist_run_async(library, nullptr, in, 2) == nullptr);
+		alchemist_task_free(nullptr);
+
+		CHECK(lib->unload() == 0);
+		alchemist_destroy_library(library);
+	}
+	int status = testlib_test::finish("task_api_test");
+	El::Finalize();
+	return status;
+}
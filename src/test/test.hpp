@@ -0,0 +1,52 @@
+#ifndef TESTLIB_TEST_HPP
+#define TESTLIB_TEST_HPP
+
+// Minimal checks for the MPI tests in this directory. Every test is a program run under mpirun by
+// "make test"; a failed CHECK is reported with its rank and location, and finish() makes every
+// process exit with 1 if any process failed.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <mpi.h>
+
+namespace testlib_test {
+
+inline int & failures()
+{
+	static int count = 0;
+	return count;
+}
+
+inline void fail(const char * what, const char * file, int line)
+{
+	int rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	std::fprintf(stderr, "[rank %d] %s:%d: CHECK(%s) failed\n", rank, file, line, what);
+	failures()++;
+}
+
+inline bool close_to(double a, double b, double tol)
+{
+	return std::abs(a - b) <= tol * std::max(1.0, std::max(std::abs(a), std::abs(b)));
+}
+
+// Collective over MPI_COMM_WORLD
+inline int finish(const char * name)
+{
+	int total = 0, rank;
+	MPI_Allreduce(&failures(), &total, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	if (rank == 0) std::printf("%s: %s\n", name, (total == 0) ? "passed" : "FAILED");
+	return (total == 0) ? 0 : 1;
+}
+
+}
+
+#define CHECK(cond) do { if (!(cond)) testlib_test::fail(#cond, __FILE__, __LINE__); } while (0)
+
+#define CHECK_CLOSE(a, b, tol) do { if (!testlib_test::close_to((a), (b), (tol))) { \
+	std::fprintf(stderr, "    %g vs %g\n", (double) (a), (double) (b)); \
+	testlib_test::fail(#a " ~ " #b, __FILE__, __LINE__); } } while (0)
+
+#endif // TESTLIB_TEST_HPP